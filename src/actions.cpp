@@ -25,19 +25,23 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/locale/conversion.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/regex.hpp>
 #include <algorithm>
 #include <iostream>
 
 #include "actions.h"
 #include "charset.h"
 #include "config.h"
+#include "database_cache.h"
 #include "display.h"
 #include "global.h"
 #include "mpdpp.h"
+#include "mpdpp_async.h"
 #include "helpers.h"
 #include "statusbar.h"
 #include "utility/comparators.h"
 #include "utility/conversion.h"
+#include "utility/reservoir_sampler.h"
 #include "utility/scoped_value.h"
 
 #include "curses/menu_impl.h"
@@ -64,6 +68,7 @@
 #include "screens/visualizer.h"
 #include "title.h"
 #include "tags.h"
+#include "tag_writer.h"
 
 #ifdef HAVE_TAGLIB_H
 # include "fileref.h"
@@ -87,6 +92,7 @@ void scrollTagDownRun(NC::List *list, const SongList *songs, MPD::Song::GetFunct
 void seek(SearchDirection sd);
 void findItem(const SearchDirection direction);
 void listsChangeFinisher();
+bool addRandomSongsFromDatabase(size_t number);
 
 template <typename Iterator>
 bool findSelectedRangeAndPrintInfoIfNot(Iterator &first, Iterator &last)
@@ -97,6 +103,35 @@ bool findSelectedRangeAndPrintInfoIfNot(Iterator &first, Iterator &last)
 	return success;
 }
 
+// Stored playlists can't be modified in ranges, so songs are deleted and
+// moved one by one. Moves within a single command list are applied in the
+// order that keeps positions of the remaining songs valid.
+std::function<void(MPD::Connection &, unsigned, unsigned)>
+storedPlaylistDeleter(std::string playlist)
+{
+	return [playlist](MPD::Connection &mpd, unsigned start, unsigned end) {
+		while (end > start)
+			mpd.PlaylistDelete(playlist, --end);
+	};
+}
+
+std::function<void(MPD::Connection *, unsigned, unsigned, unsigned)>
+storedPlaylistMover(std::string playlist)
+{
+	return [playlist](MPD::Connection *mpd, unsigned start, unsigned end, unsigned to) {
+		if (to < start)
+		{
+			for (unsigned i = 0; i < end-start; ++i)
+				mpd->PlaylistMove(playlist, start+i, to+i);
+		}
+		else
+		{
+			for (unsigned i = end-start; i > 0; --i)
+				mpd->PlaylistMove(playlist, start+i-1, to+i-1);
+		}
+	};
+}
+
 template <typename Iterator>
 Iterator nextScreenTypeInSequence(Iterator first, Iterator last, ScreenType type)
 {
@@ -671,16 +706,15 @@ void DeletePlaylistItems::run()
 	if (myScreen == myPlaylist)
 	{
 		Statusbar::print("Deleting items...");
-		auto delete_fun = std::bind(&MPD::Connection::Delete, ph::_1, ph::_2);
+		auto delete_fun = std::bind(&MPD::Connection::DeleteRange, ph::_1, ph::_2, ph::_3);
 		deleteSelectedSongs(myPlaylist->main(), delete_fun);
 		Statusbar::print("Item(s) deleted");
 	}
 	else if (myScreen->isActiveWindow(myPlaylistEditor->Content))
 	{
 		std::string playlist = myPlaylistEditor->Playlists.current()->value().path();
-		auto delete_fun = std::bind(&MPD::Connection::PlaylistDelete, ph::_1, playlist, ph::_2);
 		Statusbar::print("Deleting items...");
-		deleteSelectedSongs(myPlaylistEditor->Content, delete_fun);
+		deleteSelectedSongs(myPlaylistEditor->Content, storedPlaylistDeleter(playlist));
 		Statusbar::print("Item(s) deleted");
 	}
 }
@@ -981,14 +1015,13 @@ void MoveSelectedItemsTo::run()
 	if (myScreen == myPlaylist)
 	{
 		if (!myPlaylist->main().empty())
-			moveSelectedItemsTo(myPlaylist->main(), std::bind(&MPD::Connection::Move, ph::_1, ph::_2, ph::_3));
+			moveSelectedItemsTo(myPlaylist->main(), std::bind(&MPD::Connection::MoveRange, ph::_1, ph::_2, ph::_3, ph::_4));
 	}
 	else
 	{
 		assert(!myPlaylistEditor->Playlists.empty());
 		std::string playlist = myPlaylistEditor->Playlists.current()->value().path();
-		auto move_fun = std::bind(&MPD::Connection::PlaylistMove, ph::_1, playlist, ph::_2, ph::_3);
-		moveSelectedItemsTo(myPlaylistEditor->Content, move_fun);
+		moveSelectedItemsTo(myPlaylistEditor->Content, storedPlaylistMover(playlist));
 	}
 }
 
@@ -1412,6 +1445,11 @@ void EditLibraryTag::run()
 #	ifdef HAVE_TAGLIB_H
 	using Global::wFooter;
 
+	if (TagWriter.busy())
+	{
+		TagWriter.promptCancel();
+		return;
+	}
 	std::string new_tag;
 	{
 		Statusbar::ScopedLock slock;
@@ -1420,37 +1458,18 @@ void EditLibraryTag::run()
 	}
 	if (!new_tag.empty() && new_tag != myLibrary->Tags.current()->value().tag())
 	{
-		Statusbar::print("Updating tags...");
 		Mpd.StartSearch(true);
 		Mpd.AddSearch(Config.media_lib_primary_tag, myLibrary->Tags.current()->value().tag());
 		MPD::MutableSong::SetFunction set = tagTypeToSetFunction(Config.media_lib_primary_tag);
 		assert(set);
-		bool success = true;
-		std::string dir_to_update;
+		std::vector<MPD::MutableSong> songs;
 		for (MPD::SongIterator s = Mpd.CommitSearchSongs(), end; s != end; ++s)
 		{
-			MPD::MutableSong ms = std::move(*s);
-			ms.setTags(set, new_tag);
-			Statusbar::printf("Updating tags in \"%1%\"...", ms.getName());
-			std::string path = Config.mpd_music_dir + ms.getURI();
-			if (!Tags::write(ms))
-			{
-				success = false;
-				Statusbar::printf("Error while writing tags to \"%1%\": %2%",
-				                  ms.getName(), strerror(errno));
-				s.finish();
-				break;
-			}
-			if (dir_to_update.empty())
-				dir_to_update = ms.getURI();
-			else
-				dir_to_update = getSharedDirectory(dir_to_update, ms.getURI());
-		};
-		if (success)
-		{
-			Mpd.UpdateDirectory(dir_to_update);
-			Statusbar::print("Tags updated successfully");
+			songs.emplace_back(std::move(*s));
+			songs.back().setTags(set, new_tag);
 		}
+		if (!songs.empty())
+			TagWriter.start(std::move(songs));
 	}
 #	endif // HAVE_TAGLIB_H
 }
@@ -1470,7 +1489,12 @@ void EditLibraryAlbum::run()
 {
 #	ifdef HAVE_TAGLIB_H
 	using Global::wFooter;
-	// FIXME: merge this and EditLibraryTag. also, prompt on failure if user wants to continue
+	// FIXME: merge this and EditLibraryTag
+	if (TagWriter.busy())
+	{
+		TagWriter.promptCancel();
+		return;
+	}
 	std::string new_album;
 	{
 		Statusbar::ScopedLock slock;
@@ -1479,34 +1503,15 @@ void EditLibraryAlbum::run()
 	}
 	if (!new_album.empty() && new_album != myLibrary->Albums.current()->value().entry().album())
 	{
-		bool success = 1;
-		Statusbar::print("Updating tags...");
-		for (size_t i = 0;  i < myLibrary->Songs.size(); ++i)
+		std::vector<MPD::MutableSong> songs;
+		songs.reserve(myLibrary->Songs.size());
+		for (auto s = myLibrary->Songs.beginV(); s != myLibrary->Songs.endV(); ++s)
 		{
-			Statusbar::printf("Updating tags in \"%1%\"...", myLibrary->Songs[i].value().getName());
-			std::string path = Config.mpd_music_dir + myLibrary->Songs[i].value().getURI();
-			TagLib::FileRef f(path.c_str());
-			if (f.isNull())
-			{
-				const char msg[] = "Error while opening file \"%1%\"";
-				Statusbar::printf(msg, wideShorten(myLibrary->Songs[i].value().getURI(), COLS-const_strlen(msg)));
-				success = 0;
-				break;
-			}
-			f.tag()->setAlbum(ToWString(new_album));
-			if (!f.save())
-			{
-				const char msg[] = "Error while writing tags in \"%1%\"";
-				Statusbar::printf(msg, wideShorten(myLibrary->Songs[i].value().getURI(), COLS-const_strlen(msg)));
-				success = 0;
-				break;
-			}
-		}
-		if (success)
-		{
-			Mpd.UpdateDirectory(getSharedDirectory(myLibrary->Songs.beginV(), myLibrary->Songs.endV()));
-			Statusbar::print("Tags updated successfully");
+			songs.emplace_back(*s);
+			songs.back().setAlbum(new_album);
 		}
+		if (!songs.empty())
+			TagWriter.start(std::move(songs));
 	}
 #	endif // HAVE_TAGLIB_H
 }
@@ -1789,6 +1794,8 @@ bool ReverseSelection::canBeRun()
 
 void ReverseSelection::run()
 {
+	if (m_list == static_cast<NC::List *>(&myPlaylist->main()))
+		myPlaylist->loadAll();
 	for (auto &p : *m_list)
 		p.setSelected(!p.isSelected());
 	Statusbar::print("Selection reversed");
@@ -1856,6 +1863,8 @@ bool SelectFoundItems::canBeRun()
 
 void SelectFoundItems::run()
 {
+	if (m_list == static_cast<NC::List *>(&myPlaylist->main()))
+		myPlaylist->loadAll();
 	auto current_pos = m_list->choice();
 	myScreen->activeWindow()->scroll(NC::Scroll::Home);
 	bool found = m_searchable->search(SearchDirection::Forward, false, false);
@@ -1882,6 +1891,7 @@ void AddSelectedItems::run()
 
 void CropMainPlaylist::run()
 {
+	myPlaylist->loadAll();
 	auto &w = myPlaylist->main();
 	// cropping doesn't make sense in this case
 	if (w.size() <= 1)
@@ -1890,7 +1900,7 @@ void CropMainPlaylist::run()
 		confirmAction("Do you really want to crop main playlist?");
 	Statusbar::print("Cropping playlist...");
 	selectCurrentIfNoneSelected(w);
-	cropPlaylist(w, std::bind(&MPD::Connection::Delete, ph::_1, ph::_2));
+	cropPlaylist(w, std::bind(&MPD::Connection::DeleteRange, ph::_1, ph::_2, ph::_3));
 	Statusbar::print("Playlist cropped");
 }
 
@@ -1911,7 +1921,7 @@ void CropPlaylist::run()
 		confirmAction(boost::format("Do you really want to crop playlist \"%1%\"?") % playlist);
 	selectCurrentIfNoneSelected(w);
 	Statusbar::printf("Cropping playlist \"%1%\"...", playlist);
-	cropPlaylist(w, std::bind(&MPD::Connection::PlaylistDelete, ph::_1, playlist, ph::_2));
+	cropPlaylist(w, storedPlaylistDeleter(playlist));
 	Statusbar::printf("Playlist \"%1%\" cropped", playlist);
 }
 
@@ -1942,34 +1952,42 @@ void ClearPlaylist::run()
 
 bool SortPlaylist::canBeRun()
 {
-	if (myScreen != myPlaylist)
-		return false;
-	auto first = myPlaylist->main().begin(), last = myPlaylist->main().end();
-	return findSelectedRangeAndPrintInfoIfNot(first, last);
+	return myScreen == myPlaylist;
 }
 
 void SortPlaylist::run()
 {
-	mySortPlaylistDialog->switchTo();
+	// The range may extend to songs that are not loaded yet.
+	myPlaylist->loadAll();
+	auto first = myPlaylist->main().begin(), last = myPlaylist->main().end();
+	if (findSelectedRangeAndPrintInfoIfNot(first, last))
+		mySortPlaylistDialog->switchTo();
 }
 
 bool ReversePlaylist::canBeRun()
 {
-	if (myScreen != myPlaylist)
-		return false;
-	m_begin = myPlaylist->main().begin();
-	m_end = myPlaylist->main().end();
-	return findSelectedRangeAndPrintInfoIfNot(m_begin, m_end);
+	return myScreen == myPlaylist;
 }
 
 void ReversePlaylist::run()
 {
+	myPlaylist->loadAll();
+	auto first = myPlaylist->main().begin(), last = myPlaylist->main().end();
+	if (!findSelectedRangeAndPrintInfoIfNot(first, last))
+		return;
+	std::vector<unsigned> positions;
+	for (auto it = first; it != last; ++it)
+		positions.push_back(it->value().getPosition());
+	std::vector<size_t> order(positions.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = order.size() - i - 1;
+	// Reversing a range used to take a swap per pair of songs.
+	size_t swaps = order.size()/2;
+
 	Statusbar::print("Reversing range...");
-	Mpd.StartCommandsList();
-	for (--m_end; m_begin < m_end; ++m_begin, --m_end)
-		Mpd.Swap(m_begin->value().getPosition(), m_end->value().getPosition());
-	Mpd.CommitCommandsList();
-	Statusbar::print("Range reversed");
+	size_t commands = reorderQueue(positions, order);
+	Statusbar::printf("Range reversed (%1% commands sent, %2% saved)",
+		commands, swaps > commands ? swaps - commands : 0);
 }
 
 bool ApplyFilter::canBeRun()
@@ -2204,14 +2222,42 @@ void AddRandomItems::run()
 		Statusbar::put() << "Number of random " << tag_type_str << "s: ";
 		number = fromString<unsigned>(wFooter->prompt());
 	}
-	if (number > 0)
+	if (number > 0 && rnd_type == 's' && Database.upToDate())
 	{
-		bool success;
-		if (rnd_type == 's')
-			success = Mpd.AddRandomSongs(number, Config.random_exclude_pattern, Global::RNG);
-		else
-			success = Mpd.AddRandomTag(tag_type, number, Global::RNG);
-		if (success)
+		// The database is available locally, so there is no need to list it.
+		if (addRandomSongsFromDatabase(number))
+			Statusbar::printf("%1% random song%2% added to playlist", number, number == 1 ? "" : "s");
+	}
+	else if (number > 0 && rnd_type == 's')
+	{
+		// Listing all songs in the database takes a while, so do it
+		// through the additional connection without blocking.
+		auto result = std::make_shared<boost::BOOST_THREAD_FUTURE<bool>>();
+		*result = AsyncMpd.send(
+			[number, pattern = Config.random_exclude_pattern, seed = Global::RNG()](MPD::Connection &mpd) {
+				std::mt19937 rng(seed);
+				return mpd.AddRandomSongs(number, pattern, rng);
+			},
+			[result, number] {
+				try
+				{
+					if (result->get())
+						Statusbar::printf("%1% random song%2% added to playlist", number, number == 1 ? "" : "s");
+				}
+				catch (MPD::ClientError &e)
+				{
+					Statusbar::printf("ncmpcpp: %1%", e.what());
+				}
+				catch (MPD::ServerError &e)
+				{
+					Status::handleServerError(e);
+				}
+			});
+		Statusbar::print("Adding random songs...");
+	}
+	else if (number > 0)
+	{
+		if (Mpd.AddRandomTag(tag_type, number, Global::RNG))
 			Statusbar::printf("%1% random %2%%3% added to playlist", number, tag_type_str, number == 1 ? "" : "s");
 	}
 }
@@ -3058,6 +3104,26 @@ void findItem(const SearchDirection direction)
 		Statusbar::printf("Using constraint \"%1%\"", constraint);
 }
 
+bool addRandomSongsFromDatabase(size_t number)
+{
+	boost::regex re;
+	if (!Config.random_exclude_pattern.empty())
+		re.assign(Config.random_exclude_pattern);
+	ReservoirSampler<const MPD::Song *> sampler(number);
+	for (const auto &s : Database.songs(Mpd))
+	{
+		if (Config.random_exclude_pattern.empty() || !boost::regex_match(s.c_uri(), re))
+			sampler.add(&s, Global::RNG);
+	}
+	if (number > sampler.seen())
+		return false;
+	auto songs = sampler.take(Global::RNG);
+	sendInCommandLists(songs.size(), [&songs](size_t i) {
+		Mpd.AddSong(songs[i]->c_uri());
+	});
+	return true;
+}
+
 void listsChangeFinisher()
 {
 	if (myScreen == myLibrary
@@ -3083,7 +3149,7 @@ void listsChangeFinisher()
 		}
 		else if (myScreen->isActiveWindow(myPlaylistEditor->Playlists))
 		{
-			myPlaylistEditor->Content.clear();
+			myPlaylistEditor->clearContent();
 			myPlaylistEditor->Content.refresh();
 			myPlaylistEditor->updateTimer();
 		}
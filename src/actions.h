@@ -1042,9 +1042,6 @@ struct ReversePlaylist: BaseAction
 private:
 	virtual bool canBeRun() override;
 	virtual void run() override;
-
-	NC::Menu<MPD::Song>::ConstIterator m_begin;
-	NC::Menu<MPD::Song>::ConstIterator m_end;
 };
 
 struct ApplyFilter: public BaseAction
@@ -176,7 +176,7 @@ bool configure(int argc, char **argv)
 				          << fetcher->name()
 				          << " : "
 				          << std::flush;
-				auto result = fetcher->fetch(std::get<1>(data), std::get<2>(data));
+				auto result = fetcher->fetch(std::get<1>(data), std::get<2>(data), nullptr);
 				std::cout << (result.first ? "ok" : "failed")
 				          << "\n";
 			}
@@ -231,6 +231,7 @@ bool configure(int argc, char **argv)
 		if (!vm["port"].defaulted())
 			Mpd.SetPort(vm["port"].as<int>());
 		Mpd.SetTimeout(Config.mpd_connection_timeout);
+		Mpd.SetFastSongParsing(Config.mpd_fast_song_parsing);
 
 		// print current song
 		if (vm.count("current-song"))
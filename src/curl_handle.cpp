@@ -21,6 +21,7 @@
 #include "curl_handle.h"
 
 #include <cstdlib>
+#include <mutex>
 
 namespace
 {
@@ -30,10 +31,20 @@ namespace
 		static_cast<std::string *>(data)->append(buffer, result);
 		return result;
 	}
+
+	int check_stopper(void *stopper, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+	{
+		return static_cast<const std::atomic<bool> *>(stopper)->load();
+	}
 }
 
-CURLcode Curl::perform(std::string &data, const std::string &URL, const std::string &referer, bool follow_redirect, unsigned timeout)
+CURLcode Curl::perform(std::string &data, const std::string &URL, const std::string &referer, bool follow_redirect, unsigned timeout, const std::atomic<bool> *stopper)
 {
+	// curl_easy_init initializes the library implicitly if needed, but that
+	// is not thread safe and transfers may be started from several threads.
+	static std::once_flag initialized;
+	std::call_once(initialized, [] { curl_global_init(CURL_GLOBAL_ALL); });
+
 	CURLcode result;
 	CURL *c = curl_easy_init();
 	curl_easy_setopt(c, CURLOPT_URL, URL.c_str());
@@ -46,6 +57,12 @@ CURLcode Curl::perform(std::string &data, const std::string &URL, const std::str
 		curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, 1L);
 	if (!referer.empty())
 		curl_easy_setopt(c, CURLOPT_REFERER, referer.c_str());
+	if (stopper != nullptr)
+	{
+		curl_easy_setopt(c, CURLOPT_XFERINFOFUNCTION, check_stopper);
+		curl_easy_setopt(c, CURLOPT_XFERINFODATA, stopper);
+		curl_easy_setopt(c, CURLOPT_NOPROGRESS, 0L);
+	}
 	result = curl_easy_perform(c);
 	curl_easy_cleanup(c);
 	return result;
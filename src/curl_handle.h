@@ -23,12 +23,15 @@
 
 #include "config.h"
 
+#include <atomic>
 #include <string>
 #include "curl/curl.h"
 
 namespace Curl
 {
-	CURLcode perform(std::string &data, const std::string &URL, const std::string &referer = "", bool follow_redirect = false, unsigned timeout = 10);
+	/// If stopper is given, the transfer is aborted with
+	/// CURLE_ABORTED_BY_CALLBACK as soon as it's set.
+	CURLcode perform(std::string &data, const std::string &URL, const std::string &referer = "", bool follow_redirect = false, unsigned timeout = 10, const std::atomic<bool> *stopper = nullptr);
 	
 	std::string escape(const std::string &s);
 }
@@ -300,6 +300,9 @@ struct Menu: Window, List
 	/// @param pos initial position of inserted separator
 	void insertSeparator(size_t pos);
 	
+	/// Removes the option at given position from the list
+	void deleteItem(size_t pos);
+	
 	/// Moves the highlighted position to the given line of window
 	/// @param y Y position of menu window to be highlighted
 	/// @return true if the position is reachable, false otherwise
@@ -162,6 +162,13 @@ void Menu<ItemT>::insertSeparator(size_t pos)
 	m_all_items.insert(m_all_items.begin()+pos, Item::mkSeparator());
 }
 
+template <typename ItemT>
+void Menu<ItemT>::deleteItem(size_t pos)
+{
+	assert(pos < m_all_items.size());
+	m_all_items.erase(m_all_items.begin()+pos);
+}
+
 template <typename ItemT>
 bool Menu<ItemT>::Goto(size_t y)
 {
@@ -0,0 +1,301 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "database_cache.h"
+#include "database_diff.h"
+#include "database_format.h"
+#include "mpdpp_async.h"
+#include "statusbar.h"
+
+DatabaseCache Database;
+
+DatabaseCache::DatabaseCache()
+: m_db_update_time(0), m_validated(false), m_fetch_db_update_time(0)
+, m_sync_db_update_time(0), m_sync_generation(0), m_generation(0)
+, m_index_used(false)
+{ }
+
+void DatabaseCache::load(std::string path)
+{
+	m_path = std::move(path);
+	m_validated = false;
+	resetIndex();
+	++m_generation;
+	if (!read())
+	{
+		m_server.clear();
+		m_db_update_time = 0;
+		m_songs.clear();
+	}
+}
+
+void DatabaseCache::invalidate()
+{
+	m_validated = false;
+	// Result of the fetch in progress might come from a different server.
+	m_fetch = boost::BOOST_THREAD_FUTURE<SongList>();
+	m_sync = boost::BOOST_THREAD_FUTURE<Changes>();
+}
+
+void DatabaseCache::prefetch(MPD::Connection &mpd, std::function<void()> on_fetched)
+{
+	if (m_validated)
+		return;
+	// Mark as validated upfront so that we don't end up continuously
+	// refetching the database if the server refuses to send it.
+	m_validated = true;
+	auto db_update_time = mpd.getStatistics().dbUpdateTime();
+	if (!m_songs.empty()
+	&&  db_update_time == m_db_update_time
+	&&  mpd.GetServerName() == m_server)
+		return;
+
+	m_fetch_server = mpd.GetServerName();
+	m_fetch_db_update_time = db_update_time;
+	m_fetch = AsyncMpd.send([](MPD::Connection &c) {
+		SongList songs;
+		for (MPD::SongIterator s = c.GetDirectoryRecursive("/"), end; s != end; ++s)
+			songs.push_back(s->intern());
+		return songs;
+	}, std::move(on_fetched));
+}
+
+bool DatabaseCache::completeFetch()
+{
+	if (!m_fetch.valid() || !m_fetch.is_ready())
+		return false;
+	storeFetched();
+	return true;
+}
+
+const DatabaseCache::SongList &DatabaseCache::songs(MPD::Connection &mpd)
+{
+	prefetch(mpd, nullptr);
+	if (m_fetch.valid())
+		storeFetched();
+	return m_songs;
+}
+
+bool DatabaseCache::synchronize(MPD::Connection &mpd, std::function<void()> on_synchronized)
+{
+	// Diffing against the database that is about to be replaced is
+	// pointless and the fetch in progress might predate the update.
+	// Synchronize only if the cache is in use, otherwise it can be
+	// validated lazily.
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 10, 0)
+	bool usable = m_validated && !fetching() && !m_songs.empty() && mpd.Version() >= 18;
+#	else
+	bool usable = false;
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+	if (!usable)
+	{
+		invalidate();
+		return false;
+	}
+
+	auto db_update_time = mpd.getStatistics().dbUpdateTime();
+	if (db_update_time == m_db_update_time)
+		return true;
+
+	m_sync_db_update_time = db_update_time;
+	m_sync_generation = m_generation;
+	// Songs are copied so that the worker thread can find out which ones
+	// are new, applying the changes is up to completeSynchronize.
+	m_sync = AsyncMpd.send([known = m_songs, since = m_db_update_time](MPD::Connection &c) {
+		Changes changes;
+		// Listing URIs is a lot cheaper than listing full metadata and
+		// it's enough to find out which songs were added or removed.
+		for (MPD::SongIterator s = c.GetDirectoryRecursiveNoInfo("/"), end; s != end; ++s)
+			changes.listed.push_back(std::move(*s));
+		c.StartSearch(true);
+		c.AddSearchModifiedSince(since);
+		for (MPD::SongIterator s = c.CommitSearchSongs(), end; s != end; ++s)
+			changes.modified.push_back(s->intern());
+
+		// The remaining new songs are the ones that were moved around without
+		// modification, fetch them from their directories.
+		for (const auto &directory : movedSongDirectories(known, changes.listed, changes.modified))
+		{
+			for (MPD::ItemIterator item = c.GetDirectory(directory), end; item != end; ++item)
+				if (item->type() == MPD::Item::Type::Song)
+					changes.moved.push_back(item->song().intern());
+		}
+		return changes;
+	}, std::move(on_synchronized));
+	return true;
+}
+
+bool DatabaseCache::completeSynchronize(Diff &diff)
+{
+	if (!m_sync.valid() || !m_sync.is_ready())
+		return false;
+	Changes changes;
+	try
+	{
+		changes = m_sync.get();
+	}
+	catch (MPD::ClientError &e)
+	{
+		Statusbar::printf("Unable to synchronize the database: %1%", e.what());
+		invalidate();
+		return false;
+	}
+	catch (MPD::ServerError &e)
+	{
+		Statusbar::printf("MPD: %1%", e.what());
+		invalidate();
+		return false;
+	}
+	m_sync = boost::BOOST_THREAD_FUTURE<Changes>();
+	// Songs were replaced as a whole in the meantime.
+	if (m_sync_generation != m_generation)
+		return false;
+
+	DatabaseMerge merge(m_songs, diff);
+	for (auto &s : changes.listed)
+		merge.addListed(std::move(s));
+	for (const auto &s : changes.modified)
+		merge.addModified(s);
+	for (const auto &s : changes.moved)
+		merge.addFromDirectory(s);
+	merge.finish();
+	if (!diff.empty())
+		resetIndex();
+
+	m_db_update_time = m_sync_db_update_time;
+	write();
+	return true;
+}
+
+const TrigramIndex *DatabaseCache::index()
+{
+	m_index_used = true;
+	if (!m_index && !m_index_build.valid())
+		resetIndex();
+	if (m_index_build.valid() && m_index_build.is_ready())
+	{
+		m_index = std::make_unique<TrigramIndex>(m_index_build.get());
+		m_index_build = boost::BOOST_THREAD_FUTURE<TrigramIndex>();
+	}
+	return m_index.get();
+}
+
+/**********************************************************************/
+
+void DatabaseCache::resetIndex()
+{
+	m_index.reset();
+	// Index of the previous songs is of no use, it's not waited for.
+	m_index_build = boost::BOOST_THREAD_FUTURE<TrigramIndex>();
+	if (m_index_used && !m_songs.empty())
+	{
+		m_index_build = boost::async(boost::launch::async, [songs = m_songs] {
+			return TrigramIndex(songs);
+		});
+	}
+}
+
+void DatabaseCache::storeFetched()
+{
+	SongList songs;
+	bool fetched = false, refused = false;
+	try
+	{
+		songs = m_fetch.get();
+		fetched = true;
+	}
+	catch (MPD::ClientError &e)
+	{
+		if (e.code() == MPD_ERROR_CLOSED)
+			Statusbar::print("Unable to fetch the data, increase max_output_buffer_size in your MPD configuration file");
+		else
+			Statusbar::printf("Unable to fetch the data: %1%", e.what());
+	}
+	catch (MPD::ServerError &e)
+	{
+		// mopidy blacklists 'listallinfo' command by default and throws server
+		// error when it receives it. Work around that to prevent ncmpcpp from
+		// continuously retrying to send the command and looping.
+		if (strstr(e.what(), "listallinfo") != nullptr
+		    && strstr(e.what(), "disabled") != nullptr)
+		{
+			Statusbar::print("Unable to fetch the data, server refused to process 'listallinfo' command");
+			refused = true;
+		}
+		else
+			Statusbar::printf("MPD: %1%", e.what());
+	}
+	m_fetch = boost::BOOST_THREAD_FUTURE<SongList>();
+
+	// Keep the songs we have if fetching failed, next access retries
+	// unless the server won't ever process the command.
+	if (!fetched)
+	{
+		m_validated = refused;
+		return;
+	}
+	m_songs = std::move(songs);
+	resetIndex();
+	++m_generation;
+	m_server = std::move(m_fetch_server);
+	m_db_update_time = m_fetch_db_update_time;
+	if (!m_songs.empty())
+		write();
+}
+
+bool DatabaseCache::read()
+{
+	std::ifstream f(m_path, std::ios::binary);
+	if (!f.is_open())
+		return false;
+	return DatabaseFormat::read(f, m_server, m_db_update_time, m_songs);
+}
+
+void DatabaseCache::write() const
+{
+	if (m_path.empty())
+		return;
+
+	// Write to a temporary file first so that an interrupted write
+	// doesn't leave a truncated cache behind.
+	std::string tmp_path = m_path + ".tmp";
+	std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+	if (!f.is_open())
+	{
+		std::cerr << "Couldn't open " << tmp_path << " for writing\n";
+		return;
+	}
+
+	DatabaseFormat::write(f, m_server, m_db_update_time, m_songs);
+
+	f.close();
+	if (!f || std::rename(tmp_path.c_str(), m_path.c_str()) != 0)
+	{
+		std::cerr << "Couldn't write database cache to " << m_path << "\n";
+		std::remove(tmp_path.c_str());
+	}
+}
@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_DATABASE_CACHE_H
+#define NCMPCPP_DATABASE_CACHE_H
+
+#include <boost/thread/future.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "database_diff.h"
+#include "mpdpp.h"
+#include "song.h"
+#include "trigram_index.h"
+
+/// Local copy of the whole MPD database, kept on disk between sessions so
+/// that the expensive listallinfo needs to be issued only if the database
+/// was updated since it was last fetched.
+struct DatabaseCache
+{
+	typedef std::vector<MPD::Song> SongList;
+
+	typedef DatabaseDiff Diff;
+
+	DatabaseCache();
+
+	/// Read the cache from a given file. Its validity is checked
+	/// against the server on first access.
+	void load(std::string path);
+
+	/// Force revalidation of the cache on next access.
+	void invalidate();
+
+	/// Validate the cache and if it's outdated, start fetching the database
+	/// in the background. on_fetched is run on the main thread when the
+	/// result can be stored with completeFetch.
+	void prefetch(MPD::Connection &mpd, std::function<void()> on_fetched);
+
+	/// @return true if the database is being fetched in the background.
+	bool fetching() const { return m_fetch.valid(); }
+
+	/// @return true if songs are available locally and were already
+	/// validated against the server.
+	bool upToDate() const
+	{
+		return m_validated && !fetching() && !synchronizing() && !m_songs.empty();
+	}
+
+	/// Store the database fetched in the background if it already arrived.
+	/// @return true if the cache was updated.
+	bool completeFetch();
+
+	/// Start bringing the cache up to date with the server after its
+	/// database was updated without fetching the whole database again.
+	/// on_synchronized is run on the main thread when the changes can be
+	/// applied with completeSynchronize.
+	/// @return false if the cache was merely invalidated.
+	bool synchronize(MPD::Connection &mpd, std::function<void()> on_synchronized);
+
+	/// @return true if changes to the database are being found out
+	/// in the background.
+	bool synchronizing() const { return m_sync.valid(); }
+
+	/// Apply changes found by synchronize if they already arrived.
+	/// @return true if the cache was updated and diff contains the changes.
+	bool completeSynchronize(Diff &diff);
+
+	/// @return true if the cache needs to be validated against the server.
+	bool invalidated() const { return !m_validated; }
+
+	/// @return number that changes whenever the songs are replaced as a
+	/// whole. Changes made by synchronize are reported through Diff instead.
+	unsigned long generation() const { return m_generation; }
+
+	/// @return all songs in the database, refetched from the server
+	/// if the cache turns out to be outdated.
+	const SongList &songs(MPD::Connection &mpd);
+
+	/// @return trigram index of songs or nullptr if it's not built yet.
+	/// Once requested, the index is built in the background and rebuilt
+	/// whenever songs change.
+	const TrigramIndex *index();
+
+private:
+	/// Songs the database changed by, queried on the additional connection.
+	struct Changes
+	{
+		/// URIs of all songs in the database.
+		SongList listed;
+		/// Songs modified since the previous version.
+		SongList modified;
+		/// Songs from directories of new songs that were not modified.
+		SongList moved;
+	};
+
+	void resetIndex();
+	void storeFetched();
+	bool read();
+	void write() const;
+
+	std::string m_path;
+	std::string m_server;
+	unsigned long m_db_update_time;
+	bool m_validated;
+
+	boost::BOOST_THREAD_FUTURE<SongList> m_fetch;
+	std::string m_fetch_server;
+	unsigned long m_fetch_db_update_time;
+
+	boost::BOOST_THREAD_FUTURE<Changes> m_sync;
+	unsigned long m_sync_db_update_time;
+	unsigned long m_sync_generation;
+
+	SongList m_songs;
+	unsigned long m_generation;
+	bool m_index_used;
+	boost::BOOST_THREAD_FUTURE<TrigramIndex> m_index_build;
+	std::unique_ptr<TrigramIndex> m_index;
+};
+
+extern DatabaseCache Database;
+
+#endif // NCMPCPP_DATABASE_CACHE_H
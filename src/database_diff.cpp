@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include "database_diff.h"
+
+DatabaseMerge::DatabaseMerge(std::vector<MPD::Song> &songs, DatabaseDiff &diff)
+: m_songs(songs), m_diff(diff), m_present(songs.size(), false)
+{
+	m_positions.reserve(m_songs.size());
+	for (size_t i = 0; i < m_songs.size(); ++i)
+		m_positions.emplace(m_songs[i], i);
+}
+
+void DatabaseMerge::addListed(MPD::Song s)
+{
+	auto it = m_positions.find(s);
+	if (it != m_positions.end())
+		m_present[it->second] = true;
+	else
+		m_new_songs.insert(std::move(s));
+}
+
+void DatabaseMerge::addModified(const MPD::Song &s)
+{
+	// New files and files modified in place (e.g. retagged ones)
+	// have their mtime set after the previous update.
+	auto it = m_positions.find(s);
+	if (it != m_positions.end())
+	{
+		if (m_present[it->second])
+		{
+			m_diff.removed.push_back(m_songs[it->second]);
+			m_songs[it->second] = s.intern();
+			m_diff.added.push_back(m_songs[it->second]);
+		}
+	}
+	else if (m_new_songs.erase(s) > 0)
+		m_diff.added.push_back(s.intern());
+}
+
+void DatabaseMerge::addFromDirectory(const MPD::Song &s)
+{
+	if (m_new_songs.erase(s) > 0)
+		m_diff.added.push_back(s.intern());
+}
+
+void DatabaseMerge::finish()
+{
+	std::vector<MPD::Song> songs;
+	songs.reserve(m_songs.size() - m_diff.removed.size() + m_diff.added.size());
+	for (size_t i = 0; i < m_songs.size(); ++i)
+	{
+		if (m_present[i])
+			songs.push_back(std::move(m_songs[i]));
+		else
+			m_diff.removed.push_back(std::move(m_songs[i]));
+	}
+	// Modified songs are already in place.
+	for (const auto &s : m_diff.added)
+		if (m_positions.find(s) == m_positions.end())
+			songs.push_back(s);
+	m_songs = std::move(songs);
+}
+
+std::set<std::string> movedSongDirectories(const std::vector<MPD::Song> &known,
+                                           const std::vector<MPD::Song> &listed,
+                                           const std::vector<MPD::Song> &modified)
+{
+	std::unordered_set<MPD::Song, MPD::Song::Hash> old_songs(known.begin(), known.end());
+	std::unordered_set<MPD::Song, MPD::Song::Hash> new_songs;
+	for (const auto &s : listed)
+		if (old_songs.find(s) == old_songs.end())
+			new_songs.insert(s);
+	for (const auto &s : modified)
+		new_songs.erase(s);
+	std::set<std::string> directories;
+	for (const auto &s : new_songs)
+		directories.insert(s.getDirectory());
+	return directories;
+}
@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_DATABASE_DIFF_H
+#define NCMPCPP_DATABASE_DIFF_H
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "song.h"
+
+/// Songs that changed between two versions of the database.
+/// Modified songs are both in removed (old version) and added
+/// (new version).
+struct DatabaseDiff
+{
+	bool empty() const { return removed.empty() && added.empty(); }
+
+	std::vector<MPD::Song> removed;
+	std::vector<MPD::Song> added;
+};
+
+/// Brings a list of songs up to date with a newer version of the database
+/// and records what changed. Songs are passed in the order they're queried:
+/// URIs of all songs in the database first, then songs modified since the
+/// previous version and finally songs from directories of new songs that
+/// were not among the modified ones (i.e. files that were moved around).
+struct DatabaseMerge
+{
+	DatabaseMerge(std::vector<MPD::Song> &songs, DatabaseDiff &diff);
+
+	/// Add a song that is in the database, it can be without metadata.
+	void addListed(MPD::Song s);
+
+	/// Add a song that was modified since the previous version.
+	void addModified(const MPD::Song &s);
+
+	/// Add a song from one of the directories of moved songs.
+	void addFromDirectory(const MPD::Song &s);
+
+	/// Replace songs with their new versions.
+	void finish();
+
+private:
+	std::vector<MPD::Song> &m_songs;
+	DatabaseDiff &m_diff;
+
+	std::unordered_map<MPD::Song, size_t, MPD::Song::Hash> m_positions;
+	std::vector<bool> m_present;
+	std::unordered_set<MPD::Song, MPD::Song::Hash> m_new_songs;
+};
+
+/// @return directories of listed songs that are neither among the known
+/// nor the modified ones, i.e. songs that were moved around without
+/// modification. Their metadata has to be fetched from these directories.
+std::set<std::string> movedSongDirectories(const std::vector<MPD::Song> &known,
+                                           const std::vector<MPD::Song> &listed,
+                                           const std::vector<MPD::Song> &modified);
+
+#endif // NCMPCPP_DATABASE_DIFF_H
@@ -0,0 +1,136 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cstdint>
+
+#include "database_format.h"
+#include "utility/binary_io.h"
+
+namespace {
+
+const char cache_magic[] = "ncmpcpp-database";
+const uint32_t cache_version = 1;
+
+// Marks the end of the list of tags of a song.
+const uint8_t end_of_tags = 0xff;
+
+}
+
+namespace DatabaseFormat {
+
+bool read(std::istream &f, std::string &server, unsigned long &db_update_time,
+          std::vector<MPD::Song> &songs)
+{
+	std::string magic;
+	uint32_t version;
+	if (!readString(f, magic) || magic != cache_magic
+	||  !readInt(f, version) || version != cache_version)
+		return false;
+
+	uint64_t update_time;
+	if (!readString(f, server) || !readInt(f, update_time))
+		return false;
+	db_update_time = update_time;
+
+	// Tags are stored as indices into this table, which makes the cache
+	// independent of the tag numbering in the installed libmpdclient.
+	uint8_t tag_count;
+	if (!readInt(f, tag_count))
+		return false;
+	std::vector<mpd_tag_type> tag_types(tag_count);
+	std::string name;
+	for (auto &type : tag_types)
+	{
+		if (!readString(f, name))
+			return false;
+		type = mpd_tag_name_parse(name.c_str());
+	}
+
+	uint32_t song_count;
+	if (!readInt(f, song_count))
+		return false;
+	songs.clear();
+	// URI length, duration, mtime and end of tags.
+	const uint64_t min_song_size = 4 + 4 + 8 + 1;
+	songs.reserve(std::min<uint64_t>(song_count, remainingSize(f) / min_song_size));
+
+	std::string uri, value;
+	MPD::Song::Builder builder;
+	for (uint32_t i = 0; i < song_count; ++i)
+	{
+		uint32_t duration;
+		int64_t mtime;
+		if (!readString(f, uri) || !readInt(f, duration) || !readInt(f, mtime))
+			return false;
+		builder.start(uri.c_str());
+		builder.setDuration(duration);
+		builder.setMTime(mtime);
+		for (;;)
+		{
+			uint8_t tag;
+			if (!readInt(f, tag))
+				return false;
+			if (tag == end_of_tags)
+				break;
+			if (tag >= tag_types.size() || !readString(f, value))
+				return false;
+			// Skip tags unknown to the installed libmpdclient.
+			if (tag_types[tag] != MPD_TAG_UNKNOWN)
+				builder.addTag(tag_types[tag], value.c_str());
+		}
+		songs.push_back(builder.finish());
+	}
+	return true;
+}
+
+void write(std::ostream &f, const std::string &server, unsigned long db_update_time,
+           const std::vector<MPD::Song> &songs)
+{
+	writeString(f, cache_magic);
+	writeInt(f, cache_version);
+	writeString(f, server.c_str());
+	writeInt(f, uint64_t(db_update_time));
+
+	writeInt(f, uint8_t(MPD_TAG_COUNT));
+	for (int tag = 0; tag < MPD_TAG_COUNT; ++tag)
+		writeString(f, mpd_tag_name(mpd_tag_type(tag)));
+
+	writeInt(f, uint32_t(songs.size()));
+	for (const auto &s : songs)
+	{
+		writeString(f, s.c_uri());
+		writeInt(f, uint32_t(s.getDuration()));
+		writeInt(f, int64_t(s.getMTime()));
+		for (int tag = 0; tag < MPD_TAG_COUNT; ++tag)
+		{
+			const char *value;
+			unsigned idx = 0;
+			while ((value = s.c_tag(mpd_tag_type(tag), idx++)) != nullptr)
+			{
+				writeInt(f, uint8_t(tag));
+				writeString(f, value);
+			}
+		}
+		writeInt(f, end_of_tags);
+	}
+}
+
+}
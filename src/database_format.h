@@ -0,0 +1,45 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_DATABASE_FORMAT_H
+#define NCMPCPP_DATABASE_FORMAT_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "song.h"
+
+/// On-disk format of the database cache.
+namespace DatabaseFormat {
+
+/// Read songs along with the server they come from and the time
+/// of the last update of its database.
+/// @return false if the data is not a valid cache.
+bool read(std::istream &f, std::string &server, unsigned long &db_update_time,
+          std::vector<MPD::Song> &songs);
+
+void write(std::ostream &f, const std::string &server, unsigned long db_update_time,
+           const std::vector<MPD::Song> &songs);
+
+}
+
+#endif // NCMPCPP_DATABASE_FORMAT_H
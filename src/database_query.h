@@ -0,0 +1,47 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_DATABASE_QUERY_H
+#define NCMPCPP_DATABASE_QUERY_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mpdpp.h"
+#include "song.h"
+
+/// Songs from MPD database that can be added to the queue or a stored
+/// playlist by the server, without fetching them first. It's either a song,
+/// a directory or all songs with given tag values.
+struct DatabaseQuery
+{
+	typedef std::vector<std::pair<mpd_tag_type, std::string>> Tags;
+
+	explicit DatabaseQuery(MPD::Song song_) : song(std::move(song_)) { }
+	explicit DatabaseQuery(std::string directory_) : directory(std::move(directory_)) { }
+	explicit DatabaseQuery(Tags tags_) : tags(std::move(tags_)) { }
+
+	MPD::Song song;
+	std::string directory;
+	Tags tags;
+};
+
+#endif // NCMPCPP_DATABASE_QUERY_H
@@ -0,0 +1,152 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include "directory_watcher.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+#include <climits>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t watch_mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                          | IN_CLOSE_WRITE | IN_ATTRIB
+                          | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+}
+
+DirectoryWatcher::DirectoryWatcher()
+: m_wd(-1)
+{
+	// If inotify is unavailable (e.g. the limit of instances is reached),
+	// nothing is watched and contents are refreshed manually.
+	m_fd = inotify_init();
+	if (m_fd < 0)
+		return;
+	fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+	fcntl(m_fd, F_SETFD, FD_CLOEXEC);
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+	if (m_fd >= 0)
+		close(m_fd);
+}
+
+bool DirectoryWatcher::watch(const std::string &directory)
+{
+	if (m_fd < 0)
+		return false;
+	if (directory == m_directory)
+		return m_wd >= 0;
+	stop();
+	m_wd = inotify_add_watch(m_fd, directory.c_str(), watch_mask);
+	if (m_wd < 0)
+		return false;
+	m_directory = directory;
+	return true;
+}
+
+void DirectoryWatcher::stop()
+{
+	if (m_wd >= 0)
+	{
+		inotify_rm_watch(m_fd, m_wd);
+		m_wd = -1;
+	}
+	m_directory.clear();
+	// Events of the previous watch are of no interest.
+	if (m_fd >= 0)
+		readEvents();
+}
+
+std::vector<DirectoryWatcher::Event> DirectoryWatcher::readEvents()
+{
+	std::vector<Event> result;
+	// Cookie and index of the last unmatched IN_MOVED_FROM event.
+	uint32_t moved_from_cookie = 0;
+	size_t moved_from = 0;
+
+	alignas(inotify_event) char buf[64 * (sizeof(inotify_event) + NAME_MAX + 1)];
+	ssize_t length;
+	while ((length = read(m_fd, buf, sizeof(buf))) > 0)
+	{
+		for (char *p = buf; p < buf + length;)
+		{
+			auto event = reinterpret_cast<const inotify_event *>(p);
+			p += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				result.push_back(Event{Event::Type::Invalidated, "", ""});
+				continue;
+			}
+			// Events of a watch that was replaced are still in the queue.
+			if (event->wd != m_wd)
+				continue;
+			if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+			{
+				result.push_back(Event{Event::Type::Invalidated, "", ""});
+				continue;
+			}
+			if (event->len == 0)
+				continue;
+
+			std::string name = event->name;
+			if (event->mask & IN_MOVED_FROM)
+			{
+				result.push_back(Event{Event::Type::Removed, std::move(name), ""});
+				moved_from_cookie = event->cookie;
+				moved_from = result.size() - 1;
+			}
+			else if (event->mask & IN_MOVED_TO)
+			{
+				if (moved_from_cookie != 0 && moved_from_cookie == event->cookie)
+				{
+					auto &renamed = result[moved_from];
+					renamed.type = Event::Type::Renamed;
+					renamed.old_name = std::move(renamed.name);
+					renamed.name = std::move(name);
+					moved_from_cookie = 0;
+				}
+				else
+					result.push_back(Event{Event::Type::Created, std::move(name), ""});
+			}
+			else if (event->mask & IN_CREATE)
+				result.push_back(Event{Event::Type::Created, std::move(name), ""});
+			else if (event->mask & IN_DELETE)
+				result.push_back(Event{Event::Type::Removed, std::move(name), ""});
+			else if (event->mask & (IN_CLOSE_WRITE | IN_ATTRIB))
+			{
+				// Writing a file usually generates a few of these in a row.
+				if (result.empty()
+				||  result.back().type != Event::Type::Modified
+				||  result.back().name != name)
+					result.push_back(Event{Event::Type::Modified, std::move(name), ""});
+			}
+		}
+	}
+	return result;
+}
+
+#endif // HAVE_SYS_INOTIFY_H
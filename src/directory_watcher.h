@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_DIRECTORY_WATCHER_H
+#define NCMPCPP_DIRECTORY_WATCHER_H
+
+#include "config.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+#include <string>
+#include <vector>
+
+/// Watches entries of a local directory for changes using inotify.
+struct DirectoryWatcher
+{
+	struct Event
+	{
+		enum class Type { Created, Removed, Renamed, Modified, Invalidated };
+
+		Type type;
+		/// Name of the entry (new name if it was renamed).
+		std::string name;
+		/// Old name of a renamed entry.
+		std::string old_name;
+	};
+
+	DirectoryWatcher();
+	~DirectoryWatcher();
+
+	DirectoryWatcher(const DirectoryWatcher &) = delete;
+	DirectoryWatcher &operator=(const DirectoryWatcher &) = delete;
+
+	/// @return descriptor that becomes readable when there are events
+	/// or -1 if inotify couldn't be initialized.
+	int GetFD() const { return m_fd; }
+
+	/// Watch a given directory instead of the current one.
+	/// @return false if the directory couldn't be watched.
+	bool watch(const std::string &directory);
+
+	/// Stop watching the current directory.
+	void stop();
+
+	/// @return directory that is being watched (empty if none).
+	const std::string &directory() const { return m_directory; }
+
+	/// Read events that are waiting. Entries moved within the directory are
+	/// reported as renamed. If events were lost (or the directory itself was
+	/// removed), Invalidated is reported and contents need to be read again.
+	std::vector<Event> readEvents();
+
+private:
+	int m_fd;
+	int m_wd;
+	std::string m_directory;
+};
+
+#endif // HAVE_SYS_INOTIFY_H
+
+#endif // NCMPCPP_DIRECTORY_WATCHER_H
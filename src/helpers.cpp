@@ -19,6 +19,7 @@
  ***************************************************************************/
 
 #include <algorithm>
+#include <cassert>
 #include <boost/range/adaptor/reversed.hpp>
 #include <time.h>
 
@@ -28,6 +29,7 @@
 #include "screens/playlist.h"
 #include "statusbar.h"
 #include "utility/functional.h"
+#include "utility/reorder_plan.h"
 
 const MPD::Song *currentSong(const BaseScreen *screen)
 {
@@ -42,38 +44,37 @@ const MPD::Song *currentSong(const BaseScreen *screen)
 	return ptr;
 }
 
-MPD::SongIterator getDatabaseIterator(MPD::Connection &mpd)
+bool takeFetchedSongs(MPD::SongListFuture &fetch, std::vector<MPD::Song> &songs)
 {
-	MPD::SongIterator result;
+	if (!fetch.valid() || !fetch.is_ready())
+		return false;
 	try
 	{
-		result = mpd.GetDirectoryRecursive("/");
+		songs = fetch.get();
 	}
 	catch (MPD::ClientError &e)
 	{
-		if (e.code() == MPD_ERROR_CLOSED)
-		{
-			// If we can't get the database, display appropriate
-			// error message and reconnect with the MPD server.
-			Statusbar::print("Unable to fetch the data, increase max_output_buffer_size in your MPD configuration file");
-			mpd.Disconnect();
-			mpd.Connect();
-		}
-		else
-			throw;
+		// The additional connection is already dropped if the
+		// error was fatal, it'll reconnect with the next request.
+		Statusbar::printf("ncmpcpp: %1%", e.what());
 	}
 	catch (MPD::ServerError &e)
 	{
-		// mopidy blacklists 'listallinfo' command by default and throws server
-		// error when it receives it. Work around that to prevent ncmpcpp from
-		// continuously retrying to send the command and looping.
-		if (strstr(e.what(), "listallinfo") != nullptr
-		    && strstr(e.what(), "disabled") != nullptr)
-			Statusbar::print("Unable to fetch the data, server refused to process 'listallinfo' command");
-		else
-			throw;
+		Status::handleServerError(e);
 	}
-	return result;
+	fetch = MPD::SongListFuture();
+	return true;
+}
+
+std::function<void()> redrawWhenVisible(BaseScreen *screen)
+{
+	return [screen] {
+		if (isVisible(screen))
+		{
+			screen->update();
+			screen->refresh();
+		}
+	};
 }
 
 void removeSongFromPlaylist(const SongMenu &playlist, const MPD::Song &s)
@@ -118,6 +119,208 @@ bool addSongToPlaylist(const MPD::Song &s, bool play, int position)
 	return result;
 }
 
+void replaceUpdatedSongs(NC::Menu<MPD::Song> &menu, const SongStore::SongSet &updated)
+{
+	ScopedUnfilteredMenu<MPD::Song> sunfilter(ReapplyFilter::Yes, menu);
+	for (auto &item : menu)
+	{
+		auto it = updated.find(item.value());
+		if (it != updated.end())
+			item.value() = *it;
+	}
+}
+
+std::vector<MPD::Song> getQueriedSongs(const std::vector<DatabaseQuery> &queries)
+{
+	std::vector<MPD::Song> result;
+	for (const auto &query : queries)
+	{
+		if (!query.song.empty())
+			result.push_back(query.song);
+		else if (!query.directory.empty())
+		{
+			std::copy(
+				std::make_move_iterator(Mpd.GetDirectoryRecursive(query.directory)),
+				std::make_move_iterator(MPD::SongIterator()),
+				std::back_inserter(result));
+		}
+		else
+		{
+			Mpd.StartSearch(true);
+			for (const auto &tag : query.tags)
+				Mpd.AddSearch(tag.first, tag.second);
+			std::copy(
+				std::make_move_iterator(Mpd.CommitSearchSongs()),
+				std::make_move_iterator(MPD::SongIterator()),
+				std::back_inserter(result));
+		}
+	}
+	return result;
+}
+
+bool addQueriesToPlaylist(const std::vector<DatabaseQuery> &queries, bool play, int position)
+{
+	if (position >= 0 && !Mpd.SupportsAddPosition())
+	{
+		auto songs = getQueriedSongs(queries);
+		return addSongsToPlaylist(songs.begin(), songs.end(), play, position);
+	}
+
+	bool result = true;
+	unsigned first_position = position >= 0 ? position : Status::State::playlistLength();
+	auto add = [&](const DatabaseQuery &query) {
+		try
+		{
+			if (!query.song.empty())
+				Mpd.AddSong(query.song, position);
+			else if (!query.directory.empty())
+			{
+				if (position >= 0)
+					Mpd.Add(query.directory, position);
+				else
+					Mpd.Add(query.directory);
+			}
+			else
+			{
+				Mpd.StartSearchAdd(true);
+				for (const auto &tag : query.tags)
+					Mpd.AddSearch(tag.first, tag.second);
+				if (position >= 0)
+					Mpd.AddSearchPosition(position);
+				Mpd.CommitSearchAdd();
+			}
+		}
+		catch (MPD::ServerError &e)
+		{
+			Status::handleServerError(e);
+			result = false;
+		}
+	};
+	// Inserting at the same position from the last query keeps their order.
+	if (position >= 0)
+		std::for_each(queries.rbegin(), queries.rend(), add);
+	else
+		std::for_each(queries.begin(), queries.end(), add);
+
+	if (play)
+	{
+		// We don't know ids of added songs, but we know where they start.
+		try
+		{
+			Mpd.Play(first_position);
+		}
+		catch (MPD::ServerError &e)
+		{
+			// If not bad index (nothing was added), rethrow.
+			if (e.code() != MPD_SERVER_ERROR_ARG)
+				throw;
+		}
+	}
+	return result;
+}
+
+namespace {
+
+// Filter expression matching songs with exactly the given tags.
+std::string filterExpression(const DatabaseQuery::Tags &tags)
+{
+	std::string result = "(";
+	for (const auto &tag : tags)
+	{
+		if (result.size() > 1)
+			result += " AND ";
+		result += "(";
+		result += mpd_tag_name(tag.first);
+		result += " == \"";
+		for (char c : tag.second)
+		{
+			if (c == '"' || c == '\\')
+				result += '\\';
+			result += c;
+		}
+		result += "\")";
+	}
+	result += ")";
+	return result;
+}
+
+}
+
+void addQueriesToStoredPlaylist(const std::vector<DatabaseQuery> &queries,
+                                const std::string &playlist)
+{
+	// Plain tag constraints of searchaddpl match substrings, so the server
+	// can add songs on its own only if it understands filter expressions.
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 17, 0)
+	if (Mpd.Version() >= 21)
+	{
+		Mpd.StartCommandsList();
+		for (const auto &query : queries)
+		{
+			if (!query.song.empty())
+				Mpd.AddToPlaylist(playlist, query.song);
+			else if (!query.directory.empty())
+				Mpd.AddToPlaylist(playlist, query.directory);
+			else
+			{
+				Mpd.StartSearchAddToPlaylist(playlist);
+				Mpd.AddSearchExpression(filterExpression(query.tags));
+				Mpd.CommitSearchAdd();
+			}
+		}
+		Mpd.CommitCommandsList();
+		return;
+	}
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+	auto songs = getQueriedSongs(queries);
+	Mpd.StartCommandsList();
+	for (const auto &s : songs)
+		Mpd.AddToPlaylist(playlist, s);
+	Mpd.CommitCommandsList();
+}
+
+PositionRanges collapseToRanges(const std::vector<unsigned> &positions)
+{
+	PositionRanges result;
+	for (auto pos : positions)
+	{
+		if (!result.empty() && result.back().second == pos)
+			++result.back().second;
+		else
+			result.emplace_back(pos, pos+1);
+	}
+	return result;
+}
+
+size_t reorderQueue(const std::vector<unsigned> &positions,
+                    const std::vector<size_t> &order)
+{
+	assert(positions.size() == order.size());
+	if (positions.empty())
+		return 0;
+
+	// Plan the permutation of the whole span, songs that are not a part of
+	// the range stay in place.
+	unsigned start = positions.front();
+	std::vector<size_t> span(positions.back() - start + 1);
+	for (size_t i = 0; i < span.size(); ++i)
+		span[i] = i;
+	for (size_t i = 0; i < order.size(); ++i)
+		span[positions[i] - start] = positions[order[i]] - start;
+	auto plan = planReorder(span);
+
+	sendInCommandLists(plan.size(), [&plan, start](size_t i) {
+		const auto &step = plan[i];
+		if (step.swap)
+			Mpd.Swap(start + step.start, start + step.to);
+		else if (step.end - step.start == 1)
+			Mpd.Move(start + step.start, start + step.to);
+		else
+			Mpd.MoveRange(start + step.start, start + step.end, start + step.to);
+	});
+	return plan.size();
+}
+
 std::string timeFormat(const char *format, time_t t)
 {
 	char result[32];
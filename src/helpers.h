@@ -21,12 +21,15 @@
 #ifndef NCMPCPP_HELPERS_H
 #define NCMPCPP_HELPERS_H
 
+#include "database_query.h"
 #include "interfaces.h"
 #include "mpdpp.h"
+#include "mpdpp_async.h"
 #include "screens/playlist.h"
 #include "screens/screen.h"
 #include "settings.h"
 #include "song_list.h"
+#include "song_store.h"
 #include "status.h"
 #include "utility/string.h"
 #include "utility/type_conversions.h"
@@ -218,6 +221,30 @@ std::vector<Iterator> getSelectedOrCurrent(Iterator first, Iterator last, Iterat
 	return result;
 }
 
+/// Ranges [first, second) of positions in a list.
+typedef std::vector<std::pair<unsigned, unsigned>> PositionRanges;
+
+/// Collapse positions in ascending order into ranges of consecutive ones.
+PositionRanges collapseToRanges(const std::vector<unsigned> &positions);
+
+/// Maximum number of commands sent to MPD in a single command list.
+const size_t MaxCommandListSize = 5000;
+
+/// Call send(i) for each i in [0, count) within command lists of bounded
+/// size, so that the server doesn't reject them.
+template <typename F>
+void sendInCommandLists(size_t count, F send)
+{
+	for (size_t i = 0; i < count; i += MaxCommandListSize)
+	{
+		Mpd.StartCommandsList();
+		size_t end = std::min(i + MaxCommandListSize, count);
+		for (size_t j = i; j < end; ++j)
+			send(j);
+		Mpd.CommitCommandsList();
+	}
+}
+
 template <typename Iterator>
 void reverseSelectionHelper(Iterator first, Iterator last)
 {
@@ -310,14 +337,21 @@ void moveSelectedItemsTo(NC::Menu<MPD::Song> &menu, F &&move_fun)
 	if (pos >= (list.front() - begin) && pos <= (list.back() - begin))
 		return;
 	int diff = pos - (list.front() - begin);
-	Mpd.StartCommandsList();
+	// Blocks of adjacent items are moved with a single command.
+	std::vector<unsigned> positions;
+	positions.reserve(list.size());
+	for (auto it = list.begin(); it != list.end(); ++it)
+		positions.push_back(*it - begin);
+	auto ranges = collapseToRanges(positions);
 	if (diff > 0) // move down
 	{
 		pos -= list.size();
-		size_t i = list.size()-1;
-		for (auto it = list.rbegin(); it != list.rend(); ++it, --i)
-			move_fun(&Mpd, *it - begin, pos+i);
-		Mpd.CommitCommandsList();
+		size_t i = list.size();
+		sendInCommandLists(ranges.size(), [&](size_t j) {
+			const auto &range = ranges[ranges.size()-j-1];
+			i -= range.second - range.first;
+			move_fun(&Mpd, range.first, range.second, pos+i);
+		});
 		i = list.size()-1;
 		for (auto it = list.rbegin(); it != list.rend(); ++it, --i)
 		{
@@ -328,9 +362,11 @@ void moveSelectedItemsTo(NC::Menu<MPD::Song> &menu, F &&move_fun)
 	else if (diff < 0) // move up
 	{
 		size_t i = 0;
-		for (auto it = list.begin(); it != list.end(); ++it, ++i)
-			move_fun(&Mpd, *it - begin, pos+i);
-		Mpd.CommitCommandsList();
+		sendInCommandLists(ranges.size(), [&](size_t j) {
+			const auto &range = ranges[j];
+			move_fun(&Mpd, range.first, range.second, pos+i);
+			i += range.second - range.first;
+		});
 		i = 0;
 		for (auto it = list.begin(); it != list.end(); ++it, ++i)
 		{
@@ -360,7 +396,7 @@ void deleteSelectedSongs(NC::Menu<MPD::Song> &menu, F &&delete_fun)
 	};
 	// get iterator to filtered range
 	auto cur_filtered = menu.rbegin();
-	Mpd.StartCommandsList();
+	std::vector<unsigned> positions;
 	for (auto it = real_begin; it != real_end; ++it)
 	{
 		// current iterator belongs to filtered range, proceed
@@ -369,12 +405,19 @@ void deleteSelectedSongs(NC::Menu<MPD::Song> &menu, F &&delete_fun)
 			if (it->isSelected())
 			{
 				it->setSelected(false);
-				delete_fun(Mpd, it.base() - begin);
+				positions.push_back(it.base() - begin);
 			}
 			++cur_filtered;
 		}
 	}
-	Mpd.CommitCommandsList();
+	// Delete blocks of adjacent songs with single commands, starting from the
+	// last one so that positions of the rest stay valid.
+	std::reverse(positions.begin(), positions.end());
+	auto ranges = collapseToRanges(positions);
+	sendInCommandLists(ranges.size(), [&](size_t i) {
+		const auto &range = ranges[ranges.size()-i-1];
+		delete_fun(Mpd, range.first, range.second);
+	});
 }
 
 template <typename F>
@@ -530,9 +573,40 @@ inline const char *withErrors(bool success)
 
 bool addSongToPlaylist(const MPD::Song &s, bool play, int position = -1);
 
+/// Replace songs in a menu with their new versions from the song store.
+void replaceUpdatedSongs(NC::Menu<MPD::Song> &menu, const SongStore::SongSet &updated);
+
+/// Fetch songs matching the queries (in the order the server would add them).
+std::vector<MPD::Song> getQueriedSongs(const std::vector<DatabaseQuery> &queries);
+
+/// Add songs matching the queries to the queue at given position (or at the
+/// end if it's -1). If the server can't insert them at a position on its own,
+/// they are fetched and added one by one.
+bool addQueriesToPlaylist(const std::vector<DatabaseQuery> &queries, bool play, int position);
+
+/// Add songs matching the queries to a stored playlist. Tag queries are
+/// resolved by the server if it supports filter expressions (MPD >= 0.21),
+/// otherwise all songs are fetched and added one by one.
+void addQueriesToStoredPlaylist(const std::vector<DatabaseQuery> &queries,
+                                const std::string &playlist);
+
+/// Rearrange songs at given positions of the queue (in ascending order) so
+/// that the one at positions[order[i]] ends up at positions[i], sending as
+/// few commands as possible. Songs in between are left where they are.
+/// @return number of commands sent.
+size_t reorderQueue(const std::vector<unsigned> &positions,
+                    const std::vector<size_t> &order);
+
 const MPD::Song *currentSong(const BaseScreen *screen);
 
-MPD::SongIterator getDatabaseIterator(MPD::Connection &mpd);
+/// Take songs fetched through the additional connection if they already
+/// arrived. Failures are reported in the statusbar.
+/// @return true if fetching is finished.
+bool takeFetchedSongs(MPD::SongListFuture &fetch, std::vector<MPD::Song> &songs);
+
+/// @return completion handler that updates and redraws
+/// a screen if it's visible.
+std::function<void()> redrawWhenVisible(BaseScreen *screen);
 
 std::string timeFormat(const char *format, time_t t);
 
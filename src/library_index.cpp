@@ -0,0 +1,169 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+
+#include "library_index.h"
+
+namespace {
+
+void addSong(LibraryIndex::Album &album, const MPD::Song &s)
+{
+	album.mtime = std::max(album.mtime, s.getMTime());
+	album.songs.push_back(s);
+}
+
+// @return true if the song was in the album.
+bool removeSong(LibraryIndex::Album &album, const MPD::Song &s)
+{
+	auto it = std::find(album.songs.begin(), album.songs.end(), s);
+	if (it == album.songs.end())
+		return false;
+	album.songs.erase(it);
+	album.mtime = 0;
+	for (const auto &song : album.songs)
+		album.mtime = std::max(album.mtime, song.getMTime());
+	return true;
+}
+
+}
+
+LibraryIndex::LibraryIndex()
+: m_primary_tag(MPD_TAG_UNKNOWN), m_split_by_date(false)
+{ }
+
+void LibraryIndex::build(const std::vector<MPD::Song> &songs,
+                         mpd_tag_type primary_tag, bool split_by_date)
+{
+	m_primary_tag = primary_tag;
+	m_split_by_date = split_by_date;
+	m_tags.clear();
+	m_albums.clear();
+	for (const auto &s : songs)
+		add(s);
+}
+
+void LibraryIndex::update(const std::vector<MPD::Song> &removed,
+                          const std::vector<MPD::Song> &added)
+{
+	for (const auto &s : removed)
+		remove(s);
+	for (const auto &s : added)
+		add(s);
+}
+
+LibraryIndex::AlbumKey LibraryIndex::albumKey(const MPD::Song &s) const
+{
+	return AlbumKey(s.getAlbum(), m_split_by_date ? s.getDate() : "");
+}
+
+const LibraryIndex::Tag *LibraryIndex::tag(const std::string &name) const
+{
+	auto it = m_tags.find(name);
+	return it != m_tags.end() ? &it->second : nullptr;
+}
+
+const LibraryIndex::Album *LibraryIndex::album(const std::string &tag,
+                                               const AlbumKey &key) const
+{
+	auto t = this->tag(tag);
+	if (t == nullptr)
+		return nullptr;
+	auto it = t->albums.find(key);
+	return it != t->albums.end() ? &it->second : nullptr;
+}
+
+const LibraryIndex::Album *LibraryIndex::album(const std::string &name) const
+{
+	auto it = m_albums.find(name);
+	return it != m_albums.end() ? &it->second : nullptr;
+}
+
+std::vector<MPD::Song> LibraryIndex::songs(const std::string &tag) const
+{
+	std::vector<MPD::Song> result;
+	auto t = this->tag(tag);
+	if (t != nullptr)
+	{
+		result.reserve(t->song_count);
+		for (const auto &album : t->albums)
+			result.insert(result.end(), album.second.songs.begin(), album.second.songs.end());
+	}
+	return result;
+}
+
+/**********************************************************************/
+
+template <typename F>
+void LibraryIndex::forEachPrimaryTag(const MPD::Song &s, F f) const
+{
+	const char *tag;
+	for (unsigned idx = 0; (tag = s.c_tag(m_primary_tag, idx)) != nullptr; ++idx)
+	{
+		// Songs are listed only once under repeated values.
+		bool repeated = false;
+		for (unsigned i = 0; i < idx && !repeated; ++i)
+			repeated = strcmp(s.c_tag(m_primary_tag, i), tag) == 0;
+		if (!repeated && *tag != '\0')
+			f(tag);
+	}
+}
+
+void LibraryIndex::add(const MPD::Song &s)
+{
+	auto key = albumKey(s);
+	forEachPrimaryTag(s, [&](const char *name) {
+		auto &tag = m_tags[name];
+		tag.mtime = std::max(tag.mtime, s.getMTime());
+		++tag.song_count;
+		addSong(tag.albums[key], s);
+	});
+	addSong(m_albums[key.first], s);
+}
+
+void LibraryIndex::remove(const MPD::Song &s)
+{
+	auto key = albumKey(s);
+	forEachPrimaryTag(s, [&](const char *name) {
+		auto t = m_tags.find(name);
+		if (t == m_tags.end())
+			return;
+		auto &tag = t->second;
+		auto album = tag.albums.find(key);
+		if (album == tag.albums.end() || !removeSong(album->second, s))
+			return;
+		--tag.song_count;
+		if (album->second.songs.empty())
+			tag.albums.erase(album);
+		if (tag.albums.empty())
+			m_tags.erase(t);
+		else
+		{
+			tag.mtime = 0;
+			for (const auto &a : tag.albums)
+				tag.mtime = std::max(tag.mtime, a.second.mtime);
+		}
+	});
+	auto album = m_albums.find(key.first);
+	if (album != m_albums.end() && removeSong(album->second, s)
+	&&  album->second.songs.empty())
+		m_albums.erase(album);
+}
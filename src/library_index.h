@@ -0,0 +1,105 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_LIBRARY_INDEX_H
+#define NCMPCPP_LIBRARY_INDEX_H
+
+#include <boost/functional/hash.hpp>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "song.h"
+
+/// Hierarchy of the media library (primary tag, album, songs) built from
+/// the database in a single pass, so that all of its columns can be filled
+/// without asking the server.
+struct LibraryIndex
+{
+	/// Album and its date (empty unless albums are split by date).
+	typedef std::pair<std::string, std::string> AlbumKey;
+
+	struct Album
+	{
+		Album() : mtime(0) { }
+
+		/// Modification time of the newest song.
+		time_t mtime;
+		std::vector<MPD::Song> songs;
+	};
+
+	struct Tag
+	{
+		Tag() : mtime(0), song_count(0) { }
+
+		/// Modification time of the newest song.
+		time_t mtime;
+		size_t song_count;
+		std::unordered_map<AlbumKey, Album, boost::hash<AlbumKey>> albums;
+	};
+
+	typedef std::unordered_map<std::string, Tag> TagMap;
+	typedef std::unordered_map<std::string, Album> AlbumMap;
+
+	LibraryIndex();
+
+	void build(const std::vector<MPD::Song> &songs, mpd_tag_type primary_tag,
+	           bool split_by_date);
+
+	/// Apply changes of the database. Modified songs are both in removed
+	/// (old version) and added (new version).
+	void update(const std::vector<MPD::Song> &removed,
+	            const std::vector<MPD::Song> &added);
+
+	bool empty() const { return m_albums.empty(); }
+
+	mpd_tag_type primaryTag() const { return m_primary_tag; }
+
+	AlbumKey albumKey(const MPD::Song &s) const;
+
+	/// @return songs grouped by values of the primary tag and then albums.
+	const TagMap &tags() const { return m_tags; }
+
+	/// @return songs grouped by albums, regardless of the primary tag.
+	const AlbumMap &albums() const { return m_albums; }
+
+	const Tag *tag(const std::string &name) const;
+	const Album *album(const std::string &tag, const AlbumKey &key) const;
+	const Album *album(const std::string &name) const;
+
+	/// @return all songs with a given value of the primary tag.
+	std::vector<MPD::Song> songs(const std::string &tag) const;
+
+private:
+	template <typename F>
+	void forEachPrimaryTag(const MPD::Song &s, F f) const;
+
+	void add(const MPD::Song &s);
+	void remove(const MPD::Song &s);
+
+	mpd_tag_type m_primary_tag;
+	bool m_split_by_date;
+
+	TagMap m_tags;
+	AlbumMap m_albums;
+};
+
+#endif // NCMPCPP_LIBRARY_INDEX_H
@@ -0,0 +1,312 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <memory>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <thread>
+
+#include "helpers.h"
+#include "local_directory.h"
+#include "settings.h"
+#include "tag_cache.h"
+#include "tags.h"
+#include "utility/comparators.h"
+#include "utility/work_stealing_pool.h"
+
+namespace {
+
+const size_t max_threads = 8;
+
+#ifdef HAVE_TAGLIB_H
+const bool read_tags = true;
+typedef Tags::Attributes Attributes;
+#else
+const bool read_tags = false;
+typedef std::vector<std::pair<std::string, std::string>> Attributes;
+#endif // HAVE_TAGLIB_H
+
+size_t threadCount(size_t tasks)
+{
+	size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 4);
+	return std::max<size_t>(std::min({threads, max_threads, tasks}), 1);
+}
+
+struct Directory
+{
+	Directory(const std::string &path)
+	: m_path(path), m_dir(opendir(path.c_str()))
+	{
+		if (m_dir == nullptr)
+			throw boost::filesystem::filesystem_error(
+				"couldn't open directory", path,
+				boost::system::error_code(errno, boost::system::system_category()));
+	}
+	~Directory()
+	{
+		closedir(m_dir);
+	}
+
+	Directory(const Directory &) = delete;
+	Directory &operator=(const Directory &) = delete;
+
+	int fd() const { return dirfd(m_dir); }
+
+	/// @return full path of an entry.
+	std::string path(const char *name) const
+	{
+		std::string result = m_path;
+		if (result.empty() || result.back() != '/')
+			result += '/';
+		result += name;
+		return result;
+	}
+
+	/// Read the next entry, skipping hidden ones if that's configured.
+	const dirent *next()
+	{
+		const dirent *entry;
+		while ((entry = readdir(m_dir)) != nullptr)
+		{
+			if (entry->d_name[0] != '.')
+				break;
+			if (Config.local_browser_show_hidden_files
+			&&  strcmp(entry->d_name, ".") != 0
+			&&  strcmp(entry->d_name, "..") != 0)
+				break;
+		}
+		return entry;
+	}
+
+private:
+	std::string m_path;
+	DIR *m_dir;
+};
+
+enum class EntryType { Directory, File, Unknown };
+
+EntryType entryType(const dirent *entry)
+{
+	// Symbolic links need to be followed, so their type is unknown.
+	switch (entry->d_type)
+	{
+		case DT_DIR:
+			return EntryType::Directory;
+		case DT_REG:
+			return EntryType::File;
+		default:
+			return EntryType::Unknown;
+	}
+}
+
+void readTags(Attributes &tags, const std::string &path, const struct stat &st)
+{
+#	ifdef HAVE_TAGLIB_H
+	if (!TagCache.get(path, st.st_size, st.st_mtime, tags))
+	{
+		tags = Tags::read(path);
+		TagCache.put(path, st.st_size, st.st_mtime, tags);
+	}
+#	endif // HAVE_TAGLIB_H
+}
+
+MPD::Song makeSong(const std::string &path, time_t mtime, const Attributes &tags)
+{
+	mpd_pair pair = { "file", path.c_str() };
+	mpd_song *s = mpd_song_begin(&pair);
+	if (s == nullptr)
+		throw std::runtime_error("invalid path: " + path);
+#	ifdef HAVE_TAGLIB_H
+	if (read_tags)
+	{
+		Tags::setAttribute(s, "Last-Modified", timeFormat("%Y-%m-%dT%H:%M:%SZ", mtime));
+		for (const auto &tag : tags)
+			Tags::setAttribute(s, tag.first.c_str(), tag.second);
+	}
+#	endif // HAVE_TAGLIB_H
+	return s;
+}
+
+struct Node
+{
+	std::string path;
+	std::vector<std::unique_ptr<Node>> subdirectories;
+	std::vector<std::string> songs;
+};
+
+void scan(WorkStealingPool &pool, Node &node, const LocalDirectory::SongFilter &is_song)
+{
+	Directory dir(node.path);
+	while (auto entry = dir.next())
+	{
+		auto type = entryType(entry);
+		if (type == EntryType::Unknown)
+		{
+			struct stat st;
+			if (fstatat(dir.fd(), entry->d_name, &st, 0) != 0)
+				continue;
+			type = S_ISDIR(st.st_mode) ? EntryType::Directory : EntryType::File;
+		}
+		if (type == EntryType::Directory)
+		{
+			node.subdirectories.emplace_back(new Node);
+			auto &subdirectory = *node.subdirectories.back();
+			subdirectory.path = dir.path(entry->d_name);
+			pool.push([&pool, &subdirectory, &is_song] {
+				scan(pool, subdirectory, is_song);
+			});
+		}
+		else if (is_song(entry->d_name))
+			node.songs.push_back(dir.path(entry->d_name));
+	}
+}
+
+void collect(std::vector<MPD::Song> &songs, Node &node)
+{
+	std::sort(node.subdirectories.begin(), node.subdirectories.end(),
+		[](const std::unique_ptr<Node> &a, const std::unique_ptr<Node> &b) {
+			return a->path < b->path;
+	});
+	for (auto &subdirectory : node.subdirectories)
+		collect(songs, *subdirectory);
+
+	size_t sort_offset = songs.size();
+	for (const auto &path : node.songs)
+	{
+		mpd_pair pair = { "file", path.c_str() };
+		mpd_song *s = mpd_song_begin(&pair);
+		if (s == nullptr)
+			throw std::runtime_error("invalid path: " + path);
+		songs.push_back(s);
+	}
+	if (Config.browser_sort_mode != SortMode::NoOp)
+	{
+		sortByKey(songs.begin()+sort_offset, songs.end(),
+			LocaleBasedSortKeys(std::locale(), Config.ignore_leading_the)
+		);
+	}
+}
+
+}
+
+namespace LocalDirectory {
+
+std::vector<MPD::Item> list(const std::string &directory, const SongFilter &is_song)
+{
+	struct Entry
+	{
+		std::string name;
+		EntryType type;
+		bool valid;
+		time_t mtime;
+		Attributes tags;
+	};
+
+	Directory dir(directory);
+	std::vector<Entry> entries;
+	while (auto entry = dir.next())
+		entries.push_back(Entry{entry->d_name, entryType(entry), true, 0, {}});
+
+	// Directories need their modification time and songs, if their tags are
+	// read, also their size to be looked up in the tag cache.
+	WorkStealingPool pool(threadCount(entries.size()));
+	for (auto &entry : entries)
+	{
+		if (entry.type == EntryType::File)
+		{
+			entry.valid = is_song(entry.name);
+			if (!entry.valid || !read_tags)
+				continue;
+		}
+		pool.push([&dir, &entry, &is_song] {
+			struct stat st;
+			if (fstatat(dir.fd(), entry.name.c_str(), &st, 0) != 0)
+			{
+				entry.valid = false;
+				return;
+			}
+			entry.mtime = st.st_mtime;
+			if (S_ISDIR(st.st_mode))
+			{
+				entry.type = EntryType::Directory;
+				return;
+			}
+			entry.type = EntryType::File;
+			entry.valid = is_song(entry.name);
+			if (entry.valid && read_tags)
+				readTags(entry.tags, dir.path(entry.name.c_str()), st);
+		});
+	}
+	pool.run();
+
+	std::vector<MPD::Item> result;
+	result.reserve(entries.size());
+	for (const auto &entry : entries)
+	{
+		if (!entry.valid)
+			continue;
+		auto path = dir.path(entry.name.c_str());
+		if (entry.type == EntryType::Directory)
+		{
+			result.push_back(MPD::Directory(std::move(path), entry.mtime));
+			continue;
+		}
+		result.push_back(makeSong(path, entry.mtime, entry.tags));
+	}
+	return result;
+}
+
+boost::optional<MPD::Item> get(const std::string &path, const SongFilter &is_song)
+{
+	boost::optional<MPD::Item> result;
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+		return result;
+	if (S_ISDIR(st.st_mode))
+		result = MPD::Item(MPD::Directory(path, st.st_mtime));
+	else if (is_song(getBasename(path)))
+	{
+		Attributes tags;
+		if (read_tags)
+			readTags(tags, path, st);
+		result = MPD::Item(makeSong(path, st.st_mtime, tags));
+	}
+	return result;
+}
+
+void listRecursively(std::vector<MPD::Song> &songs, const std::string &directory,
+                     const SongFilter &is_song)
+{
+	Node root;
+	root.path = directory;
+	WorkStealingPool pool(threadCount(max_threads));
+	pool.push([&pool, &root, &is_song] {
+		scan(pool, root, is_song);
+	});
+	pool.run();
+	collect(songs, root);
+}
+
+}
@@ -0,0 +1,56 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_LOCAL_DIRECTORY_H
+#define NCMPCPP_LOCAL_DIRECTORY_H
+
+#include <boost/optional.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "mpdpp.h"
+#include "song.h"
+
+/// Listing of directories of the local filesystem. Work is spread among
+/// several threads as stats and tag reads are what takes the most time,
+/// especially on network filesystems. Entry types are taken from readdir
+/// wherever the filesystem reports them, so entries need at most a single
+/// stat, and tags are read through TagCache.
+namespace LocalDirectory {
+
+/// @return true if a file with a given name is a song.
+typedef std::function<bool(const std::string &)> SongFilter;
+
+/// @return subdirectories and songs in a directory, the latter with tags.
+std::vector<MPD::Item> list(const std::string &directory, const SongFilter &is_song);
+
+/// @return directory or song at a given path, if there is one.
+boost::optional<MPD::Item> get(const std::string &path, const SongFilter &is_song);
+
+/// Append songs in a directory and all its subdirectories (without tags)
+/// to a list. Contents of subdirectories come before songs of the directory
+/// itself. Songs of each directory are sorted according to browser sort mode.
+void listRecursively(std::vector<MPD::Song> &songs, const std::string &directory,
+                     const SongFilter &is_song);
+
+}
+
+#endif // NCMPCPP_LOCAL_DIRECTORY_H
@@ -70,7 +70,8 @@ std::istream &operator>>(std::istream &is, LyricsFetcher_ &fetcher)
 const char LyricsFetcher::msgNotFound[] = "Not found";
 
 LyricsFetcher::Result LyricsFetcher::fetch(const std::string &artist,
-                                           const std::string &title)
+                                           const std::string &title,
+                                           const std::atomic<bool> *stopper)
 {
 	Result result;
 	result.first = false;
@@ -80,7 +81,7 @@ LyricsFetcher::Result LyricsFetcher::fetch(const std::string &artist,
 	boost::replace_all(url, "%title%", Curl::escape(title));
 	
 	std::string data;
-	CURLcode code = Curl::perform(data, url, "", true);
+	CURLcode code = Curl::perform(data, url, "", true, 10, stopper);
 	
 	if (code != CURLE_OK)
 	{
@@ -113,6 +114,21 @@ LyricsFetcher::Result LyricsFetcher::fetch(const std::string &artist,
 	return result;
 }
 
+void LyricsFetcher::recordFetch(bool success, std::chrono::milliseconds time)
+{
+	std::lock_guard<std::mutex> lock(m_stats_mutex);
+	++m_stats.attempts;
+	if (success)
+		++m_stats.successes;
+	m_stats.total_time += time;
+}
+
+LyricsFetcher::Stats LyricsFetcher::stats() const
+{
+	std::lock_guard<std::mutex> lock(m_stats_mutex);
+	return m_stats;
+}
+
 std::vector<std::string> LyricsFetcher::getContent(const char *regex_,
                                                    const std::string &data)
 {
@@ -149,15 +165,16 @@ void LyricsFetcher::postProcess(std::string &data) const
 /***********************************************************************/
 
 LyricsFetcher::Result LyricwikiFetcher::fetch(const std::string &artist,
-                                              const std::string &title)
+                                              const std::string &title,
+                                              const std::atomic<bool> *stopper)
 {
-	LyricsFetcher::Result result = LyricsFetcher::fetch(artist, title);
+	LyricsFetcher::Result result = LyricsFetcher::fetch(artist, title, stopper);
 	if (result.first == true)
 	{
 		result.first = false;
 		
 		std::string data;
-		CURLcode code = Curl::perform(data, result.second, "", true);
+		CURLcode code = Curl::perform(data, result.second, "", true, 10, stopper);
 		
 		if (code != CURLE_OK)
 		{
@@ -209,7 +226,8 @@ bool LyricwikiFetcher::notLyrics(const std::string &data) const
 /**********************************************************************/
 
 LyricsFetcher::Result GoogleLyricsFetcher::fetch(const std::string &artist,
-                                                 const std::string &title)
+                                                 const std::string &title,
+                                                 const std::atomic<bool> *stopper)
 {
 	Result result;
 	result.first = false;
@@ -232,7 +250,7 @@ LyricsFetcher::Result GoogleLyricsFetcher::fetch(const std::string &artist,
 	google_url += "&btnI=I%27m+Feeling+Lucky";
 	
 	std::string data;
-	CURLcode code = Curl::perform(data, google_url, google_url);
+	CURLcode code = Curl::perform(data, google_url, google_url, false, 10, stopper);
 	
 	if (code != CURLE_OK)
 	{
@@ -251,7 +269,7 @@ LyricsFetcher::Result GoogleLyricsFetcher::fetch(const std::string &artist,
 	data = unescapeHtmlUtf8(urls[0]);
 	
 	URL = data.c_str();
-	return LyricsFetcher::fetch("", "");
+	return LyricsFetcher::fetch("", "", stopper);
 }
 
 bool GoogleLyricsFetcher::isURLOk(const std::string &url)
@@ -270,9 +288,10 @@ bool MetrolyricsFetcher::isURLOk(const std::string &url)
 /**********************************************************************/
 
 LyricsFetcher::Result InternetLyricsFetcher::fetch(const std::string &artist,
-                                                   const std::string &title)
+                                                   const std::string &title,
+                                                   const std::atomic<bool> *stopper)
 {
-	GoogleLyricsFetcher::fetch(artist, title);
+	GoogleLyricsFetcher::fetch(artist, title, stopper);
 	LyricsFetcher::Result result;
 	result.first = false;
 	result.second = "The following site may contain lyrics for this song: ";
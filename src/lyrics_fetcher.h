@@ -23,17 +23,38 @@
 
 #include "config.h"
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 struct LyricsFetcher
 {
 	typedef std::pair<bool, std::string> Result;
 
+	/// Outcomes of fetches done so far (cancelled ones are not counted).
+	struct Stats
+	{
+		Stats() : attempts(0), successes(0), total_time(0) { }
+
+		unsigned attempts;
+		unsigned successes;
+		std::chrono::milliseconds total_time;
+	};
+
 	virtual ~LyricsFetcher() { }
 
 	virtual const char *name() const = 0;
-	virtual Result fetch(const std::string &artist, const std::string &title);
+
+	/// Fetch lyrics. If stopper is not null, the fetch is aborted as soon as
+	/// it's set.
+	virtual Result fetch(const std::string &artist, const std::string &title,
+	                     const std::atomic<bool> *stopper);
+
+	void recordFetch(bool success, std::chrono::milliseconds time);
+	Stats stats() const;
 	
 protected:
 	virtual const char *urlTemplate() const = 0;
@@ -45,6 +66,10 @@ protected:
 	std::vector<std::string> getContent(const char *regex, const std::string &data);
 	
 	static const char msgNotFound[];
+
+private:
+	mutable std::mutex m_stats_mutex;
+	Stats m_stats;
 };
 
 typedef std::unique_ptr<LyricsFetcher> LyricsFetcher_;
@@ -58,7 +83,8 @@ std::istream &operator>>(std::istream &is, LyricsFetcher_ &fetcher);
 struct LyricwikiFetcher : public LyricsFetcher
 {
 	virtual const char *name() const override { return "lyricwiki.com"; }
-	virtual Result fetch(const std::string &artist, const std::string &title) override;
+	virtual Result fetch(const std::string &artist, const std::string &title,
+	                     const std::atomic<bool> *stopper) override;
 	
 protected:
 	virtual const char *urlTemplate() const override { return "http://lyrics.wikia.com/api.php?action=lyrics&fmt=xml&func=getSong&artist=%artist%&song=%title%"; }
@@ -71,7 +97,8 @@ protected:
 
 struct GoogleLyricsFetcher : public LyricsFetcher
 {
-	virtual Result fetch(const std::string &artist, const std::string &title);
+	virtual Result fetch(const std::string &artist, const std::string &title,
+	                     const std::atomic<bool> *stopper);
 	
 protected:
 	virtual const char *urlTemplate() const { return URL; }
@@ -168,7 +195,8 @@ protected:
 struct InternetLyricsFetcher : public GoogleLyricsFetcher
 {
 	virtual const char *name() const override { return "the Internet"; }
-	virtual Result fetch(const std::string &artist, const std::string &title) override;
+	virtual Result fetch(const std::string &artist, const std::string &title,
+	                     const std::atomic<bool> *stopper) override;
 	
 protected:
 	virtual const char *siteKeyword() const override { return nullptr; }
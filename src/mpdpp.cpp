@@ -19,13 +19,17 @@
  ***************************************************************************/
 
 #include <cassert>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <algorithm>
 #include <map>
 #include <boost/regex.hpp>
 
 #include "charset.h"
 #include "mpdpp.h"
+#include "utility/reservoir_sampler.h"
 
 MPD::Connection Mpd;
 
@@ -57,6 +61,18 @@ defaultFetcher(SourceT *(fetcher)(mpd_connection *))
 	};
 }
 
+bool fetchPositionId(MPD::PositionIdIterator::State &state)
+{
+	unsigned pos, id;
+	if (mpd_recv_queue_change_brief(state.connection(), &pos, &id))
+	{
+		state.setObject(std::make_pair(pos, id));
+		return true;
+	}
+	else
+		return false;
+}
+
 bool fetchItemSong(MPD::SongIterator::State &state)
 {
 	auto src = mpd_recv_entity(state.connection());
@@ -75,6 +91,79 @@ bool fetchItemSong(MPD::SongIterator::State &state)
 		return false;
 }
 
+time_t parseISO8601(const char *s)
+{
+	std::tm t = {};
+	if (sscanf(s, "%d-%d-%dT%d:%d:%d",
+	           &t.tm_year, &t.tm_mon, &t.tm_mday,
+	           &t.tm_hour, &t.tm_min, &t.tm_sec) != 6)
+		return 0;
+	t.tm_year -= 1900;
+	t.tm_mon -= 1;
+	return timegm(&t);
+}
+
+bool isEntityStart(const char *name)
+{
+	return strcmp(name, "file") == 0
+		|| strcmp(name, "directory") == 0
+		|| strcmp(name, "playlist") == 0;
+}
+
+// Parses songs out of the response pairs, which point into the input buffer
+// of the connection, so the only copies made are the ones kept by the song
+// builder. Entities other than songs are skipped.
+MPD::SongIterator::State::Fetcher songParser()
+{
+	auto builder = std::make_shared<MPD::Song::Builder>();
+	return [builder](MPD::SongIterator::State &state) {
+		mpd_connection *conn = state.connection();
+		mpd_pair *pair;
+		while ((pair = mpd_recv_pair(conn)) != nullptr
+		       && strcmp(pair->name, "file") != 0)
+			mpd_return_pair(conn, pair);
+		if (pair == nullptr)
+			return false;
+
+		builder->start(pair->value);
+		mpd_return_pair(conn, pair);
+		bool has_time = false;
+		while ((pair = mpd_recv_pair(conn)) != nullptr)
+		{
+			if (isEntityStart(pair->name))
+			{
+				mpd_enqueue_pair(conn, pair);
+				break;
+			}
+			mpd_tag_type tag = mpd_tag_name_parse(pair->name);
+			if (tag != MPD_TAG_UNKNOWN)
+				builder->addTag(tag, pair->value);
+			else if (strcmp(pair->name, "Time") == 0)
+			{
+				builder->setDuration(strtoul(pair->value, nullptr, 10));
+				has_time = true;
+			}
+			else if (strcmp(pair->name, "duration") == 0 && !has_time)
+				builder->setDuration(unsigned(strtod(pair->value, nullptr) + 0.5));
+			else if (strcmp(pair->name, "Last-Modified") == 0)
+				builder->setMTime(parseISO8601(pair->value));
+			else if (strcmp(pair->name, "Pos") == 0)
+				builder->setPosition(strtoul(pair->value, nullptr, 10));
+			else if (strcmp(pair->name, "Id") == 0)
+				builder->setID(strtoul(pair->value, nullptr, 10));
+			else if (strcmp(pair->name, "Prio") == 0)
+				builder->setPrio(strtoul(pair->value, nullptr, 10));
+			mpd_return_pair(conn, pair);
+		}
+		// Song may be incomplete if the response was cut short.
+		if (pair == nullptr
+		    && mpd_connection_get_error(conn) != MPD_ERROR_SUCCESS)
+			return false;
+		state.setObject(builder->finish());
+		return true;
+	};
+}
+
 }
 
 namespace MPD {
@@ -104,7 +193,8 @@ Connection::Connection() : m_connection(nullptr),
 				m_idle(false),
 				m_host("localhost"),
 				m_port(6600),
-				m_timeout(15)
+				m_timeout(15),
+				m_fast_song_parsing(false)
 {
 }
 
@@ -144,6 +234,16 @@ unsigned Connection::Version() const
 	return m_connection ? mpd_connection_get_server_version(m_connection.get())[1] : 0;
 }
 
+bool Connection::SupportsAddPosition() const
+{
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 20, 0)
+	return m_connection
+		&& mpd_connection_cmp_server_version(m_connection.get(), 0, 23, 3) >= 0;
+#	else
+	return false;
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+}
+
 void Connection::SetHostname(const std::string &host)
 {
 	size_t at = host.find("@");
@@ -286,6 +386,18 @@ void Connection::Move(unsigned from, unsigned to)
 	}
 }
 
+void Connection::MoveRange(unsigned start, unsigned end, unsigned to)
+{
+	prechecks();
+	if (m_command_list_active)
+		mpd_send_move_range(m_connection.get(), start, end, to);
+	else
+	{
+		mpd_run_move_range(m_connection.get(), start, end, to);
+		checkErrors();
+	}
+}
+
 void Connection::Swap(unsigned from, unsigned to)
 {
 	prechecks();
@@ -375,7 +487,47 @@ SongIterator Connection::GetPlaylistChanges(unsigned version)
 	prechecksNoCommandsList();
 	mpd_send_queue_changes_meta(m_connection.get(), version);
 	checkErrors();
-	return SongIterator(m_connection.get(), defaultFetcher<Song>(mpd_recv_song));
+	return SongIterator(m_connection.get(), songFetcher(defaultFetcher<Song>(mpd_recv_song)));
+}
+
+SongIterator Connection::GetPlaylistChanges(unsigned version, unsigned start, unsigned end)
+{
+	prechecksNoCommandsList();
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 12, 0)
+	mpd_send_queue_changes_meta_range(m_connection.get(), version, start, end);
+#	else
+	throw ClientError(MPD_ERROR_ARGUMENT, "ranged plchanges requires libmpdclient >= 2.12", true);
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+	checkErrors();
+	return SongIterator(m_connection.get(), songFetcher(defaultFetcher<Song>(mpd_recv_song)));
+}
+
+PositionIdIterator Connection::GetPlaylistChangesPosId(unsigned version)
+{
+	prechecksNoCommandsList();
+	mpd_send_queue_changes_brief(m_connection.get(), version);
+	checkErrors();
+	return PositionIdIterator(m_connection.get(), fetchPositionId);
+}
+
+PositionIdIterator Connection::GetPlaylistChangesPosId(unsigned version, unsigned start, unsigned end)
+{
+	prechecksNoCommandsList();
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 12, 0)
+	mpd_send_queue_changes_brief_range(m_connection.get(), version, start, end);
+#	else
+	throw ClientError(MPD_ERROR_ARGUMENT, "ranged plchangesposid requires libmpdclient >= 2.12", true);
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+	checkErrors();
+	return PositionIdIterator(m_connection.get(), fetchPositionId);
+}
+
+SongIterator Connection::GetPlaylistSongs(unsigned start, unsigned end)
+{
+	prechecksNoCommandsList();
+	mpd_send_list_queue_range_meta(m_connection.get(), start, end);
+	checkErrors();
+	return SongIterator(m_connection.get(), songFetcher(defaultFetcher<Song>(mpd_recv_song)));
 }
 
 Song Connection::GetCurrentSong()
@@ -406,7 +558,7 @@ SongIterator Connection::GetPlaylistContent(const std::string &path)
 {
 	prechecksNoCommandsList();
 	mpd_send_list_playlist_meta(m_connection.get(), path.c_str());
-	SongIterator result(m_connection.get(), defaultFetcher<Song>(mpd_recv_song));
+	SongIterator result(m_connection.get(), songFetcher(defaultFetcher<Song>(mpd_recv_song)));
 	checkErrors();
 	return result;
 }
@@ -539,6 +691,18 @@ void Connection::SetPriority(const Song &s, int prio)
 	}
 }
 
+void Connection::SetPriorityRange(unsigned start, unsigned end, int prio)
+{
+	prechecks();
+	if (m_command_list_active)
+		mpd_send_prio_range(m_connection.get(), prio, start, end);
+	else
+	{
+		mpd_run_prio_range(m_connection.get(), prio, start, end);
+		checkErrors();
+	}
+}
+
 int Connection::AddSong(const std::string &path, int pos)
 {
 	prechecks();
@@ -575,66 +739,65 @@ void Connection::Add(const std::string &path)
 	}
 }
 
+void Connection::Add(const std::string &path, unsigned pos)
+{
+	prechecks();
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 20, 0)
+	if (m_command_list_active)
+		mpd_send_add_whence(m_connection.get(), path.c_str(), pos, MPD_POSITION_ABSOLUTE);
+	else
+	{
+		mpd_run_add_whence(m_connection.get(), path.c_str(), pos, MPD_POSITION_ABSOLUTE);
+		checkErrors();
+	}
+#	else
+	throw ClientError(MPD_ERROR_ARGUMENT, "add with position requires libmpdclient >= 2.20", true);
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+}
+
 bool Connection::AddRandomTag(mpd_tag_type tag, size_t number, std::mt19937 &rng)
 {
-	std::vector<std::string> tags(
-		std::make_move_iterator(GetList(tag)),
-		std::make_move_iterator(StringIterator())
-	);
-	if (number > tags.size())
+	ReservoirSampler<std::string> sampler(number);
+	for (StringIterator value = GetList(tag), end; value != end; ++value)
+		sampler.add(std::move(*value), rng);
+	if (number > sampler.seen())
 		return false;
 
-	std::shuffle(tags.begin(), tags.end(), rng);
-	auto it = tags.begin();
-	for (size_t i = 0; i < number && it != tags.end(); ++i)
+	StartCommandsList();
+	for (const auto &value : sampler.take(rng))
 	{
-		StartSearch(true);
-		AddSearch(tag, *it++);
-		std::vector<std::string> paths;
-		MPD::SongIterator s = CommitSearchSongs(), end;
-		for (; s != end; ++s)
-			paths.push_back(s->getURI());
-		StartCommandsList();
-		for (const auto &path : paths)
-			AddSong(path);
-		CommitCommandsList();
+		StartSearchAdd(true);
+		AddSearch(tag, value);
+		CommitSearchAdd();
 	}
+	CommitCommandsList();
 	return true;
 }
 
 bool Connection::AddRandomSongs(size_t number, std::string random_exclude_pattern, std::mt19937 &rng)
 {
 	prechecksNoCommandsList();
-	std::vector<std::string> files;
+	boost::regex re;
+	if (!random_exclude_pattern.empty())
+		re.assign(random_exclude_pattern);
+	// Only the sample is kept, not the whole list of songs.
+	ReservoirSampler<std::string> sampler(number);
 	mpd_send_list_all(m_connection.get(), "/");
 	while (mpd_pair *item = mpd_recv_pair_named(m_connection.get(), "file"))
 	{
-		files.push_back(item->value);
+		if (random_exclude_pattern.empty() || !boost::regex_match(item->value, re))
+			sampler.add(item->value, rng);
 		mpd_return_pair(m_connection.get(), item);
 	}
 	mpd_response_finish(m_connection.get());
 	checkErrors();
-	
-	if (number > files.size())
-	{
-		//if (itsErrorHandler)
-		//	itsErrorHandler(this, 0, "Requested number of random songs is bigger than size of your library", itsErrorHandlerUserdata);
+
+	if (number > sampler.seen())
 		return false;
-	}
-	else
-	{
-		std::shuffle(files.begin(), files.end(), rng);
-		StartCommandsList();
-		auto it = files.begin();
-		boost::regex re(random_exclude_pattern);
-		for (size_t i = 0; i < number && it != files.end(); ++it) {
-			if (random_exclude_pattern.empty() || !boost::regex_match((*it), re)) {
-				AddSong(*it);
-				i++;
-			}
-		}
-		CommitCommandsList();
-	}
+	StartCommandsList();
+	for (const auto &path : sampler.take(rng))
+		AddSong(path);
+	CommitCommandsList();
 	return true;
 }
 
@@ -649,6 +812,17 @@ void Connection::Delete(unsigned pos)
 	}
 }
 
+void Connection::DeleteRange(unsigned start, unsigned end)
+{
+	prechecks();
+	mpd_send_delete_range(m_connection.get(), start, end);
+	if (!m_command_list_active)
+	{
+		mpd_response_finish(m_connection.get());
+		checkErrors();
+	}
+}
+
 void Connection::PlaylistDelete(const std::string &playlist, unsigned pos)
 {
 	prechecks();
@@ -757,12 +931,72 @@ void Connection::AddSearchURI(const std::string &str) const
 	mpd_search_add_uri_constraint(m_connection.get(), MPD_OPERATOR_DEFAULT, str.c_str());
 }
 
+void Connection::AddSearchModifiedSince(time_t mtime) const
+{
+	checkConnection();
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 10, 0)
+	mpd_search_add_modified_since_constraint(m_connection.get(), MPD_OPERATOR_DEFAULT, mtime);
+#	else
+	mpd_search_cancel(m_connection.get());
+	throw ClientError(MPD_ERROR_ARGUMENT, "modified-since constraint requires libmpdclient >= 2.10", true);
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+}
+
+void Connection::AddSearchExpression(const std::string &expression) const
+{
+	checkConnection();
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 15, 0)
+	mpd_search_add_expression(m_connection.get(), expression.c_str());
+#	else
+	mpd_search_cancel(m_connection.get());
+	throw ClientError(MPD_ERROR_ARGUMENT, "filter expressions require libmpdclient >= 2.15", true);
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+}
+
 SongIterator Connection::CommitSearchSongs()
 {
 	prechecksNoCommandsList();
 	mpd_search_commit(m_connection.get());
 	checkErrors();
-	return SongIterator(m_connection.get(), defaultFetcher<Song>(mpd_recv_song));
+	return SongIterator(m_connection.get(), songFetcher(defaultFetcher<Song>(mpd_recv_song)));
+}
+
+void Connection::StartSearchAdd(bool exact_match)
+{
+	prechecks();
+	mpd_search_add_db_songs(m_connection.get(), exact_match);
+}
+
+void Connection::StartSearchAddToPlaylist(const std::string &playlist)
+{
+	prechecks();
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 17, 0)
+	mpd_search_add_db_songs_to_playlist(m_connection.get(), playlist.c_str());
+#	else
+	throw ClientError(MPD_ERROR_ARGUMENT, "searchaddpl requires libmpdclient >= 2.17", true);
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+}
+
+void Connection::AddSearchPosition(unsigned pos) const
+{
+	checkConnection();
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 20, 0)
+	mpd_search_add_position(m_connection.get(), pos, MPD_POSITION_ABSOLUTE);
+#	else
+	mpd_search_cancel(m_connection.get());
+	throw ClientError(MPD_ERROR_ARGUMENT, "search with position requires libmpdclient >= 2.20", true);
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+}
+
+void Connection::CommitSearchAdd()
+{
+	prechecks();
+	mpd_search_commit(m_connection.get());
+	if (!m_command_list_active)
+	{
+		mpd_response_finish(m_connection.get());
+		checkErrors();
+	}
 }
 
 ItemIterator Connection::GetDirectory(const std::string &directory)
@@ -778,6 +1012,14 @@ SongIterator Connection::GetDirectoryRecursive(const std::string &directory)
 	prechecksNoCommandsList();
 	mpd_send_list_all_meta(m_connection.get(), mpdDirectory(directory));
 	checkErrors();
+	return SongIterator(m_connection.get(), songFetcher(fetchItemSong));
+}
+
+SongIterator Connection::GetDirectoryRecursiveNoInfo(const std::string &directory)
+{
+	prechecksNoCommandsList();
+	mpd_send_list_all(m_connection.get(), mpdDirectory(directory));
+	checkErrors();
 	return SongIterator(m_connection.get(), fetchItemSong);
 }
 
@@ -794,7 +1036,7 @@ SongIterator Connection::GetSongs(const std::string &directory)
 	prechecksNoCommandsList();
 	mpd_send_list_meta(m_connection.get(), mpdDirectory(directory));
 	checkErrors();
-	return SongIterator(m_connection.get(), defaultFetcher<Song>(mpd_recv_song));
+	return SongIterator(m_connection.get(), songFetcher(defaultFetcher<Song>(mpd_recv_song)));
 }
 
 OutputIterator Connection::GetOutputs()
@@ -881,4 +1123,12 @@ void Connection::checkErrors() const
 	checkConnectionErrors(m_connection.get());
 }
 
+SongIterator::State::Fetcher Connection::songFetcher(SongIterator::State::Fetcher fallback) const
+{
+	if (m_fast_song_parsing)
+		return songParser();
+	else
+		return fallback;
+}
+
 }
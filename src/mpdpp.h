@@ -478,6 +478,8 @@ typedef Iterator<Output> OutputIterator;
 typedef Iterator<Playlist> PlaylistIterator;
 typedef Iterator<Song> SongIterator;
 typedef Iterator<std::string> StringIterator;
+/// Position and id of a song in the queue.
+typedef Iterator<std::pair<unsigned, unsigned>> PositionIdIterator;
 
 struct Connection
 {
@@ -489,10 +491,18 @@ struct Connection
 	bool Connected() const;
 	void Disconnect();
 	
-	const std::string &GetHostname() { return m_host; }
-	int GetPort() { return m_port; }
+	const std::string &GetHostname() const { return m_host; }
+	int GetPort() const { return m_port; }
+	/// @return name identifying the server, used by caches kept on disk.
+	std::string GetServerName() const { return m_host + ":" + std::to_string(m_port); }
+	int GetTimeout() const { return m_timeout; }
+	const std::string &GetPassword() const { return m_password; }
 	
 	unsigned Version() const;
+
+	/// Whether songs added by Add and StartSearchAdd can be inserted at a
+	/// given position (MPD >= 0.23.3).
+	bool SupportsAddPosition() const;
 	
 	int GetFD() const { return m_fd; }
 	
@@ -501,6 +511,12 @@ struct Connection
 	void SetTimeout(int timeout) { m_timeout = timeout; }
 	void SetPassword(const std::string &password) { m_password = password; }
 	void SendPassword();
+
+	bool GetFastSongParsing() const { return m_fast_song_parsing; }
+
+	/// Read songs of bulk responses (listallinfo, playlistinfo, search etc.)
+	/// straight into interned songs instead of going through mpd_song.
+	void SetFastSongParsing(bool enabled) { m_fast_song_parsing = enabled; }
 	
 	Statistics getStatistics();
 	Status getStatus();
@@ -516,6 +532,7 @@ struct Connection
 	void Next();
 	void Prev();
 	void Move(unsigned int from, unsigned int to);
+	void MoveRange(unsigned start, unsigned end, unsigned to);
 	void Swap(unsigned, unsigned);
 	void Seek(unsigned int pos, unsigned int where);
 	void Shuffle();
@@ -523,6 +540,10 @@ struct Connection
 	void ClearMainPlaylist();
 	
 	SongIterator GetPlaylistChanges(unsigned);
+	SongIterator GetPlaylistChanges(unsigned version, unsigned start, unsigned end);
+	PositionIdIterator GetPlaylistChangesPosId(unsigned version);
+	PositionIdIterator GetPlaylistChangesPosId(unsigned version, unsigned start, unsigned end);
+	SongIterator GetPlaylistSongs(unsigned start, unsigned end);
 	
 	Song GetCurrentSong();
 	Song GetSong(const std::string &);
@@ -543,13 +564,16 @@ struct Connection
 	void SetReplayGainMode(ReplayGainMode);
 	
 	void SetPriority(const MPD::Song &s, int prio);
+	void SetPriorityRange(unsigned start, unsigned end, int prio);
 	
 	int AddSong(const std::string &, int = -1); // returns id of added song
 	int AddSong(const Song &, int = -1); // returns id of added song
 	bool AddRandomTag(mpd_tag_type, size_t, std::mt19937 &rng);
 	bool AddRandomSongs(size_t number, std::string random_exclude_pattern, std::mt19937 &rng);
 	void Add(const std::string &path);
+	void Add(const std::string &path, unsigned pos);
 	void Delete(unsigned int pos);
+	void DeleteRange(unsigned start, unsigned end);
 	void PlaylistDelete(const std::string &playlist, unsigned int pos);
 	void StartCommandsList();
 	void CommitCommandsList();
@@ -568,12 +592,26 @@ struct Connection
 	void AddSearch(mpd_tag_type item, const std::string &str) const;
 	void AddSearchAny(const std::string &str) const;
 	void AddSearchURI(const std::string &str) const;
+	void AddSearchModifiedSince(time_t mtime) const;
+	/// Add filter expression (MPD >= 0.21), e.g. (Artist == "value").
+	void AddSearchExpression(const std::string &expression) const;
 	SongIterator CommitSearchSongs();
+
+	/// Search that adds matching songs to the queue on the server side,
+	/// can be a part of a command list.
+	void StartSearchAdd(bool exact_match);
+	/// Same as above, but for a stored playlist. Tag constraints match case
+	/// insensitive substrings (searchaddpl), use AddSearchExpression for
+	/// exact matches.
+	void StartSearchAddToPlaylist(const std::string &playlist);
+	void AddSearchPosition(unsigned pos) const;
+	void CommitSearchAdd();
 	
 	PlaylistIterator GetPlaylists();
 	StringIterator GetList(mpd_tag_type type);
 	ItemIterator GetDirectory(const std::string &directory);
 	SongIterator GetDirectoryRecursive(const std::string &directory);
+	SongIterator GetDirectoryRecursiveNoInfo(const std::string &directory);
 	SongIterator GetSongs(const std::string &directory);
 	DirectoryIterator GetDirectories(const std::string &directory);
 	
@@ -600,6 +638,8 @@ private:
 	void prechecksNoCommandsList();
 	void checkErrors() const;
 
+	SongIterator::State::Fetcher songFetcher(SongIterator::State::Fetcher fallback) const;
+
 	NoidleCallback m_noidle_callback;
 	std::unique_ptr<mpd_connection, ConnectionDeleter> m_connection;
 	bool m_command_list_active;
@@ -611,6 +651,8 @@ private:
 	int m_port;
 	int m_timeout;
 	std::string m_password;
+
+	bool m_fast_song_parsing;
 };
 
 }
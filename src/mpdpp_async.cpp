@@ -0,0 +1,178 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "gcc.h"
+#include "mpdpp_async.h"
+
+MPD::AsyncConnection AsyncMpd;
+
+namespace MPD {
+
+AsyncConnection::AsyncConnection()
+: m_stop(false), m_reconfigure(false), m_connection_fd(-1)
+{
+	if (pipe(m_notification_pipe) != 0)
+		throw std::runtime_error("couldn't create notification pipe");
+	// Neither the worker nor the main thread may ever block on the pipe.
+	for (int fd : m_notification_pipe)
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+AsyncConnection::~AsyncConnection()
+{
+	stop();
+	close(m_notification_pipe[0]);
+	close(m_notification_pipe[1]);
+}
+
+void AsyncConnection::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_requests.clear();
+		// Make the request in progress fail instead of waiting for it.
+		if (m_connection_fd >= 0)
+			shutdown(m_connection_fd, SHUT_RDWR);
+	}
+	m_cv.notify_one();
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void AsyncConnection::configure(const Connection &mpd)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_parameters.host = mpd.GetHostname();
+	m_parameters.port = mpd.GetPort();
+	m_parameters.timeout = mpd.GetTimeout();
+	m_parameters.password = mpd.GetPassword();
+	m_parameters.fast_song_parsing = mpd.GetFastSongParsing();
+	m_reconfigure = true;
+}
+
+SongListFuture AsyncConnection::fetchSongs(std::function<SongIterator(Connection &)> query,
+                                           Completion completion)
+{
+	return send([query = std::move(query)](Connection &mpd) {
+		return std::vector<Song>(
+			std::make_move_iterator(query(mpd)),
+			std::make_move_iterator(SongIterator()));
+	}, std::move(completion));
+}
+
+void AsyncConnection::processCompletions()
+{
+	char buf[64];
+	while (read(m_notification_pipe[0], buf, sizeof(buf)) > 0)
+		;
+	std::deque<Completion> completions;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		completions.swap(m_completions);
+	}
+	for (auto &completion : completions)
+		completion();
+}
+
+/**********************************************************************/
+
+void AsyncConnection::push(std::function<void()> run, Completion completion)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_stop)
+			return;
+		m_requests.push_back(Job{std::move(run), std::move(completion)});
+		if (!m_thread.joinable())
+			m_thread = std::thread(&AsyncConnection::worker, this);
+	}
+	m_cv.notify_one();
+}
+
+void AsyncConnection::worker()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_cv.wait(lock, [this] { return m_stop || !m_requests.empty(); });
+		if (m_stop)
+			break;
+		Job job = std::move(m_requests.front());
+		m_requests.pop_front();
+
+		lock.unlock();
+		job.run();
+		lock.lock();
+
+		if (job.completion)
+		{
+			m_completions.push_back(std::move(job.completion));
+			char c = 0;
+			// If the pipe is full, the main thread is already notified.
+			GNUC_UNUSED ssize_t res = write(m_notification_pipe[1], &c, 1);
+		}
+	}
+	lock.unlock();
+	disconnect();
+}
+
+Connection &AsyncConnection::connection()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_reconfigure)
+		{
+			m_connection_fd = -1;
+			m_connection.Disconnect();
+			m_connection.SetHostname(m_parameters.host);
+			m_connection.SetPort(m_parameters.port);
+			m_connection.SetTimeout(m_parameters.timeout);
+			m_connection.SetPassword(m_parameters.password);
+			m_connection.SetFastSongParsing(m_parameters.fast_song_parsing);
+			m_reconfigure = false;
+		}
+	}
+	if (!m_connection.Connected())
+	{
+		m_connection.Connect();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_connection_fd = m_connection.GetFD();
+		if (m_stop)
+			shutdown(m_connection_fd, SHUT_RDWR);
+	}
+	return m_connection;
+}
+
+void AsyncConnection::disconnect()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_connection_fd = -1;
+	}
+	m_connection.Disconnect();
+}
+
+}
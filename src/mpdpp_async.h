@@ -0,0 +1,139 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_MPDPP_ASYNC_H
+#define NCMPCPP_MPDPP_ASYNC_H
+
+#include <boost/thread/future.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mpdpp.h"
+
+namespace MPD {
+
+typedef boost::BOOST_THREAD_FUTURE<std::vector<Song>> SongListFuture;
+
+/// Additional connection to MPD owned by a separate thread. Requests are
+/// executed on it in order, one after another, so that long running commands
+/// don't block the user interface. Once a request is done, its completion
+/// handler is run on the main thread by processCompletions, which should be
+/// called when notification descriptor becomes readable.
+struct AsyncConnection
+{
+	typedef std::function<void()> Completion;
+
+	AsyncConnection();
+	~AsyncConnection();
+
+	/// Drop queued requests, interrupt the one in progress and stop the
+	/// worker thread. Nothing can be sent afterwards.
+	void stop();
+
+	/// Use connection parameters of a given connection. Current connection
+	/// is closed before the next request.
+	void configure(const Connection &mpd);
+
+	/// @return descriptor that becomes readable when a request is done.
+	int GetNotificationFD() const { return m_notification_pipe[0]; }
+
+	/// Queue request to be executed on the connection of the worker thread.
+	/// @return future holding the value returned by the request or the
+	/// exception it threw.
+	template <typename RequestT>
+	auto send(RequestT request, Completion completion = nullptr)
+		-> boost::BOOST_THREAD_FUTURE<decltype(request(std::declval<Connection &>()))>
+	{
+		typedef decltype(request(std::declval<Connection &>())) ResultT;
+		auto task = std::make_shared<boost::packaged_task<ResultT>>(
+			[this, request = std::move(request)]() mutable {
+				try
+				{
+					return request(connection());
+				}
+				catch (ClientError &e)
+				{
+					if (!e.clearable())
+						disconnect();
+					throw;
+				}
+			}
+		);
+		auto result = task->get_future();
+		push([task] { (*task)(); }, std::move(completion));
+		return result;
+	}
+
+	/// Queue query returning songs, which are collected on the worker thread.
+	SongListFuture fetchSongs(std::function<SongIterator(Connection &)> query,
+	                          Completion completion = nullptr);
+
+	/// Run completion handlers of requests that are done.
+	void processCompletions();
+
+private:
+	struct Parameters
+	{
+		std::string host;
+		int port;
+		int timeout;
+		std::string password;
+		bool fast_song_parsing;
+	};
+
+	struct Job
+	{
+		std::function<void()> run;
+		Completion completion;
+	};
+
+	void push(std::function<void()> run, Completion completion);
+	void worker();
+	Connection &connection();
+	void disconnect();
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<Job> m_requests;
+	std::deque<Completion> m_completions;
+	bool m_stop;
+
+	Parameters m_parameters;
+	bool m_reconfigure;
+
+	// Accessed only from the worker thread.
+	Connection m_connection;
+	// Descriptor of the connection, so that stop can interrupt it.
+	int m_connection_fd;
+
+	int m_notification_pipe[2];
+};
+
+}
+
+extern MPD::AsyncConnection AsyncMpd;
+
+#endif // NCMPCPP_MPDPP_ASYNC_H
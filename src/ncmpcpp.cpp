@@ -30,12 +30,15 @@
 #include <stdexcept>
 
 #include "mpdpp.h"
+#include "mpdpp_async.h"
 
 #include "actions.h"
 #include "bindings.h"
 #include "screens/browser.h"
 #include "charset.h"
 #include "configuration.h"
+#include "database_cache.h"
+#include "playlist_index.h"
 #include "global.h"
 #include "helpers.h"
 #include "screens/lyrics.h"
@@ -44,6 +47,8 @@
 #include "settings.h"
 #include "status.h"
 #include "statusbar.h"
+#include "tag_cache.h"
+#include "tag_writer.h"
 #include "screens/visualizer.h"
 #include "title.h"
 #include "utility/conversion.h"
@@ -70,6 +75,15 @@ void sighandler(int sig)
 
 void do_at_exit()
 {
+	// The worker interns fetched songs into the string pool, stop it
+	// before globals it uses are destroyed.
+	AsyncMpd.stop();
+#	ifdef HAVE_TAGLIB_H
+	// let files that are being written be written completely
+	TagWriter.cancel();
+	TagWriter.wait();
+	TagCache.save();
+#	endif // HAVE_TAGLIB_H
 	// restore old cerr & clog buffers
 	std::cerr.rdbuf(cerr_buffer);
 	std::clog.rdbuf(clog_buffer);
@@ -107,6 +121,12 @@ int main(int argc, char **argv)
 	errorlog.open((Config.ncmpcpp_directory + "error.log").c_str(), std::ios::app);
 	cerr_buffer = std::cerr.rdbuf();
 	std::cerr.rdbuf(errorlog.rdbuf());
+
+	Database.load(Config.ncmpcpp_directory + "database");
+	StoredPlaylists.load(Config.ncmpcpp_directory + "playlists");
+#	ifdef HAVE_TAGLIB_H
+	TagCache.load(Config.ncmpcpp_directory + "tags");
+#	endif // HAVE_TAGLIB_H
 	
 	sigignore(SIGPIPE);
 	signal(SIGWINCH, sighandler);
@@ -0,0 +1,225 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "mpdpp_async.h"
+#include "playlist_index.h"
+#include "statusbar.h"
+
+PlaylistIndex StoredPlaylists;
+
+PlaylistIndex::PlaylistIndex()
+: m_validated(false)
+{ }
+
+void PlaylistIndex::load(std::string path)
+{
+	m_path = std::move(path);
+	m_validated = false;
+	if (!read())
+	{
+		m_server.clear();
+		m_playlists.clear();
+	}
+	rebuild();
+}
+
+void PlaylistIndex::invalidate()
+{
+	m_validated = false;
+	// Result of the check in progress might come from a different server.
+	m_fetch = boost::BOOST_THREAD_FUTURE<Fetched>();
+}
+
+void PlaylistIndex::prefetch(std::function<void()> on_fetched)
+{
+	if (m_validated || m_fetch.valid())
+		return;
+
+	std::map<std::string, time_t> indexed;
+	for (const auto &playlist : m_playlists)
+		indexed.emplace(playlist.first, playlist.second.last_modified);
+	m_fetch = AsyncMpd.send([server = m_server, indexed = std::move(indexed)](MPD::Connection &mpd) {
+		Fetched result;
+		result.server = mpd.GetServerName();
+		try
+		{
+			for (MPD::PlaylistIterator it = mpd.GetPlaylists(), end; it != end; ++it)
+				result.playlists.emplace_back(it->path(), it->lastModified());
+		}
+		catch (MPD::ServerError &e)
+		{
+			// No playlists directory.
+			if (e.code() != MPD_SERVER_ERROR_SYSTEM)
+				throw;
+		}
+		for (const auto &playlist : result.playlists)
+		{
+			if (result.server == server)
+			{
+				auto it = indexed.find(playlist.first);
+				if (it != indexed.end() && it->second == playlist.second)
+					continue;
+			}
+			auto &uris = result.contents[playlist.first];
+			for (MPD::SongIterator s = mpd.GetPlaylistContentNoInfo(playlist.first), end; s != end; ++s)
+				uris.push_back(s->getURI());
+		}
+		return result;
+	}, std::move(on_fetched));
+}
+
+bool PlaylistIndex::completeFetch()
+{
+	if (!m_fetch.valid() || !m_fetch.is_ready())
+		return false;
+	return storeFetched();
+}
+
+void PlaylistIndex::update()
+{
+	prefetch(nullptr);
+	if (m_fetch.valid())
+		storeFetched();
+}
+
+std::vector<PlaylistIndex::Match> PlaylistIndex::find(const MPD::Song &s) const
+{
+	std::vector<Match> result;
+	std::string uri = s.getURI();
+	auto it = m_songs.find(std::hash<std::string>()(uri));
+	if (it == m_songs.end())
+		return result;
+	// Entries are grouped by playlist in order of positions.
+	for (const auto &entry : it->second)
+	{
+		const auto &playlist = *entry.first;
+		if (playlist.second.uris[entry.second] != uri)
+			continue;
+		if (result.empty() || result.back().playlist != playlist.first)
+			result.push_back(Match{playlist.first, {}});
+		result.back().positions.push_back(entry.second);
+	}
+	return result;
+}
+
+/**********************************************************************/
+
+bool PlaylistIndex::storeFetched()
+{
+	Fetched fetched;
+	try
+	{
+		fetched = m_fetch.get();
+	}
+	catch (MPD::ClientError &e)
+	{
+		Statusbar::printf("Unable to fetch stored playlists: %1%", e.what());
+		m_fetch = boost::BOOST_THREAD_FUTURE<Fetched>();
+		return false;
+	}
+	catch (MPD::ServerError &e)
+	{
+		Statusbar::printf("MPD: %1%", e.what());
+		m_fetch = boost::BOOST_THREAD_FUTURE<Fetched>();
+		return false;
+	}
+	m_fetch = boost::BOOST_THREAD_FUTURE<Fetched>();
+
+	if (fetched.server != m_server)
+	{
+		m_server = std::move(fetched.server);
+		m_playlists.clear();
+	}
+
+	bool changed = fetched.playlists.size() != m_playlists.size();
+	PlaylistMap current;
+	for (auto &playlist : fetched.playlists)
+	{
+		auto content = fetched.contents.find(playlist.first);
+		if (content == fetched.contents.end())
+		{
+			// Contents of unmodified playlists were not fetched.
+			auto it = m_playlists.find(playlist.first);
+			if (it != m_playlists.end())
+				current.insert(std::move(*it));
+			continue;
+		}
+		changed = true;
+		auto &entry = current[playlist.first];
+		entry.last_modified = playlist.second;
+		entry.uris = std::move(content->second);
+	}
+	m_playlists = std::move(current);
+	m_validated = true;
+
+	if (changed)
+	{
+		rebuild();
+		write();
+	}
+	return changed;
+}
+
+void PlaylistIndex::rebuild()
+{
+	m_songs.clear();
+	std::hash<std::string> hash;
+	for (const auto &playlist : m_playlists)
+	{
+		const auto &uris = playlist.second.uris;
+		for (size_t i = 0; i < uris.size(); ++i)
+			m_songs[hash(uris[i])].emplace_back(&playlist, i);
+	}
+}
+
+bool PlaylistIndex::read()
+{
+	std::ifstream f(m_path, std::ios::binary);
+	if (!f.is_open())
+		return false;
+	return PlaylistIndexFormat::read(f, m_server, m_playlists);
+}
+
+void PlaylistIndex::write() const
+{
+	if (m_path.empty())
+		return;
+
+	std::string tmp_path = m_path + ".tmp";
+	std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+	if (!f.is_open())
+	{
+		std::cerr << "Couldn't open " << tmp_path << " for writing\n";
+		return;
+	}
+
+	PlaylistIndexFormat::write(f, m_server, m_playlists);
+
+	f.close();
+	if (!f || std::rename(tmp_path.c_str(), m_path.c_str()) != 0)
+	{
+		std::cerr << "Couldn't write playlist index to " << m_path << "\n";
+		std::remove(tmp_path.c_str());
+	}
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_PLAYLIST_INDEX_H
+#define NCMPCPP_PLAYLIST_INDEX_H
+
+#include <boost/thread/future.hpp>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mpdpp.h"
+#include "playlist_index_format.h"
+#include "song.h"
+
+/// Index of songs in stored playlists that maps each song to playlists that
+/// contain it. It's kept on disk between sessions and only playlists that
+/// were modified since they were indexed are fetched from the server.
+struct PlaylistIndex
+{
+	/// Stored playlist containing a song along with its positions there.
+	struct Match
+	{
+		std::string playlist;
+		std::vector<size_t> positions;
+	};
+
+	PlaylistIndex();
+
+	/// Read the index from a given file.
+	void load(std::string path);
+
+	/// Check stored playlists for modifications on next update.
+	void invalidate();
+
+	/// Start checking stored playlists for modifications in the background
+	/// unless the index was already validated. on_fetched is run on the main
+	/// thread when the result can be stored with completeFetch.
+	void prefetch(std::function<void()> on_fetched);
+
+	/// Store the result of the check if it already arrived.
+	/// @return true if the index was updated.
+	bool completeFetch();
+
+	/// Bring the index up to date with stored playlists on the server,
+	/// waiting for the result.
+	void update();
+
+	/// @return stored playlists containing a given song, sorted by path.
+	std::vector<Match> find(const MPD::Song &s) const;
+
+private:
+	typedef PlaylistIndexFormat::PlaylistMap PlaylistMap;
+
+	// Stored playlists on the server. Contents are fetched only for
+	// playlists that were modified since they were indexed.
+	struct Fetched
+	{
+		std::string server;
+		std::vector<std::pair<std::string, time_t>> playlists;
+		std::map<std::string, std::vector<std::string>> contents;
+	};
+
+	bool storeFetched();
+	void rebuild();
+	bool read();
+	void write() const;
+
+	std::string m_path;
+	std::string m_server;
+	bool m_validated;
+
+	boost::BOOST_THREAD_FUTURE<Fetched> m_fetch;
+
+	PlaylistMap m_playlists;
+
+	// Hashes of URIs mapped to playlists and positions they're at.
+	std::unordered_map<size_t, std::vector<std::pair<const PlaylistMap::value_type *, size_t>>> m_songs;
+};
+
+extern PlaylistIndex StoredPlaylists;
+
+#endif // NCMPCPP_PLAYLIST_INDEX_H
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <cstdint>
+
+#include "playlist_index_format.h"
+#include "utility/binary_io.h"
+
+namespace {
+
+const char index_magic[] = "ncmpcpp-playlists";
+const uint32_t index_version = 1;
+
+}
+
+namespace PlaylistIndexFormat {
+
+bool read(std::istream &f, std::string &server, PlaylistMap &playlists)
+{
+	std::string magic;
+	uint32_t version;
+	if (!readString(f, magic) || magic != index_magic
+	||  !readInt(f, version) || version != index_version)
+		return false;
+
+	uint32_t playlist_count;
+	if (!readString(f, server) || !readInt(f, playlist_count))
+		return false;
+	playlists.clear();
+	std::string path, uri;
+	for (uint32_t i = 0; i < playlist_count; ++i)
+	{
+		int64_t last_modified;
+		uint32_t song_count;
+		if (!readString(f, path) || !readInt(f, last_modified) || !readInt(f, song_count))
+			return false;
+		auto &playlist = playlists[path];
+		playlist.last_modified = last_modified;
+		for (uint32_t j = 0; j < song_count; ++j)
+		{
+			if (!readString(f, uri))
+				return false;
+			playlist.uris.push_back(std::move(uri));
+		}
+	}
+	return true;
+}
+
+void write(std::ostream &f, const std::string &server, const PlaylistMap &playlists)
+{
+	writeString(f, index_magic);
+	writeInt(f, index_version);
+	writeString(f, server.c_str());
+	writeInt(f, uint32_t(playlists.size()));
+	for (const auto &playlist : playlists)
+	{
+		writeString(f, playlist.first.c_str());
+		writeInt(f, int64_t(playlist.second.last_modified));
+		writeInt(f, uint32_t(playlist.second.uris.size()));
+		for (const auto &uri : playlist.second.uris)
+			writeString(f, uri.c_str());
+	}
+}
+
+}
@@ -0,0 +1,51 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_PLAYLIST_INDEX_FORMAT_H
+#define NCMPCPP_PLAYLIST_INDEX_FORMAT_H
+
+#include <ctime>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// On-disk format of the index of stored playlists.
+namespace PlaylistIndexFormat {
+
+struct Playlist
+{
+	time_t last_modified;
+	std::vector<std::string> uris;
+};
+
+/// Playlists mapped by their paths.
+typedef std::map<std::string, Playlist> PlaylistMap;
+
+/// Read playlists along with the server they come from.
+/// @return false if the data is not a valid index.
+bool read(std::istream &f, std::string &server, PlaylistMap &playlists);
+
+void write(std::ostream &f, const std::string &server, const PlaylistMap &playlists);
+
+}
+
+#endif // NCMPCPP_PLAYLIST_INDEX_FORMAT_H
@@ -33,6 +33,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <memory>
 
 #include "utility/functional.h"
 
@@ -40,29 +41,26 @@ namespace {
 
 #ifdef BOOST_REGEX_ICU
 
+// Transliterators are not thread safe, so each thread gets its own.
 struct StripDiacritics
 {
 	static void convert(icu::UnicodeString &s)
 	{
-		if (m_converter == nullptr)
+		static thread_local std::unique_ptr<icu::Transliterator> converter;
+		if (converter == nullptr)
 		{
 			icu::ErrorCode result;
-			m_converter = icu::Transliterator::createInstance(
-				"NFD; [:M:] Remove; NFC", UTRANS_FORWARD, result);
+			converter.reset(icu::Transliterator::createInstance(
+				"NFD; [:M:] Remove; NFC", UTRANS_FORWARD, result));
 			if (result.isFailure())
 				throw std::runtime_error(
 					"instantiation of transliterator instance failed with "
 					+ std::string(result.errorName()));
 		}
-		m_converter->transliterate(s);
+		converter->transliterate(s);
 	}
-
-private:
-	static icu::Transliterator *m_converter;
 };
 
-icu::Transliterator *StripDiacritics::m_converter;
-
 #endif // BOOST_REGEX_ICU
 
 }
@@ -120,6 +118,28 @@ inline bool search(const std::basic_string<CharT> &s,
 	}
 }
 
+inline bool search(const char *s,
+                   const Regex &rx,
+                   bool ignore_diacritics)
+{
+#ifdef BOOST_REGEX_ICU
+	if (ignore_diacritics)
+		return search(std::string(s), rx, ignore_diacritics);
+	try {
+		return boost::u32regex_search(s, rx);
+	} catch (std::out_of_range &e) {
+		std::cerr << "Regex::search: error while processing \""
+		          << s
+		          << "\": "
+		          << e.what()
+		          << "\n";
+		return false;
+	}
+#else
+	return boost::regex_search(s, rx);
+#endif // BOOST_REGEX_ICU
+}
+
 template <typename T>
 struct Filter
 {
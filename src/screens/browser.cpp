@@ -19,6 +19,7 @@
  ***************************************************************************/
 
 #include <algorithm>
+#include <cassert>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/locale/conversion.hpp>
@@ -29,6 +30,7 @@
 #include "display.h"
 #include "global.h"
 #include "helpers.h"
+#include "local_directory.h"
 #include "screens/playlist.h"
 #include "curses/menu_impl.h"
 #include "screens/screen_switcher.h"
@@ -37,7 +39,6 @@
 #include "statusbar.h"
 #include "screens/tag_editor.h"
 #include "title.h"
-#include "tags.h"
 #include "format_impl.h"
 #include "helpers/song_iterator_maker.h"
 #include "utility/comparators.h"
@@ -61,13 +62,12 @@ std::string realPath(bool local_browser, std::string path);
 bool isStringParentDirectory(const std::string &directory);
 bool isItemParentDirectory(const MPD::Item &item);
 bool isRootDirectory(const std::string &directory);
-bool isHidden(const fs::directory_iterator &entry);
-bool hasSupportedExtension(const fs::directory_entry &entry);
-MPD::Song getLocalSong(const fs::directory_entry &entry, bool read_tags);
+bool hasSupportedExtension(const std::string &filename);
 void getLocalDirectory(NC::Menu<MPD::Item> &menu, const std::string &directory);
 void getLocalDirectoryRecursively(std::vector<MPD::Song> &songs,
                                   const std::string &directory);
 void clearDirectory(const std::string &directory);
+std::string itemPath(const MPD::Item &item);
 
 std::string itemToString(const MPD::Item &item);
 bool browserEntryMatcher(const Regex::Regex &rx, const MPD::Item &item, bool filter);
@@ -141,6 +141,19 @@ Browser::Browser()
 	w.setSelectedPrefix(Config.selected_item_prefix);
 	w.setSelectedSuffix(Config.selected_item_suffix);
 	w.setItemDisplayer(std::bind(Display::Items, ph::_1, std::cref(w)));
+	m_shared_songs = SharedSongs.addListener([this](const SongStore::SongSet &updated) {
+		if (m_local_browser)
+			return;
+		ScopedUnfilteredMenu<MPD::Item> sunfilter(ReapplyFilter::Yes, w);
+		for (auto &item : w)
+		{
+			if (item.value().type() != MPD::Item::Type::Song)
+				continue;
+			auto it = updated.find(item.value().song());
+			if (it != updated.end())
+				item.value() = MPD::Item(*it);
+		}
+	});
 }
 
 void Browser::resize()
@@ -400,6 +413,36 @@ std::vector<MPD::Song> Browser::getSelectedSongs()
 	return songs;
 }
 
+std::vector<DatabaseQuery> Browser::getSelectedQueries()
+{
+	assert(!m_local_browser);
+	std::vector<DatabaseQuery> queries;
+	auto item_handler = [&queries](const MPD::Item &item) {
+		switch (item.type())
+		{
+			case MPD::Item::Type::Directory:
+				queries.emplace_back(item.directory().path());
+				break;
+			case MPD::Item::Type::Song:
+				queries.emplace_back(item.song());
+				break;
+			case MPD::Item::Type::Playlist:
+				// Only paths are needed, so there is no point in fetching tags.
+				for (MPD::SongIterator s = Mpd.GetPlaylistContentNoInfo(item.playlist().path()), end;
+				     s != end; ++s)
+					queries.emplace_back(std::move(*s));
+				break;
+		}
+	};
+	for (const auto &item : w)
+		if (item.isSelected())
+			item_handler(item.value());
+	// if no item is selected, add current one
+	if (queries.empty() && !w.empty())
+		item_handler(w.current()->value());
+	return queries;
+}
+
 /***********************************************************************/
 
 bool Browser::inRootDirectory()
@@ -495,9 +538,21 @@ void Browser::getDirectory(std::string directory)
 		{
 			MPD::ItemIterator end;
 			for (auto dir = Mpd.GetDirectory(directory); dir != end; ++dir)
-				w.addItem(std::move(*dir));
+			{
+				if (dir->type() == MPD::Item::Type::Song)
+					w.addItem(MPD::Item(SharedSongs.share(dir->song(), m_shared_songs)));
+				else
+					w.addItem(std::move(*dir));
+			}
 		}
 
+#		ifdef HAVE_SYS_INOTIFY_H
+		if (m_local_browser && Config.local_browser_watch_directory)
+			m_watcher.watch(directory);
+		else
+			m_watcher.stop();
+#		endif // HAVE_SYS_INOTIFY_H
+
 		if (Config.browser_sort_mode != SortMode::NoOp)
 		{
 			std::sort(w.begin() + (is_root ? 0 : 1), w.end(),
@@ -541,6 +596,109 @@ void Browser::changeBrowseMode()
 	drawHeader();
 }
 
+#ifdef HAVE_SYS_INOTIFY_H
+void Browser::applyFilesystemChanges()
+{
+	auto events = m_watcher.readEvents();
+	if (events.empty())
+		return;
+
+	// Items are inserted and removed, so remember what was highlighted.
+	std::string highlighted;
+	if (!w.empty())
+		highlighted = itemPath(w.current()->value());
+
+	bool invalidated = false;
+	{
+		ScopedUnfilteredMenu<MPD::Item> sunfilter(ReapplyFilter::Yes, w);
+		auto path = [this](const std::string &name) {
+			std::string result = m_watcher.directory();
+			if (result.back() != '/')
+				result += '/';
+			return result += name;
+		};
+		for (const auto &event : events)
+		{
+			if (!Config.local_browser_show_hidden_files && event.name[0] == '.')
+				continue;
+			switch (event.type)
+			{
+				case DirectoryWatcher::Event::Type::Created:
+				case DirectoryWatcher::Event::Type::Modified:
+					updateLocalItem(path(event.name));
+					break;
+				case DirectoryWatcher::Event::Type::Removed:
+					removeLocalItem(path(event.name));
+					break;
+				case DirectoryWatcher::Event::Type::Renamed:
+					removeLocalItem(path(event.old_name));
+					updateLocalItem(path(event.name));
+					break;
+				case DirectoryWatcher::Event::Type::Invalidated:
+					invalidated = true;
+					break;
+			}
+		}
+	}
+	if (invalidated)
+	{
+		// Watch the directory again (or find out it's gone) while reading it.
+		m_watcher.stop();
+		requestUpdate();
+		return;
+	}
+
+	for (size_t i = 0; i < w.size(); ++i)
+	{
+		if (itemPath(w[i].value()) == highlighted)
+		{
+			w.highlight(i);
+			break;
+		}
+	}
+	if (isVisible(this))
+		w.refresh();
+}
+
+void Browser::removeLocalItem(const std::string &path)
+{
+	for (size_t i = 0; i < w.size(); ++i)
+	{
+		if (itemPath(w[i].value()) == path)
+		{
+			w.deleteItem(i);
+			break;
+		}
+	}
+}
+
+void Browser::updateLocalItem(const std::string &path)
+{
+	auto item = LocalDirectory::get(path, hasSupportedExtension);
+	auto it = std::find_if(w.beginV(), w.endV(), [&path](const MPD::Item &i) {
+		return itemPath(i) == path;
+	});
+	if (it != w.endV())
+	{
+		if (item)
+			*it = std::move(*item);
+		else
+			w.deleteItem(it - w.beginV());
+	}
+	else if (item)
+	{
+		auto position = w.endV();
+		if (Config.browser_sort_mode != SortMode::NoOp)
+		{
+			position = std::upper_bound(
+				w.beginV() + (inRootDirectory() ? 0 : 1), w.endV(), *item,
+				LocaleBasedItemSorting(std::locale(), Config.ignore_leading_the, Config.browser_sort_mode));
+		}
+		w.insertItem(position - w.beginV(), std::move(*item));
+	}
+}
+#endif // HAVE_SYS_INOTIFY_H
+
 void Browser::remove(const MPD::Item &item)
 {
 	if (!Config.allow_for_physical_item_deletion)
@@ -615,76 +773,21 @@ bool isRootDirectory(const std::string &directory)
 	return directory == "/";
 }
 
-bool isHidden(const fs::directory_iterator &entry)
-{
-	return entry->path().filename().native()[0] == '.';
-}
-
-bool hasSupportedExtension(const fs::directory_entry &entry)
+bool hasSupportedExtension(const std::string &filename)
 {
-	return lm_supported_extensions.find(entry.path().extension().native())
+	return lm_supported_extensions.find(fs::path(filename).extension().native())
 	    != lm_supported_extensions.end();
 }
 
-MPD::Song getLocalSong(const fs::directory_entry &entry, bool read_tags)
-{
-	mpd_pair pair = { "file", entry.path().c_str() };
-	mpd_song *s = mpd_song_begin(&pair);
-	if (s == nullptr)
-		throw std::runtime_error("invalid path: " + entry.path().native());
-	if (read_tags)
-	{
-#ifdef HAVE_TAGLIB_H
-		Tags::setAttribute(s, "Last-Modified",
-			timeFormat("%Y-%m-%dT%H:%M:%SZ", fs::last_write_time(entry.path()))
-		);
-		// read tags
-		Tags::read(s);
-#endif // HAVE_TAGLIB_H
-	}
-	return s;
-}
-
 void getLocalDirectory(NC::Menu<MPD::Item> &menu, const std::string &directory)
 {
-	for (fs::directory_iterator entry(directory), end; entry != end; ++entry)
-	{
-		if (!Config.local_browser_show_hidden_files && isHidden(entry))
-			continue;
-
-	if (fs::is_directory(*entry))
-	{
-		menu.addItem(MPD::Directory(entry->path().native(),
-		                            fs::last_write_time(entry->path())));
-	}
-	else if (hasSupportedExtension(*entry))
-		menu.addItem(getLocalSong(*entry, true));
-	}
+	for (auto &item : LocalDirectory::list(directory, hasSupportedExtension))
+		menu.addItem(std::move(item));
 }
 
 void getLocalDirectoryRecursively(std::vector<MPD::Song> &songs, const std::string &directory)
 {
-	size_t sort_offset = songs.size();
-	for (fs::directory_iterator entry(directory), end; entry != end; ++entry)
-	{
-		if (!Config.local_browser_show_hidden_files && isHidden(entry))
-			continue;
-
-		if (fs::is_directory(*entry))
-		{
-			getLocalDirectoryRecursively(songs, entry->path().native());
-			sort_offset = songs.size();
-		}
-		else if (hasSupportedExtension(*entry))
-			songs.push_back(getLocalSong(*entry, false));
-	};
-
-	if (Config.browser_sort_mode != SortMode::NoOp)
-	{
-		std::sort(songs.begin()+sort_offset, songs.end(),
-			LocaleBasedSorting(std::locale(), Config.ignore_leading_the)
-		);
-	}
+	LocalDirectory::listRecursively(songs, directory, hasSupportedExtension);
 }
 
 void clearDirectory(const std::string &directory)
@@ -699,6 +802,20 @@ void clearDirectory(const std::string &directory)
 	};
 }
 
+std::string itemPath(const MPD::Item &item)
+{
+	switch (item.type())
+	{
+		case MPD::Item::Type::Directory:
+			return item.directory().path();
+		case MPD::Item::Type::Song:
+			return item.song().getURI();
+		case MPD::Item::Type::Playlist:
+			return item.playlist().path();
+	}
+	return "";
+}
+
 /***********************************************************************/
 
 std::string itemToString(const MPD::Item &item)
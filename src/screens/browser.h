@@ -21,11 +21,15 @@
 #ifndef NCMPCPP_BROWSER_H
 #define NCMPCPP_BROWSER_H
 
+#include "directory_watcher.h"
 #include "interfaces.h"
 #include "mpdpp.h"
 #include "regex_filter.h"
 #include "screens/screen.h"
 #include "song_list.h"
+#include "song_store.h"
+
+struct DatabaseQuery;
 
 struct BrowserWindow: NC::Menu<MPD::Item>, SongList
 {
@@ -77,6 +81,10 @@ struct Browser: Screen<BrowserWindow>, Filterable, HasSongs, Searchable, Tabbabl
 	virtual bool itemAvailable() override;
 	virtual bool addItemToPlaylist(bool play) override;
 	virtual std::vector<MPD::Song> getSelectedSongs() override;
+
+	/// Same as getSelectedSongs, but leaves fetching of the songs in
+	/// directories to the server. Not available in local browser.
+	std::vector<DatabaseQuery> getSelectedQueries();
 	
 	// private members
 	void requestUpdate() { m_update_request = true; }
@@ -92,6 +100,15 @@ struct Browser: Screen<BrowserWindow>, Filterable, HasSongs, Searchable, Tabbabl
 	void changeBrowseMode();
 	void remove(const MPD::Item &item);
 
+#	ifdef HAVE_SYS_INOTIFY_H
+	/// @return descriptor that becomes readable when the browsed local
+	/// directory changes.
+	int watcherFD() const { return m_watcher.GetFD(); }
+
+	/// Update the list with changes made to the browsed local directory.
+	void applyFilesystemChanges();
+#	endif // HAVE_SYS_INOTIFY_H
+
 	static void fetchSupportedExtensions();
 
 private:
@@ -100,6 +117,15 @@ private:
 	size_t m_scroll_beginning;
 	std::string m_current_directory;
 	Regex::Filter<MPD::Item> m_search_predicate;
+
+	SongStore::ListenerId m_shared_songs;
+
+#	ifdef HAVE_SYS_INOTIFY_H
+	void removeLocalItem(const std::string &path);
+	void updateLocalItem(const std::string &path);
+
+	DirectoryWatcher m_watcher;
+#	endif // HAVE_SYS_INOTIFY_H
 };
 
 extern Browser *myBrowser;
@@ -23,8 +23,11 @@
 #include <boost/range/algorithm_ext/erase.hpp>
 #include <cassert>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <fstream>
+#include <mutex>
 #include <thread>
 
 #include "curses/scrollpad.h"
@@ -118,6 +121,144 @@ bool saveLyrics(const std::string &filename, const std::string &lyrics)
 		return false;
 }
 
+std::string formatSeconds(std::chrono::milliseconds time)
+{
+	auto ms = time.count();
+	return std::to_string(ms / 1000) + '.' + std::to_string(ms % 1000 / 100) + 's';
+}
+
+void printFetcherStats(NC::Buffer &buf, const LyricsFetcher::Stats &stats)
+{
+	if (stats.attempts == 0)
+		return;
+	buf << " (found " << stats.successes << '/' << stats.attempts
+	    << ", avg " << formatSeconds(stats.total_time / stats.attempts) << ")";
+}
+
+/// Run the fetcher and record its outcome unless it was cancelled. Returns the
+/// result along with the time it took.
+std::pair<LyricsFetcher::Result, std::chrono::milliseconds> timedFetch(
+	LyricsFetcher &fetcher, const std::string &artist, const std::string &title,
+	const std::atomic<bool> *stopper)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto result = fetcher.fetch(artist, title, stopper);
+	auto time = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - start);
+	if (stopper == nullptr || !stopper->load())
+		fetcher.recordFetch(result.first, time);
+	return std::make_pair(std::move(result), time);
+}
+
+/// Query up to lyrics_fetchers_concurrency fetchers at once and return the
+/// result of the first fetcher (in configured order) that found lyrics as soon
+/// as all fetchers before it failed. Remaining fetchers are then cancelled.
+/// Returns none if download_stopper was set in the meantime.
+boost::optional<LyricsFetcher::Result> raceFetchers(
+	const std::string &artist, const std::string &title,
+	const std::shared_ptr<Shared<NC::Buffer>> &shared_buffer,
+	const std::shared_ptr<std::atomic<bool>> &download_stopper)
+{
+	const auto &fetchers = Config.lyrics_fetchers;
+	const size_t workers = std::min<size_t>(Config.lyrics_fetchers_concurrency,
+	                                        fetchers.size());
+
+	if (shared_buffer)
+	{
+		auto buf = shared_buffer->acquire();
+		*buf << "Fetching lyrics from " << fetchers.size() << " sources, "
+		     << workers << " at a time...\n\n";
+	}
+
+	// Losers are stopped with a separate flag so that setting it doesn't
+	// affect the caller. External cancellation is forwarded to it below.
+	std::atomic<bool> race_stopper(false);
+	std::atomic<size_t> next_fetcher(0);
+	std::vector<boost::optional<LyricsFetcher::Result>> results(fetchers.size());
+	std::mutex results_mutex;
+	std::condition_variable result_ready;
+
+	auto worker = [&] {
+		size_t i;
+		while (!race_stopper && (i = next_fetcher++) < fetchers.size())
+		{
+			std::pair<LyricsFetcher::Result, std::chrono::milliseconds> result;
+			try
+			{
+				result = timedFetch(*fetchers[i], artist, title, &race_stopper);
+			}
+			catch (std::exception &e)
+			{
+				// There is no one to propagate the exception to.
+				result.first = LyricsFetcher::Result(false, e.what());
+			}
+			if (race_stopper)
+				break;
+			if (shared_buffer)
+			{
+				auto buf = shared_buffer->acquire();
+				*buf << NC::Format::Bold << fetchers[i]->name() << NC::Format::NoBold
+				     << " (" << formatSeconds(result.second) << "): ";
+				if (result.first.first)
+					*buf << NC::Color::Green << "found" << NC::Color::End;
+				else
+					*buf << NC::Color::Red << result.first.second << NC::Color::End;
+				printFetcherStats(*buf, fetchers[i]->stats());
+				*buf << '\n';
+			}
+			{
+				std::lock_guard<std::mutex> lock(results_mutex);
+				results[i] = std::move(result.first);
+			}
+			result_ready.notify_one();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(workers);
+	for (size_t i = 0; i < workers; ++i)
+		threads.emplace_back(worker);
+
+	boost::optional<LyricsFetcher::Result> winner;
+	bool cancelled = false;
+	{
+		std::unique_lock<std::mutex> lock(results_mutex);
+		while (true)
+		{
+			// The winner is decided once every fetcher of higher priority
+			// failed, so scan results in order until the first missing one.
+			auto it = std::find_if(results.begin(), results.end(),
+			                       [](const boost::optional<LyricsFetcher::Result> &r) {
+				                       return !r || r->first;
+			                       });
+			if (it == results.end())
+			{
+				// Everything failed, report the last error.
+				winner = std::move(results.back());
+				break;
+			}
+			if (*it)
+			{
+				winner = std::move(*it);
+				break;
+			}
+			if (download_stopper && download_stopper->load())
+			{
+				cancelled = true;
+				break;
+			}
+			result_ready.wait_for(lock, std::chrono::milliseconds(100));
+		}
+	}
+	race_stopper = true;
+	for (auto &t : threads)
+		t.join();
+
+	if (cancelled)
+		return boost::none;
+	return winner;
+}
+
 boost::optional<std::string> downloadLyrics(
 	const MPD::Song &s,
 	std::shared_ptr<Shared<NC::Buffer>> shared_buffer,
@@ -147,34 +288,46 @@ boost::optional<std::string> downloadLyrics(
 				*buf << "Fetching lyrics from "
 				     << NC::Format::Bold
 				     << fetcher_->name()
-				     << NC::Format::NoBold << "... ";
+				     << NC::Format::NoBold;
+				printFetcherStats(*buf, fetcher_->stats());
+				*buf << "... ";
 			}
 		}
-		auto result_ = fetcher_->fetch(s_artist, s_title);
-		if (result_.first == false)
+		auto result_ = timedFetch(*fetcher_, s_artist, s_title, download_stopper.get());
+		if (result_.first.first == false)
 		{
 			if (shared_buffer)
 			{
 				auto buf = shared_buffer->acquire();
 				*buf << NC::Color::Red
-				     << result_.second
+				     << result_.first.second
 				     << NC::Color::End
 				     << '\n';
 			}
 		}
-		return result_;
+		return result_.first;
 	};
 
 	LyricsFetcher::Result fetcher_result;
 	if (current_fetcher == nullptr)
 	{
-		for (auto &fetcher : Config.lyrics_fetchers)
+		if (Config.lyrics_fetchers_concurrency > 1 && Config.lyrics_fetchers.size() > 1)
 		{
-			if (download_stopper && download_stopper->load())
+			auto race_result = raceFetchers(s_artist, s_title, shared_buffer, download_stopper);
+			if (!race_result)
 				return boost::none;
-			fetcher_result = fetch_lyrics(fetcher);
-			if (fetcher_result.first)
-				break;
+			fetcher_result = std::move(*race_result);
+		}
+		else
+		{
+			for (auto &fetcher : Config.lyrics_fetchers)
+			{
+				if (download_stopper && download_stopper->load())
+					return boost::none;
+				fetcher_result = fetch_lyrics(fetcher);
+				if (fetcher_result.first)
+					break;
+			}
 		}
 	}
 	else
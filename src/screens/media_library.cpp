@@ -23,8 +23,12 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <functional>
+#include <map>
+#include <set>
 
 #include "charset.h"
+#include "database_cache.h"
 #include "display.h"
 #include "helpers.h"
 #include "global.h"
@@ -71,20 +75,47 @@ std::string Date_(std::string date)
 	return date;
 }
 
-MPD::SongIterator getSongsFromAlbum(const AlbumEntry &album)
+DatabaseQuery::Tags albumTags(const AlbumEntry &album, bool album_only)
 {
-	Mpd.StartSearch(true);
-	if (!isAlbumOnly)
-		Mpd.AddSearch(Config.media_lib_primary_tag, album.entry().tag());
+	DatabaseQuery::Tags tags;
+	if (!album_only)
+		tags.emplace_back(Config.media_lib_primary_tag, album.entry().tag());
 	if (!album.isAllTracksEntry())
 	{
-		Mpd.AddSearch(MPD_TAG_ALBUM, album.entry().album());
-		if(!isAlbumOnly) {
+		tags.emplace_back(MPD_TAG_ALBUM, album.entry().album());
+		if(!album_only) {
 			if (Config.media_library_albums_split_by_date)
-				Mpd.AddSearch(MPD_TAG_DATE, album.entry().date());
+				tags.emplace_back(MPD_TAG_DATE, album.entry().date());
 		}
 	}
-	return Mpd.CommitSearchSongs();
+	return tags;
+}
+
+std::vector<MPD::Song> getSongsFromAlbum(const LibraryIndex &index,
+                                         const AlbumEntry &album, bool album_only)
+{
+	const LibraryIndex::Album *result;
+	if (album_only)
+		result = index.album(album.entry().album());
+	else if (album.isAllTracksEntry())
+		return index.songs(album.entry().tag());
+	else
+		result = index.album(album.entry().tag(),
+		                     LibraryIndex::AlbumKey(album.entry().album(),
+		                                            album.entry().date()));
+	if (result != nullptr)
+		return result->songs;
+	else
+		return std::vector<MPD::Song>();
+}
+
+MPD::SongIterator searchSongsFromAlbum(MPD::Connection &mpd, const AlbumEntry &album,
+                                       bool album_only)
+{
+	mpd.StartSearch(true);
+	for (const auto &tag : albumTags(album, album_only))
+		mpd.AddSearch(tag.first, tag.second);
+	return mpd.CommitSearchSongs();
 }
 
 std::string AlbumToString(const AlbumEntry &ae);
@@ -97,97 +128,193 @@ bool SongEntryMatcher(const Regex::Regex &rx, const MPD::Song &s);
 bool MoveToTag(NC::Menu<PrimaryTag> &tags, const std::string &primary_tag);
 bool MoveToAlbum(NC::Menu<AlbumEntry> &albums, const std::string &primary_tag, const MPD::Song &s);
 
-struct SortSongs {
-	typedef NC::Menu<MPD::Song>::Item SongItem;
-	
-	static const std::array<MPD::Song::GetFunction, 3> GetFuns;
-	
-	LocaleStringComparison m_cmp;
+// Songs are sorted by date, album, disc and track number. If these are
+// equal, songs are sorted by the display format.
+class SongSortKeys
+{
+	typedef std::tuple<SortKey, SortKey, SortKey, bool, int, std::string, std::string> Key;
+
+	SortKeyCache m_keys;
 
 public:
-	SortSongs()
-	: m_cmp(std::locale(), Config.ignore_leading_the) { }
-	
-	bool operator()(const SongItem &a, const SongItem &b) {
-		return (*this)(a.value(), b.value());
-	}
-	bool operator()(const MPD::Song &a, const MPD::Song &b) {
-		int ret;
-		for (auto get : GetFuns) {
-			ret = m_cmp(a.getTags(get), b.getTags(get));
-			if (ret != 0)
-				return ret < 0;
-		}
+	SongSortKeys() : m_keys(std::locale(), Config.ignore_leading_the) { }
 
-		// Sort by track numbers.
+	Key operator()(const NC::Menu<MPD::Song>::Item &item) {
+		return (*this)(item.value());
+	}
+	Key operator()(const MPD::Song &s) {
+		// Numeric track numbers go first and are compared as numbers.
+		bool numeric_track = true;
+		int track = 0;
 		try {
-			ret = boost::lexical_cast<int>(a.getTags(&MPD::Song::getTrackNumber))
-			    - boost::lexical_cast<int>(b.getTags(&MPD::Song::getTrackNumber));
+			track = boost::lexical_cast<int>(s.getTags(&MPD::Song::getTrackNumber));
 		} catch (boost::bad_lexical_cast &) {
-			ret = a.getTrackNumber().compare(b.getTrackNumber());
+			numeric_track = false;
 		}
-		if (ret != 0)
-			return ret < 0;
-
-		// If track numbers are equal, sort by the display format.
-		return Format::stringify<char>(Config.song_library_format, &a)
-		     < Format::stringify<char>(Config.song_library_format, &b);
+		return Key(m_keys(s.getTags(&MPD::Song::getDate)),
+		           m_keys(s.getTags(&MPD::Song::getAlbum)),
+		           m_keys(s.getTags(&MPD::Song::getDisc)),
+		           !numeric_track,
+		           track,
+		           numeric_track ? std::string() : s.getTrackNumber(),
+		           Format::stringify<char>(Config.song_library_format, &s));
 	}
 };
 
-const std::array<MPD::Song::GetFunction, 3> SortSongs::GetFuns = {{
-	&MPD::Song::getDate,
-	&MPD::Song::getAlbum,
-	&MPD::Song::getDisc
-}};
+class AlbumSortKeys
+{
+	typedef std::tuple<SortKey, SortKey, SortKey> Key;
 
-class SortAlbumEntries {
-	typedef MediaLibrary::Album Album;
-	
-	LocaleStringComparison m_cmp;
+	SortKeyCache m_keys;
 
 public:
-	SortAlbumEntries() : m_cmp(std::locale(), Config.ignore_leading_the) { }
-	
-	bool operator()(const AlbumEntry &a, const AlbumEntry &b) const {
-		return (*this)(a.entry(), b.entry());
+	AlbumSortKeys() : m_keys(std::locale(), Config.ignore_leading_the) { }
+
+	Key operator()(const AlbumEntry &a) {
+		return Key(m_keys(a.entry().tag()),
+		           m_keys(a.entry().date()),
+		           m_keys(a.entry().album()));
+	}
+};
+
+template <typename IteratorT>
+void sortSongs(IteratorT first, IteratorT last)
+{
+	sortByKey(first, last, SongSortKeys());
+}
+
+template <typename IteratorT>
+void sortAlbumEntries(IteratorT first, IteratorT last)
+{
+	if (Config.media_library_sort_by_mtime)
+		sortByKey(first, last, [](const AlbumEntry &a) { return -a.entry().mtime(); });
+	else
+		sortByKey(first, last, AlbumSortKeys());
+}
+
+template <typename IteratorT>
+void sortPrimaryTags(IteratorT first, IteratorT last)
+{
+	if (Config.media_library_sort_by_mtime)
+		sortByKey(first, last, [](const PrimaryTag &a) { return -a.mtime(); });
+	else
+	{
+		SortKeyCache keys(std::locale(), Config.ignore_leading_the);
+		sortByKey(first, last, [&keys](const PrimaryTag &a) { return keys(a.tag()); });
 	}
+}
 
-	bool operator()(const Album &a, const Album &b) const {
-		if (Config.media_library_sort_by_mtime)
-			return a.mtime() > b.mtime();
+typedef std::tuple<std::string, std::string, std::string> AlbumKey;
+
+template <typename F>
+void forEachPrimaryTag(const MPD::Song &s, F f)
+{
+	std::string tag;
+	unsigned idx = 0;
+	while (!(tag = s.get(Config.media_lib_primary_tag, idx++)).empty())
+		f(std::move(tag));
+}
+
+// Key of an album in two column mode, see MediaLibrary::update.
+AlbumKey makeAlbumKey(std::string tag, const MPD::Song &s)
+{
+	if (isAlbumOnly)
+		return AlbumKey("", s.getAlbum(), "");
+	else
+		return AlbumKey(std::move(tag), s.getAlbum(), Date_(s.getDate()));
+}
+
+AlbumKey makeAlbumKey(const AlbumEntry &entry)
+{
+	return AlbumKey(entry.entry().tag(), entry.entry().album(), entry.entry().date());
+}
+
+bool isSameAlbum(const AlbumEntry &a, const AlbumEntry &b)
+{
+	return a.isAllTracksEntry() == b.isAllTracksEntry()
+	    && makeAlbumKey(a) == makeAlbumKey(b);
+}
+
+// Replace items of the menu with the given ones, reusing existing items.
+template <typename ItemT>
+void replaceItems(NC::Menu<ItemT> &menu, std::vector<ItemT> items)
+{
+	size_t idx = 0;
+	for (auto &item : items)
+	{
+		if (idx < menu.size())
+		{
+			menu[idx].value() = std::move(item);
+			menu[idx].setSeparator(false);
+		}
+		else
+			menu.addItem(std::move(item));
+		++idx;
+	}
+	if (idx < menu.size())
+		menu.resizeList(idx);
+}
+
+// Replace items of the menu whose keys were affected by the database change
+// with their current versions (or remove them if they're gone) and leave the
+// rest intact. Returns true if the highlighted item was affected.
+template <typename ItemT, typename KeyT, typename KeyFunction, typename MakeItem, typename Sort>
+bool patchMenu(NC::Menu<ItemT> &menu,
+               const std::set<KeyT> &affected,
+               std::map<KeyT, time_t> current,
+               KeyFunction key, MakeItem make_item, Sort sort)
+{
+	ScopedUnfilteredMenu<ItemT> sunfilter(ReapplyFilter::Yes, menu);
+	if (menu.empty())
+		return false;
+
+	KeyT highlighted = key(menu.current()->value());
+	std::vector<ItemT> items;
+	items.reserve(menu.size() + current.size());
+	for (auto it = menu.beginV(); it != menu.endV(); ++it)
+	{
+		auto k = key(*it);
+		if (affected.count(k) == 0)
+			items.push_back(std::move(*it));
 		else
 		{
-			int result;
-			result = m_cmp(a.tag(), b.tag());
-			if (result != 0)
-				return result < 0;
-			result = m_cmp(a.date(), b.date());
-			if (result != 0)
-				return result < 0;
-			return m_cmp(a.album(), b.album()) < 0;
+			auto c = current.find(k);
+			if (c != current.end())
+			{
+				items.push_back(make_item(c->first, c->second));
+				current.erase(c);
+			}
 		}
 	}
-};
+	for (const auto &c : current)
+		items.push_back(make_item(c.first, c.second));
+	sort(items.begin(), items.end());
 
-class SortPrimaryTags {
-	LocaleStringComparison m_cmp;
-	
-public:
-	SortPrimaryTags() : m_cmp(std::locale(), Config.ignore_leading_the) { }
-	
-	bool operator()(const PrimaryTag &a, const PrimaryTag &b) const {
-		if (Config.media_library_sort_by_mtime)
-			return a.mtime() > b.mtime();
+	size_t idx = 0;
+	for (auto &item : items)
+	{
+		bool is_highlighted = key(item) == highlighted;
+		if (idx < menu.size())
+			menu[idx].value() = std::move(item);
 		else
-			return m_cmp(a.tag(), b.tag()) < 0;
+			menu.addItem(std::move(item));
+		if (is_highlighted)
+			menu.highlight(idx);
+		++idx;
 	}
-};
+	if (idx < menu.size())
+		menu.resizeList(idx);
+	return affected.count(highlighted) > 0;
+}
 
 }
 
 MediaLibrary::MediaLibrary()
-: m_timer(boost::posix_time::from_time_t(0))
+: m_tags_update_request(false)
+, m_albums_update_request(false)
+, m_songs_update_request(false)
+, m_index_generation(0)
+, m_timer(boost::posix_time::from_time_t(0))
 , m_window_timeout(Config.data_fetching_delay ? 250 : BaseScreen::defaultWindowTimeout)
 , m_fetching_delay(boost::posix_time::milliseconds(Config.data_fetching_delay ? 250 : -1))
 {
@@ -232,6 +359,10 @@ MediaLibrary::MediaLibrary()
 	Songs.setItemDisplayer(std::bind(
 		Display::Songs, ph::_1, std::cref(Songs), std::cref(Config.song_library_format)
 	));
+
+	m_shared_songs = SharedSongs.addListener([this](const SongStore::SongSet &updated) {
+		replaceUpdatedSongs(Songs, updated);
+	});
 	
 	w = &Tags;
 }
@@ -296,6 +427,24 @@ std::wstring MediaLibrary::title()
 
 void MediaLibrary::update()
 {
+	// Wait for the database fetched in the background instead of
+	// blocking until it arrives.
+	if (!Database.fetching()
+	    && (m_index_generation != Database.generation()
+	        || m_index.primaryTag() != Config.media_lib_primary_tag))
+	{
+		const auto &songs = Database.songs(Mpd);
+		m_index.build(songs, Config.media_lib_primary_tag,
+		              Config.media_library_albums_split_by_date);
+		m_index_generation = Database.generation();
+		m_tags_update_request = true;
+		m_albums_update_request = true;
+		m_songs_update_request = true;
+	}
+	// If the database is not available locally (e.g. the server refused
+	// listallinfo), list tags and search for albums and songs on the server.
+	bool use_index = !m_index.empty();
+
 	if (hasTwoColumns)
 	{
 		ScopedUnfilteredMenu<AlbumEntry> sunfilter_albums(ReapplyFilter::No, Albums);
@@ -303,54 +452,24 @@ void MediaLibrary::update()
 		{
 			m_albums_update_request = false;
 			sunfilter_albums.set(ReapplyFilter::Yes, true);
-			std::map<std::tuple<std::string, std::string, std::string>, time_t> albums;
-			for (MPD::SongIterator s = getDatabaseIterator(Mpd), end; s != end; ++s)
+			std::vector<AlbumEntry> albums;
+			if (isAlbumOnly)
 			{
-				std::string tag;
-				unsigned idx = 0;
-				while (!(tag = s->get(Config.media_lib_primary_tag, idx++)).empty())
-				{
-					if (isAlbumOnly) {
-						auto key = std::make_tuple(
-							"",
-							s->getAlbum(),
-							"");
-						auto it = albums.find(key);
-						if (it == albums.end())
-							albums[std::move(key)] = s->getMTime();
-						else
-							it->second = s->getMTime();
-					}
-					else {
-						auto key = std::make_tuple(
-							std::move(tag),
-							s->getAlbum(),
-							Date_(s->getDate()));
-						auto it = albums.find(key);
-						if (it == albums.end())
-							albums[std::move(key)] = s->getMTime();
-						else
-							it->second = s->getMTime();
-					}
-				}
+				albums.reserve(m_index.albums().size());
+				for (const auto &album : m_index.albums())
+					albums.emplace_back(Album("", album.first, "", album.second.mtime));
 			}
-			size_t idx = 0;
-			for (const auto &album : albums)
+			else
 			{
-				auto entry = AlbumEntry(
-					Album(std::move(std::get<0>(album.first)),
-					      std::move(std::get<1>(album.first)),
-					      std::move(std::get<2>(album.first)),
-					      album.second));
-				if (idx < Albums.size())
-					Albums[idx].value() = std::move(entry);
-				else
-					Albums.addItem(std::move(entry));
-				++idx;
+				for (const auto &tag : m_index.tags())
+					for (const auto &album : tag.second.albums)
+						albums.emplace_back(Album(tag.first,
+						                          album.first.first,
+						                          album.first.second,
+						                          album.second.mtime));
 			}
-			if (idx < Albums.size())
-				Albums.resizeList(idx);
-			std::sort(Albums.beginV(), Albums.endV(), SortAlbumEntries());
+			sortAlbumEntries(albums.begin(), albums.end());
+			replaceItems(Albums, std::move(albums));
 		}
 	}
 	else
@@ -361,87 +480,92 @@ void MediaLibrary::update()
 			{
 				m_tags_update_request = false;
 				sunfilter_tags.set(ReapplyFilter::Yes, true);
-				std::map<std::string, time_t> tags;
-				if (Config.media_library_sort_by_mtime)
+				std::vector<PrimaryTag> tags;
+				if (use_index)
 				{
-					for (MPD::SongIterator s = getDatabaseIterator(Mpd), end; s != end; ++s)
-					{
-						std::string tag;
-						unsigned idx = 0;
-						while (!(tag = s->get(Config.media_lib_primary_tag, idx++)).empty())
-						{
-							auto it = tags.find(tag);
-							if (it == tags.end())
-								tags[std::move(tag)] = s->getMTime();
-							else
-								it->second = std::max(it->second, s->getMTime());
-						}
-					}
+					tags.reserve(m_index.tags().size());
+					for (const auto &tag : m_index.tags())
+						tags.emplace_back(tag.first, tag.second.mtime);
 				}
 				else
 				{
 					MPD::StringIterator tag = Mpd.GetList(Config.media_lib_primary_tag), end;
 					for (; tag != end; ++tag)
-						tags[std::move(*tag)] = 0;
-				}
-				size_t idx = 0;
-				for (const auto &tag : tags)
-				{
-					auto ptag = PrimaryTag(std::move(tag.first), tag.second);
-					if (idx < Tags.size())
-						Tags[idx].value() = std::move(ptag);
-					else
-						Tags.addItem(std::move(ptag));
-					++idx;
+						tags.emplace_back(std::move(*tag), 0);
 				}
-				if (idx < Tags.size())
-					Tags.resizeList(idx);
-				std::sort(Tags.beginV(), Tags.endV(), SortPrimaryTags());
+				sortPrimaryTags(tags.begin(), tags.end());
+				replaceItems(Tags, std::move(tags));
 			}
 		}
 
 		{
 			ScopedUnfilteredMenu<AlbumEntry> sunfilter_albums(ReapplyFilter::No, Albums);
-			if (!Tags.empty()
-			    && ((Albums.empty() && Global::Timer - m_timer > m_fetching_delay)
-			        || m_albums_update_request))
+			std::vector<AlbumEntry> albums;
+			bool albums_ready = false;
+			if (use_index)
 			{
-				m_albums_update_request = false;
-				sunfilter_albums.set(ReapplyFilter::Yes, true);
-				auto &primary_tag = Tags.current()->value().tag();
-				Mpd.StartSearch(true);
-				Mpd.AddSearch(Config.media_lib_primary_tag, primary_tag);
-				std::map<std::tuple<std::string, std::string>, time_t> albums;
-				for (MPD::SongIterator s = Mpd.CommitSearchSongs(), end; s != end; ++s)
+				if (!Tags.empty() && (Albums.empty() || m_albums_update_request))
+				{
+					m_albums_update_request = false;
+					const auto &primary_tag = Tags.current()->value().tag();
+					if (auto tag = m_index.tag(primary_tag))
+					{
+						albums.reserve(tag->albums.size());
+						for (const auto &album : tag->albums)
+							albums.emplace_back(Album(primary_tag,
+							                          album.first.first,
+							                          album.first.second,
+							                          album.second.mtime));
+					}
+					albums_ready = true;
+				}
+			}
+			else
+			{
+				if (!Tags.empty())
 				{
-					auto key = std::make_tuple(s->getAlbum(), Date_(s->getDate()));
-					auto it = albums.find(key);
-					if (it == albums.end())
-						albums[std::move(key)] = s->getMTime();
-					else
-						it->second = std::max(it->second, s->getMTime());
-				};
-				size_t idx = 0;
-				for (const auto &album : albums)
+					const auto &primary_tag = Tags.current()->value().tag();
+					bool fetching = m_albums_fetch.valid() && m_albums_fetch_tag == primary_tag;
+					if ((Albums.empty() && !fetching && Global::Timer - m_timer > m_fetching_delay)
+					    || m_albums_update_request)
+					{
+						m_albums_update_request = false;
+						m_albums_fetch_tag = primary_tag;
+						m_albums_fetch = AsyncMpd.fetchSongs(
+							[primary_tag](MPD::Connection &mpd) {
+								mpd.StartSearch(true);
+								mpd.AddSearch(Config.media_lib_primary_tag, primary_tag);
+								return mpd.CommitSearchSongs();
+							}, redrawWhenVisible(this));
+					}
+				}
+				std::vector<MPD::Song> songs;
+				// Discard albums of a tag that is no longer selected.
+				if (takeFetchedSongs(m_albums_fetch, songs)
+				    && !Tags.empty() && Tags.current()->value().tag() == m_albums_fetch_tag)
 				{
-					auto entry = AlbumEntry(
-						Album(primary_tag,
-						      std::move(std::get<0>(album.first)),
-						      std::move(std::get<1>(album.first)),
-						      album.second));
-					if (idx < Albums.size())
+					std::map<std::tuple<std::string, std::string>, time_t> mtimes;
+					for (const auto &s : songs)
 					{
-						Albums[idx].value() = std::move(entry);
-						Albums[idx].setSeparator(false);
+						auto &mtime = mtimes[std::make_tuple(s.getAlbum(), Date_(s.getDate()))];
+						mtime = std::max(mtime, s.getMTime());
 					}
-					else
-						Albums.addItem(std::move(entry));
-					++idx;
+					for (const auto &album : mtimes)
+						albums.emplace_back(Album(m_albums_fetch_tag,
+						                          std::get<0>(album.first),
+						                          std::get<1>(album.first),
+						                          album.second));
+					albums_ready = true;
 				}
-				if (idx < Albums.size())
-					Albums.resizeList(idx);
-				std::sort(Albums.beginV(), Albums.endV(), SortAlbumEntries());
-				if (albums.size() > 1)
+			}
+			if (albums_ready)
+			{
+				sunfilter_albums.set(ReapplyFilter::Yes, true);
+				const auto &primary_tag = Tags.current()->value().tag();
+				sortAlbumEntries(albums.begin(), albums.end());
+				size_t album_count = albums.size();
+				replaceItems(Albums, std::move(albums));
+				if (album_count > 1)
 				{
 					Albums.addSeparator();
 					Albums.addItem(AlbumEntry::mkAllTracksEntry(primary_tag));
@@ -451,25 +575,44 @@ void MediaLibrary::update()
 	}
 
 	ScopedUnfilteredMenu<MPD::Song> sunfilter_songs(ReapplyFilter::No, Songs);
-	if (!Albums.empty()
-	    && ((Songs.empty() && Global::Timer - m_timer > m_fetching_delay)
-	        || m_songs_update_request))
+	std::vector<MPD::Song> songs;
+	bool songs_ready = false;
+	if (use_index)
 	{
-		m_songs_update_request = false;
-		sunfilter_songs.set(ReapplyFilter::Yes, true);
-		auto &album = Albums.current()->value();
-		size_t idx = 0;
-		for (MPD::SongIterator s = getSongsFromAlbum(album), end;
-		     s != end; ++s, ++idx)
+		if (!Albums.empty() && (Songs.empty() || m_songs_update_request))
 		{
-			if (idx < Songs.size())
-				Songs[idx].value() = std::move(*s);
-			else
-				Songs.addItem(std::move(*s));
-		};
-		if (idx < Songs.size())
-			Songs.resizeList(idx);
-		std::sort(Songs.begin(), Songs.end(), SortSongs());
+			m_songs_update_request = false;
+			songs = getSongsFromAlbum(m_index, Albums.current()->value(), isAlbumOnly);
+			songs_ready = true;
+		}
+	}
+	else
+	{
+		if (!Albums.empty())
+		{
+			const auto &album = Albums.current()->value();
+			bool fetching = m_songs_fetch.valid() && isSameAlbum(m_songs_fetch_album, album);
+			if ((Songs.empty() && !fetching && Global::Timer - m_timer > m_fetching_delay)
+			    || m_songs_update_request)
+			{
+				m_songs_update_request = false;
+				m_songs_fetch_album = album;
+				m_songs_fetch = AsyncMpd.fetchSongs(
+					[album, album_only = isAlbumOnly](MPD::Connection &mpd) {
+						return searchSongsFromAlbum(mpd, album, album_only);
+					}, redrawWhenVisible(this));
+			}
+		}
+		// Discard songs of an album that is no longer selected.
+		songs_ready = takeFetchedSongs(m_songs_fetch, songs)
+			&& !Albums.empty() && isSameAlbum(Albums.current()->value(), m_songs_fetch_album);
+	}
+	if (songs_ready)
+	{
+		sunfilter_songs.set(ReapplyFilter::Yes, true);
+		SharedSongs.shareAll(songs.begin(), songs.end(), m_shared_songs);
+		sortSongs(songs.begin(), songs.end());
+		replaceItems(Songs, std::move(songs));
 	}
 }
 
@@ -477,7 +620,8 @@ int MediaLibrary::windowTimeout()
 {
 	ScopedUnfilteredMenu<AlbumEntry> sunfilter_albums(ReapplyFilter::No, Albums);
 	ScopedUnfilteredMenu<MPD::Song> sunfilter_songs(ReapplyFilter::No, Songs);
-	if (Albums.empty() || Songs.empty())
+	// Columns are fetched from the server after a delay.
+	if (m_index.empty() && (Albums.empty() || Songs.empty()))
 		return m_window_timeout;
 	else
 		return Screen<WindowType>::windowTimeout();
@@ -716,13 +860,9 @@ bool MediaLibrary::addItemToPlaylist(bool play)
 		if (isActiveWindow(Tags)
 		||  (isActiveWindow(Albums) && Albums.current()->value().isAllTracksEntry()))
 		{
-			Mpd.StartSearch(true);
-			Mpd.AddSearch(Config.media_lib_primary_tag, Tags.current()->value().tag());
-			std::vector<MPD::Song> list(
-				std::make_move_iterator(Mpd.CommitSearchSongs()),
-				std::make_move_iterator(MPD::SongIterator()));
-			std::sort(list.begin(), list.end(), SortSongs());
-			result = addSongsToPlaylist(list.begin(), list.end(), play, -1);
+			DatabaseQuery query(DatabaseQuery::Tags{
+				{Config.media_lib_primary_tag, Tags.current()->value().tag()}});
+			result = addQueriesToPlaylist({query}, play, -1);
 			std::string tag_type = boost::locale::to_lower(
 				tagTypeToString(Config.media_lib_primary_tag));
 			Statusbar::printf("Songs with %1% \"%2%\" added%3%",
@@ -730,11 +870,8 @@ bool MediaLibrary::addItemToPlaylist(bool play)
 		}
 		else if (isActiveWindow(Albums))
 		{
-			std::vector<MPD::Song> list(
-				std::make_move_iterator(getSongsFromAlbum(Albums.current()->value())),
-				std::make_move_iterator(MPD::SongIterator()));
-			std::sort(list.begin(), list.end(), SortSongs());
-			result = addSongsToPlaylist(list.begin(), list.end(), play, -1);
+			DatabaseQuery query(albumTags(Albums.current()->value(), isAlbumOnly));
+			result = addQueriesToPlaylist({query}, play, -1);
 			Statusbar::printf("Songs from album \"%1%\" added%2%",
 				Albums.current()->value().entry().album(), withErrors(result));
 		}
@@ -744,18 +881,31 @@ bool MediaLibrary::addItemToPlaylist(bool play)
 
 std::vector<MPD::Song> MediaLibrary::getSelectedSongs()
 {
+	if (isActiveWindow(Songs))
+		return Songs.getSelectedSongs();
 	std::vector<MPD::Song> result;
+	for (const auto &query : getSelectedQueries())
+	{
+		size_t begin = result.size();
+		Mpd.StartSearch(true);
+		for (const auto &tag : query.tags)
+			Mpd.AddSearch(tag.first, tag.second);
+		std::copy(
+			std::make_move_iterator(Mpd.CommitSearchSongs()),
+			std::make_move_iterator(MPD::SongIterator()),
+			std::back_inserter(result));
+		sortSongs(result.begin()+begin, result.end());
+	}
+	return result;
+}
+
+std::vector<DatabaseQuery> MediaLibrary::getSelectedQueries()
+{
+	std::vector<DatabaseQuery> result;
 	if (isActiveWindow(Tags))
 	{
 		auto tag_handler = [&result](const std::string &tag) {
-			Mpd.StartSearch(true);
-			Mpd.AddSearch(Config.media_lib_primary_tag, tag);
-			size_t begin = result.size();
-			std::copy(
-				std::make_move_iterator(Mpd.CommitSearchSongs()),
-				std::make_move_iterator(MPD::SongIterator()),
-				std::back_inserter(result));
-			std::sort(result.begin()+begin, result.end(), SortSongs());
+			result.emplace_back(DatabaseQuery::Tags{{Config.media_lib_primary_tag, tag}});
 		};
 		bool any_selected = false;
 		for (auto &e : Tags)
@@ -779,38 +929,27 @@ std::vector<MPD::Song> MediaLibrary::getSelectedSongs()
 			{
 				any_selected = true;
 				auto &sc = it->value();
-				Mpd.StartSearch(true);
+				DatabaseQuery::Tags tags;
 				if (hasTwoColumns)
-					Mpd.AddSearch(Config.media_lib_primary_tag, sc.entry().tag());
+					tags.emplace_back(Config.media_lib_primary_tag, sc.entry().tag());
 				else
-					Mpd.AddSearch(Config.media_lib_primary_tag,
-					              Tags.current()->value().tag());
-				Mpd.AddSearch(MPD_TAG_ALBUM, sc.entry().album());
+					tags.emplace_back(Config.media_lib_primary_tag,
+					                  Tags.current()->value().tag());
+				tags.emplace_back(MPD_TAG_ALBUM, sc.entry().album());
 				if (Config.media_library_albums_split_by_date)
-					Mpd.AddSearch(MPD_TAG_DATE, sc.entry().date());
-				size_t begin = result.size();
-				std::copy(
-					std::make_move_iterator(Mpd.CommitSearchSongs()),
-					std::make_move_iterator(MPD::SongIterator()),
-					std::back_inserter(result));
-				std::sort(result.begin()+begin, result.end(), SortSongs());
+					tags.emplace_back(MPD_TAG_DATE, sc.entry().date());
+				result.emplace_back(std::move(tags));
 			}
 		}
 		// if no item is selected, add songs from right column
-		ScopedUnfilteredMenu<MPD::Song> sunfilter_songs(ReapplyFilter::No, Songs);
 		if (!any_selected && !Albums.empty())
-		{
-			size_t begin = result.size();
-			std::copy(
-				std::make_move_iterator(getSongsFromAlbum(Albums.current()->value())),
-				std::make_move_iterator(MPD::SongIterator()),
-				std::back_inserter(result)
-			);
-			std::sort(result.begin()+begin, result.end(), SortSongs());
-		}
+			result.emplace_back(albumTags(Albums.current()->value(), isAlbumOnly));
 	}
 	else if (isActiveWindow(Songs))
-		result = Songs.getSelectedSongs();
+	{
+		for (auto &s : Songs.getSelectedSongs())
+			result.emplace_back(std::move(s));
+	}
 	return result;
 }
 
@@ -890,6 +1029,16 @@ void MediaLibrary::nextColumn()
 
 /***********************************************************************/
 
+void MediaLibrary::updateAndWait()
+{
+	update();
+	if (m_albums_fetch.valid())
+		m_albums_fetch.wait();
+	if (m_songs_fetch.valid())
+		m_songs_fetch.wait();
+	update();
+}
+
 void MediaLibrary::updateTimer()
 {
 	m_timer = Global::Timer;
@@ -949,7 +1098,7 @@ void MediaLibrary::toggleSortMode()
 	if (hasTwoColumns)
 	{
 		ScopedUnfilteredMenu<AlbumEntry> sunfilter_albums(ReapplyFilter::No, Albums);
-		std::sort(Albums.beginV(), Albums.endV(), SortAlbumEntries());
+		sortAlbumEntries(Albums.beginV(), Albums.endV());
 		Albums.refresh();
 		Songs.clear();
 		if (Config.titles_visibility)
@@ -969,20 +1118,89 @@ void MediaLibrary::toggleSortMode()
 	else
 	{
 		ScopedUnfilteredMenu<PrimaryTag> sunfilter_tags(ReapplyFilter::No, Tags);
-		// if we already have modification times, just resort. otherwise refetch the list.
-		if (!Tags.empty() && Tags[0].value().mtime() > 0)
+		sortPrimaryTags(Tags.beginV(), Tags.endV());
+		Tags.refresh();
+		Albums.clear();
+		Songs.clear();
+	}
+	update();
+}
+
+void MediaLibrary::applyDatabaseDiff(const DatabaseCache::Diff &diff)
+{
+	if (diff.empty())
+		return;
+	// Outdated index is rebuilt on the next update anyway.
+	if (m_index_generation != Database.generation()
+	||  m_index.primaryTag() != Config.media_lib_primary_tag)
+		return;
+	m_index.update(diff.removed, diff.added);
+
+	auto for_each_changed = [&diff](std::function<void(const MPD::Song &)> f) {
+		std::for_each(diff.removed.begin(), diff.removed.end(), f);
+		std::for_each(diff.added.begin(), diff.added.end(), f);
+	};
+
+	if (hasTwoColumns)
+	{
+		std::set<AlbumKey> affected;
+		for_each_changed([&](const MPD::Song &s) {
+			if (isAlbumOnly)
+				affected.insert(makeAlbumKey("", s));
+			else
+				forEachPrimaryTag(s, [&](std::string tag) {
+					affected.insert(makeAlbumKey(std::move(tag), s));
+				});
+		});
+		std::map<AlbumKey, time_t> albums;
+		for (const auto &key : affected)
 		{
-			std::sort(Tags.beginV(), Tags.endV(), SortPrimaryTags());
-			Tags.refresh();
+			const LibraryIndex::Album *album;
+			if (isAlbumOnly)
+				album = m_index.album(std::get<1>(key));
+			else
+				album = m_index.album(std::get<0>(key),
+				                      LibraryIndex::AlbumKey(std::get<1>(key), std::get<2>(key)));
+			if (album != nullptr)
+				albums.emplace(key, album->mtime);
 		}
-		else
+		bool highlighted_changed = patchMenu(Albums, affected, std::move(albums),
+			static_cast<AlbumKey (*)(const AlbumEntry &)>(makeAlbumKey),
+			[](const AlbumKey &key, time_t mtime) {
+				return AlbumEntry(Album(std::get<0>(key), std::get<1>(key), std::get<2>(key), mtime));
+			},
+			[](std::vector<AlbumEntry>::iterator first, std::vector<AlbumEntry>::iterator last) {
+				sortAlbumEntries(first, last);
+			});
+		if (highlighted_changed)
+			requestSongsUpdate();
+	}
+	else
+	{
+		std::set<std::string> affected;
+		for_each_changed([&](const MPD::Song &s) {
+			forEachPrimaryTag(s, [&](std::string tag) {
+				affected.insert(std::move(tag));
+			});
+		});
+		std::map<std::string, time_t> tags;
+		for (const auto &name : affected)
 		{
-			Tags.clear();
+			if (auto tag = m_index.tag(name))
+				tags.emplace(name, tag->mtime);
+		}
+		bool highlighted_changed = patchMenu(Tags, affected, std::move(tags),
+			[](const PrimaryTag &tag) { return tag.tag(); },
+			[](const std::string &tag, time_t mtime) { return PrimaryTag(tag, mtime); },
+			[](std::vector<PrimaryTag>::iterator first, std::vector<PrimaryTag>::iterator last) {
+				sortPrimaryTags(first, last);
+			});
+		if (highlighted_changed)
+		{
+			requestAlbumsUpdate();
+			requestSongsUpdate();
 		}
-		Albums.clear();
-		Songs.clear();
 	}
-	update();
 }
 
 void MediaLibrary::locateSong(const MPD::Song &s)
@@ -1024,7 +1242,7 @@ void MediaLibrary::locateSong(const MPD::Song &s)
 			// possible to list all of the library, e.g. mopidy with mopidy-spotify.
 			// To workaround this we simply insert the missing tag.
 			Tags.addItem(PrimaryTag(primary_tag, s.getMTime()));
-			std::sort(Tags.beginV(), Tags.endV(), SortPrimaryTags());
+			sortPrimaryTags(Tags.beginV(), Tags.endV());
 			Tags.refresh();
 			MoveToTag(Tags, primary_tag);
 		}
@@ -1035,7 +1253,7 @@ void MediaLibrary::locateSong(const MPD::Song &s)
 	if (Albums.empty())
 	{
 		requestAlbumsUpdate();
-		update();
+		updateAndWait();
 	}
 
 	// When you locate a song in the media library, if no albums or no songs
@@ -1068,14 +1286,14 @@ void MediaLibrary::locateSong(const MPD::Song &s)
 			                                s.getAlbum(),
 			                                Date_(s.getDate()),
 			                                s.getMTime())));
-			std::sort(Albums.beginV(), Albums.endV(), SortAlbumEntries());
+			sortAlbumEntries(Albums.beginV(), Albums.endV());
 			Albums.refresh();
 			MoveToAlbum(Albums, primary_tag, s);
 		}
 
 		Songs.clearFilter();
 		requestSongsUpdate();
-		update();
+		updateAndWait();
 
 		if (!Songs.empty())
 		{
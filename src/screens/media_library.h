@@ -23,10 +23,16 @@
 
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 
+#include "database_cache.h"
 #include "interfaces.h"
+#include "library_index.h"
+#include "mpdpp_async.h"
 #include "regex_filter.h"
 #include "screens/screen.h"
 #include "song_list.h"
+#include "song_store.h"
+
+struct DatabaseQuery;
 
 struct MediaLibrary: Screen<NC::Window *>, Filterable, HasColumns, HasSongs, Searchable, Tabbable
 {
@@ -42,7 +48,7 @@ struct MediaLibrary: Screen<NC::Window *>, Filterable, HasColumns, HasSongs, Sea
 	virtual void update() override;
 	
 	virtual int windowTimeout() override;
-
+	
 	virtual void mouseButtonPressed(MEVENT me) override;
 	
 	virtual bool isLockable() override { return true; }
@@ -64,6 +70,9 @@ struct MediaLibrary: Screen<NC::Window *>, Filterable, HasColumns, HasSongs, Sea
 	virtual bool itemAvailable() override;
 	virtual bool addItemToPlaylist(bool play) override;
 	virtual std::vector<MPD::Song> getSelectedSongs() override;
+
+	/// Same as getSelectedSongs, but leaves fetching of the songs to the server.
+	std::vector<DatabaseQuery> getSelectedQueries();
 	
 	// HasColumns implementation
 	virtual bool previousColumnAvailable() override;
@@ -82,6 +91,8 @@ struct MediaLibrary: Screen<NC::Window *>, Filterable, HasColumns, HasSongs, Sea
 	void requestTagsUpdate() { m_tags_update_request = true; }
 	void requestAlbumsUpdate() { m_albums_update_request = true; }
 	void requestSongsUpdate() { m_songs_update_request = true; }
+
+	void applyDatabaseDiff(const DatabaseCache::Diff &diff);
 	
 	struct PrimaryTag
 	{
@@ -139,15 +150,31 @@ struct MediaLibrary: Screen<NC::Window *>, Filterable, HasColumns, HasSongs, Sea
 	SongMenu Songs;
 	
 private:
+	/// Update columns, waiting for the songs requested in the process.
+	void updateAndWait();
+
 	bool m_tags_update_request;
 	bool m_albums_update_request;
 	bool m_songs_update_request;
 
+	// Columns are filled from the index of the database cache.
+	LibraryIndex m_index;
+	unsigned long m_index_generation;
+
+	// Without the database cache, albums and songs are fetched through
+	// the additional connection.
+	MPD::SongListFuture m_albums_fetch;
+	std::string m_albums_fetch_tag;
+	MPD::SongListFuture m_songs_fetch;
+	AlbumEntry m_songs_fetch_album;
+
 	boost::posix_time::ptime m_timer;
 
 	const int m_window_timeout;
 	const boost::posix_time::time_duration m_fetching_delay;
 
+	SongStore::ListenerId m_shared_songs;
+
 	Regex::Filter<PrimaryTag> m_tags_search_predicate;
 	Regex::ItemFilter<AlbumEntry> m_albums_search_predicate;
 	Regex::Filter<MPD::Song> m_songs_search_predicate;
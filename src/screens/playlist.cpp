@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <sstream>
+#include <unordered_map>
 
 #include "curses/menu_impl.h"
 #include "display.h"
@@ -49,12 +50,17 @@ namespace {
 std::string songToString(const MPD::Song &s);
 bool playlistEntryMatcher(const Regex::Regex &rx, const MPD::Song &s);
 
+// Number of songs fetched at once when the queue is loaded in pages.
+const size_t QueuePageSize = 1000;
+
 }
 
 Playlist::Playlist()
-: m_total_length(0), m_remaining_time(0), m_scroll_begin(0)
+: m_bulk_update(false)
+, m_total_length(0), m_remaining_time(0), m_scroll_begin(0)
 , m_timer(boost::posix_time::from_time_t(0))
 , m_reload_total_length(false), m_reload_remaining(false)
+, m_queue_length(0), m_page_start(0)
 {
 	w = NC::Menu<MPD::Song>(0, MainStartY, COLS, MainHeight, Config.playlist_display_mode == DisplayMode::Columns && Config.titles_visibility ? Display::Columns(COLS) : "", Config.main_color, NC::Border());
 	w.cyclicScrolling(Config.use_cyclic_scrolling);
@@ -240,6 +246,7 @@ MPD::Song Playlist::nowPlayingSong()
 
 void Playlist::locateSong(const MPD::Song &s)
 {
+	loadUpTo(s.getPosition());
 	if (!w.isFiltered())
 		w.highlight(s.getPosition());
 	else
@@ -268,17 +275,23 @@ std::string Playlist::getTotalLength()
 	
 	if (m_reload_total_length)
 	{
-		m_total_length = 0;
-		for (const auto &s : w)
-			m_total_length += s.value().getDuration();
+		if (w.isFiltered())
+		{
+			m_total_length = 0;
+			for (const auto &s : w)
+				m_total_length += s.value().getDuration();
+		}
+		else
+			m_total_length = m_durations.total();
 		m_reload_total_length = false;
 	}
 	if (Config.playlist_show_remaining_time && m_reload_remaining)
 	{
-		ScopedUnfilteredMenu<MPD::Song> sunfilter(ReapplyFilter::No, w);
-		m_remaining_time = 0;
-		for (size_t i = Status::State::currentSongPosition(); i < w.size(); ++i)
-			m_remaining_time += w[i].value().getDuration();
+		int pos = Status::State::currentSongPosition();
+		if (pos >= 0 && size_t(pos) < m_durations.size())
+			m_remaining_time = m_durations.total() - m_durations.prefix(pos);
+		else
+			m_remaining_time = 0;
 		m_reload_remaining = false;
 	}
 	
@@ -289,6 +302,9 @@ std::string Playlist::getTotalLength()
 		ScopedUnfilteredMenu<MPD::Song> sunfilter(ReapplyFilter::No, w);
 		result << " (out of " << w.size() << ")";
 	}
+
+	if (isLoading())
+		result << ", loading " << m_queue_length << " items";
 	
 	if (m_total_length)
 	{
@@ -307,31 +323,258 @@ std::string Playlist::getTotalLength()
 void Playlist::setSelectedItemsPriority(int prio)
 {
 	auto list = getSelectedOrCurrent(w.begin(), w.end(), w.current());
-	Mpd.StartCommandsList();
+	std::vector<unsigned> positions;
+	positions.reserve(list.size());
 	for (auto it = list.begin(); it != list.end(); ++it)
-		Mpd.SetPriority((*it)->value(), prio);
-	Mpd.CommitCommandsList();
+		positions.push_back((*it)->value().getPosition());
+	auto ranges = collapseToRanges(positions);
+	sendInCommandLists(ranges.size(), [&ranges, prio](size_t i) {
+		Mpd.SetPriorityRange(ranges[i].first, ranges[i].second, prio);
+	});
 	Statusbar::print("Priority set");
 }
 
+void Playlist::loadRemaining(size_t queue_length)
+{
+	m_page = MPD::SongListFuture();
+	m_queue_length = queue_length;
+	// Show something right away.
+	loadUpTo(0);
+	requestPage();
+}
+
+void Playlist::loadUpTo(size_t pos)
+{
+	ScopedUnfilteredMenu<MPD::Song> sunfilter(ReapplyFilter::Yes, w);
+	if (pos < w.size() || pos >= m_queue_length)
+		return;
+	size_t end = std::min(pos + QueuePageSize, m_queue_length);
+	for (MPD::SongIterator s = Mpd.GetPlaylistSongs(w.size(), end), last; s != last; ++s)
+		setSong(std::move(*s));
+	// The page in flight (if any) is no longer needed.
+	if (isLoading())
+		requestPage();
+}
+
+void Playlist::loadAll()
+{
+	if (isLoading())
+		loadUpTo(m_queue_length - 1);
+}
+
+void Playlist::stopLoading()
+{
+	m_page = MPD::SongListFuture();
+	m_queue_length = 0;
+	reloadTotalLength();
+}
+
 bool Playlist::checkForSong(const MPD::Song &s)
 {
-	return m_song_refs.find(s) != m_song_refs.end();
+	return m_song_refs.contains(s);
+}
+
+void Playlist::setSong(MPD::Song s)
+{
+	size_t pos = s.getPosition();
+	registerSong(s);
+	if (pos < w.size())
+	{
+		MPD::Song &old_s = w[pos].value();
+		unregisterSong(old_s);
+		m_durations.set(pos, s.getDuration());
+		old_s = std::move(s);
+	}
+	else
+	{
+		assert(pos == w.size());
+		m_durations.push_back(s.getDuration());
+		w.addItem(std::move(s));
+	}
+	reloadTotalLength();
+	reloadRemaining();
+}
+
+bool Playlist::applyPositionChanges(
+	const std::vector<std::pair<unsigned, unsigned>> &changes, size_t queue_length,
+	bool only_moved)
+{
+	auto by_position = [](const std::pair<unsigned, unsigned> &a,
+	                      const std::pair<unsigned, unsigned> &b) {
+		return a.first < b.first;
+	};
+	if (!std::is_sorted(changes.begin(), changes.end(), by_position)
+	||  (!changes.empty() && changes.back().first >= queue_length))
+		return false;
+	// Songs past the end of the list can only be appended.
+	size_t end = std::min(w.size(), queue_length);
+	for (const auto &change : changes)
+		if (change.first >= end && change.first != end++)
+			return false;
+
+	// A song that was moved comes either from one of the changed positions
+	// or from the part of the list past the end of the queue.
+	std::unordered_map<unsigned, size_t> old_positions;
+	for (const auto &change : changes)
+		if (change.first < w.size())
+			old_positions.emplace(w[change.first].value().getID(), change.first);
+	for (size_t i = queue_length; i < w.size(); ++i)
+		old_positions.emplace(w[i].value().getID(), i);
+
+	const size_t none = -1;
+	std::vector<size_t> sources(changes.size(), none);
+	std::vector<unsigned> missing;
+	std::unordered_map<unsigned, size_t> missing_idx;
+	for (size_t i = 0; i < changes.size(); ++i)
+	{
+		auto it = old_positions.find(changes[i].second);
+		// If a song is still at the same position, it was modified in place.
+		if (only_moved && it != old_positions.end() && it->second != changes[i].first)
+			sources[i] = it->second;
+		else
+		{
+			missing.push_back(changes[i].first);
+			missing_idx.emplace(changes[i].first, i);
+		}
+	}
+
+	std::vector<MPD::Song> songs(changes.size());
+	for (const auto &range : collapseToRanges(missing))
+	{
+		for (MPD::SongIterator s = Mpd.GetPlaylistSongs(range.first, range.second), end;
+		     s != end; ++s)
+		{
+			auto idx = missing_idx.find(s->getPosition());
+			if (idx == missing_idx.end() || changes[idx->second].second != s->getID())
+				return false;
+			songs[idx->second] = std::move(*s);
+		}
+	}
+	for (size_t i = 0; i < changes.size(); ++i)
+		if (sources[i] == none && songs[i].empty())
+			return false;
+
+	// Moved songs stay in the queue, so they're taken out of the list without
+	// touching the index. Only songs that are replaced or cut off are removed
+	// from it.
+	std::vector<bool> moved(w.size(), false);
+	for (size_t i = 0; i < changes.size(); ++i)
+	{
+		if (sources[i] != none)
+		{
+			songs[i] = std::move(w[sources[i]].value());
+			songs[i].setPosition(changes[i].first);
+			moved[sources[i]] = true;
+		}
+		else
+			registerSong(songs[i]);
+	}
+	for (const auto &change : changes)
+		if (change.first < w.size() && !moved[change.first])
+			unregisterSong(w[change.first].value());
+	for (size_t i = queue_length; i < w.size(); ++i)
+		if (!moved[i])
+			unregisterSong(w[i].value());
+	if (queue_length < w.size())
+	{
+		w.resizeList(queue_length);
+		m_durations.truncate(queue_length);
+	}
+
+	for (size_t i = 0; i < changes.size(); ++i)
+	{
+		size_t pos = changes[i].first;
+		if (pos < w.size())
+		{
+			m_durations.set(pos, songs[i].getDuration());
+			w[pos].value() = std::move(songs[i]);
+		}
+		else
+		{
+			assert(pos == w.size());
+			m_durations.push_back(songs[i].getDuration());
+			w.addItem(std::move(songs[i]));
+		}
+	}
+	reloadTotalLength();
+	reloadRemaining();
+	return true;
+}
+
+void Playlist::truncate(size_t queue_length)
+{
+	if (queue_length >= w.size())
+		return;
+	for (auto it = w.begin()+queue_length; it != w.end(); ++it)
+		unregisterSong(it->value());
+	w.resizeList(queue_length);
+	m_durations.truncate(queue_length);
+	reloadTotalLength();
+	reloadRemaining();
+}
+
+void Playlist::finishBulkUpdate()
+{
+	if (!m_bulk_update)
+		return;
+	m_bulk_update = false;
+	m_song_refs.assign(w.beginV(), w.endV());
 }
 
 void Playlist::registerSong(const MPD::Song &s)
 {
-	++m_song_refs[s];
+	if (!m_bulk_update)
+		m_song_refs.insert(s);
 }
 
 void Playlist::unregisterSong(const MPD::Song &s)
 {
-	auto it = m_song_refs.find(s);
-	assert(it != m_song_refs.end());
-	if (it->second == 1)
-		m_song_refs.erase(it);
-	else
-		--it->second;
+	if (!m_bulk_update)
+		m_song_refs.erase(s);
+}
+
+/***********************************************************************/
+
+void Playlist::requestPage()
+{
+	ScopedUnfilteredMenu<MPD::Song> sunfilter(ReapplyFilter::No, w);
+	m_page_start = w.size();
+	if (m_page_start >= m_queue_length)
+	{
+		stopLoading();
+		return;
+	}
+	size_t start = m_page_start;
+	size_t end = std::min(start + QueuePageSize, m_queue_length);
+	m_page = AsyncMpd.fetchSongs(
+		[start, end](MPD::Connection &mpd) {
+			return mpd.GetPlaylistSongs(start, end);
+		}, std::bind(&Playlist::pageFetched, this));
+}
+
+void Playlist::pageFetched()
+{
+	std::vector<MPD::Song> songs;
+	if (!takeFetchedSongs(m_page, songs))
+		return;
+	if (songs.empty())
+	{
+		// Fetching failed, don't retry indefinitely.
+		stopLoading();
+		return;
+	}
+	{
+		ScopedUnfilteredMenu<MPD::Song> sunfilter(ReapplyFilter::Yes, w);
+		// Skip the page if the list changed in the meantime.
+		if (m_page_start == w.size())
+		{
+			for (auto &s : songs)
+				setSong(std::move(s));
+		}
+	}
+	requestPage();
+	if (isVisible(this))
+		w.refresh();
 }
 
 namespace {
@@ -22,13 +22,15 @@
 #define NCMPCPP_PLAYLIST_H
 
 #include <boost/date_time/posix_time/posix_time_types.hpp>
-#include <unordered_map>
 
 #include "interfaces.h"
+#include "mpdpp_async.h"
 #include "regex_filter.h"
 #include "screens/screen.h"
 #include "song.h"
 #include "song_list.h"
+#include "utility/fenwick_tree.h"
+#include "utility/hash_counter.h"
 
 struct Playlist: Screen<SongMenu>, Filterable, HasSongs, Searchable, Tabbable
 {
@@ -76,18 +78,68 @@ struct Playlist: Screen<SongMenu>, Filterable, HasSongs, Searchable, Tabbable
 	void setSelectedItemsPriority(int prio);
 
 	bool checkForSong(const MPD::Song &s);
-	void registerSong(const MPD::Song &s);
-	void unregisterSong(const MPD::Song &s);
+
+	/// Statistics of lookups made with checkForSong.
+	size_t songLookupHits() const { return m_song_refs.hits(); }
+	size_t songLookupMisses() const { return m_song_refs.misses(); }
+
+	/// Put a song at its position in the queue, replacing the one that was
+	/// there or appending it. The list needs to be unfiltered.
+	void setSong(MPD::Song s);
+
+	/// Update the list using positions and ids of changed songs (as given by
+	/// plchangesposid) and truncate it to a given length of the queue. Songs
+	/// that are already in the list are only moved, the rest is fetched.
+	/// If moved songs might have been modified too (e.g. their priority was
+	/// changed), as indicated by only_moved, they're fetched as well.
+	/// The list needs to be unfiltered.
+	/// @return false if the queue changed again in the meantime and nothing
+	/// was done.
+	bool applyPositionChanges(const std::vector<std::pair<unsigned, unsigned>> &changes,
+	                          size_t queue_length, bool only_moved);
+
+	/// Remove songs past a given length of the queue.
+	/// The list needs to be unfiltered.
+	void truncate(size_t queue_length);
+
+	/// Defer tracking of songs in the list while many of them are replaced
+	/// at once, the index is then rebuilt in one go by finishBulkUpdate.
+	void startBulkUpdate() { m_bulk_update = true; }
+	void finishBulkUpdate();
 	
 	void reloadTotalLength() { m_reload_total_length = true; }
 	void reloadRemaining() { m_reload_remaining = true; }
+
+	/// Load songs of the queue that are not in the list yet in pages,
+	/// the first one right away and the rest in the background.
+	void loadRemaining(size_t queue_length);
+
+	/// Make sure that the song at a given position is loaded.
+	void loadUpTo(size_t pos);
+
+	/// Load the rest of the queue right away, e.g. before acting on the
+	/// whole list. Does nothing if the queue is already fully loaded.
+	void loadAll();
+
+	void stopLoading();
+	bool isLoading() const { return m_page.valid(); }
 	
 private:
 	std::string getTotalLength();
 
+	void registerSong(const MPD::Song &s);
+	void unregisterSong(const MPD::Song &s);
+
+	void requestPage();
+	void pageFetched();
+
 	std::string m_stats;
 	
-	std::unordered_map<MPD::Song, int, MPD::Song::Hash> m_song_refs;
+	HashCounter<MPD::Song, MPD::Song::Hash> m_song_refs;
+	bool m_bulk_update;
+
+	// Durations of songs in the list, in queue order.
+	FenwickTree<size_t> m_durations;
 	
 	size_t m_total_length;;
 	size_t m_remaining_time;
@@ -98,6 +150,10 @@ private:
 	bool m_reload_total_length;
 	bool m_reload_remaining;
 
+	size_t m_queue_length;
+	size_t m_page_start;
+	MPD::SongListFuture m_page;
+
 	Regex::Filter<MPD::Song> m_search_predicate;
 };
 
@@ -19,9 +19,9 @@
  ***************************************************************************/
 
 #include <algorithm>
-#include <boost/optional.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <cassert>
+#include <map>
 
 #include "curses/menu_impl.h"
 #include "charset.h"
@@ -31,6 +31,7 @@
 #include "screens/playlist.h"
 #include "screens/playlist_editor.h"
 #include "mpdpp.h"
+#include "playlist_index.h"
 #include "status.h"
 #include "statusbar.h"
 #include "screens/tag_editor.h"
@@ -50,6 +51,9 @@ PlaylistEditor *myPlaylistEditor;
 
 namespace {
 
+// Maximum number of songs in cached playlist contents.
+const size_t content_cache_size = 20000;
+
 size_t LeftColumnStartX;
 size_t LeftColumnWidth;
 size_t RightColumnStartX;
@@ -58,11 +62,13 @@ size_t RightColumnWidth;
 std::string SongToString(const MPD::Song &s);
 bool PlaylistEntryMatcher(const Regex::Regex &rx, const MPD::Playlist &playlist);
 bool SongEntryMatcher(const Regex::Regex &rx, const MPD::Song &s);
-boost::optional<size_t> GetSongIndexInPlaylist(MPD::Playlist playlist, const MPD::Song &song);
 }
 
 PlaylistEditor::PlaylistEditor()
-: m_timer(boost::posix_time::from_time_t(0))
+: m_content_loaded(false)
+, m_highlight_pos(0)
+, m_content_cache(content_cache_size)
+, m_timer(boost::posix_time::from_time_t(0))
 , m_window_timeout(Config.data_fetching_delay ? 250 : BaseScreen::defaultWindowTimeout)
 , m_fetching_delay(boost::posix_time::milliseconds(Config.data_fetching_delay ? 250 : -1))
 {
@@ -99,6 +105,13 @@ PlaylistEditor::PlaylistEditor()
 			));
 			break;
 	}
+
+	m_shared_songs = SharedSongs.addListener([this](const SongStore::SongSet &updated) {
+		replaceUpdatedSongs(Content, updated);
+		// Cached contents are keyed by playlists' modification times,
+		// which don't change when their songs do.
+		m_content_cache.clear();
+	});
 	
 	w = &Playlists;
 }
@@ -169,48 +182,87 @@ void PlaylistEditor::update()
 			}
 			if (idx < Playlists.size())
 				Playlists.resizeList(idx);
-			std::sort(Playlists.beginV(), Playlists.endV(),
-			          LocaleBasedSorting(std::locale(), Config.ignore_leading_the));
+			sortByKey(Playlists.beginV(), Playlists.endV(),
+			          LocaleBasedSortKeys(std::locale(), Config.ignore_leading_the));
 		}
 	}
 
 	{
 		ScopedUnfilteredMenu<MPD::Song> sunfilter_content(ReapplyFilter::No, Content);
-		if (!Playlists.empty()
-		    && ((Content.empty() && Global::Timer - m_timer > m_fetching_delay)
-		        || m_content_update_requested))
+		if (!Playlists.empty())
 		{
-			m_content_update_requested = false;
-			sunfilter_content.set(ReapplyFilter::Yes, true);
-			size_t idx = 0;
-			MPD::SongIterator s = Mpd.GetPlaylistContent(Playlists.current()->value().path()), end;
-			for (; s != end; ++s, ++idx)
+			const auto key = playlistKey(Playlists.current()->value());
+			// Look into the cache only once per highlighted playlist.
+			if (key != m_content_key)
 			{
-				if (idx < Content.size())
-					Content[idx].value() = std::move(*s);
-				else
-					Content.addItem(std::move(*s));
+				m_content_key = key;
+				m_content_loaded = false;
+				const std::vector<MPD::Song> *cached = nullptr;
+				if (!m_content_update_requested)
+					cached = m_content_cache.get(key);
+				if (cached != nullptr)
+				{
+					sunfilter_content.set(ReapplyFilter::Yes, true);
+					setContent(*cached);
+					m_content_loaded = true;
+				}
+			}
+			bool fetching = m_content_fetch.valid() && m_content_fetch_key == key;
+			if ((!m_content_loaded && !fetching && Global::Timer - m_timer > m_fetching_delay)
+			    || m_content_update_requested)
+			{
+				m_content_update_requested = false;
+				m_content_fetch_key = key;
+				m_content_fetch = AsyncMpd.fetchSongs(
+					[path = key.first](MPD::Connection &mpd) {
+						return mpd.GetPlaylistContent(path);
+					}, redrawWhenVisible(this));
+			}
+		}
+		std::vector<MPD::Song> songs;
+		if (takeFetchedSongs(m_content_fetch, songs))
+		{
+			SharedSongs.shareAll(songs.begin(), songs.end(), m_shared_songs);
+			m_content_cache.put(m_content_fetch_key, songs, songs.size() + 1);
+			// Discard content of a playlist that is no longer selected.
+			if (!Playlists.empty() && m_content_key == m_content_fetch_key)
+			{
+				sunfilter_content.set(ReapplyFilter::Yes, true);
+				setContent(std::move(songs));
+				m_content_loaded = true;
 			}
-			if (idx < Content.size())
-				Content.resizeList(idx);
-			std::string wtitle;
-			if (Config.titles_visibility)
+		}
+		songs.clear();
+		if (takeFetchedSongs(m_prefetch, songs))
+		{
+			SharedSongs.shareAll(songs.begin(), songs.end(), m_shared_songs);
+			size_t cost = songs.size() + 1;
+			m_content_cache.put(m_prefetch_key, std::move(songs), cost);
+		}
+		prefetchNeighbours();
+	}
+
+	// Highlight the song located by locateSong, unless a different
+	// playlist was highlighted in the meantime.
+	if (m_highlight_key != PlaylistKey())
+	{
+		if (m_content_key != m_highlight_key)
+			m_highlight_key = PlaylistKey();
+		else if (m_content_loaded)
+		{
+			m_highlight_key = PlaylistKey();
+			if (m_highlight_pos < Content.size())
 			{
-				wtitle = (boost::format("Content (%1% %2%)")
-				          % boost::lexical_cast<std::string>(Content.size())
-				          % (Content.size() == 1 ? "item" : "items")).str();
-				wtitle.resize(Content.getWidth());
+				Content.highlight(m_highlight_pos);
+				nextColumn();
 			}
-			Content.setTitle(wtitle);
-			Content.refreshBorder();
 		}
 	}
 }
 
 int PlaylistEditor::windowTimeout()
 {
-	ScopedUnfilteredMenu<MPD::Song> sunfilter_content(ReapplyFilter::No, Content);
-	if (Content.empty())
+	if (!m_content_loaded)
 		return m_window_timeout;
 	else
 		return Screen<WindowType>::windowTimeout();
@@ -235,7 +287,7 @@ void PlaylistEditor::mouseButtonPressed(MEVENT me)
 		}
 		else
 			Screen<WindowType>::mouseButtonPressed(me);
-		Content.clear();
+		clearContent();
 	}
 	else if (Content.hasCoords(me.x, me.y))
 	{
@@ -462,6 +514,60 @@ void PlaylistEditor::nextColumn()
 
 /***********************************************************************/
 
+void PlaylistEditor::setContent(std::vector<MPD::Song> songs)
+{
+	size_t idx = 0;
+	for (auto &s : songs)
+	{
+		if (idx < Content.size())
+			Content[idx].value() = std::move(s);
+		else
+			Content.addItem(std::move(s));
+		++idx;
+	}
+	if (idx < Content.size())
+		Content.resizeList(idx);
+	std::string wtitle;
+	if (Config.titles_visibility)
+	{
+		wtitle = (boost::format("Content (%1% %2%)")
+		          % boost::lexical_cast<std::string>(Content.size())
+		          % (Content.size() == 1 ? "item" : "items")).str();
+		wtitle.resize(Content.getWidth());
+	}
+	Content.setTitle(wtitle);
+	Content.refreshBorder();
+}
+
+void PlaylistEditor::prefetchNeighbours()
+{
+	// Fetch one playlist at a time and only when nothing else is fetched.
+	if (Playlists.empty() || m_content_fetch.valid() || m_prefetch.valid())
+		return;
+	size_t current = Playlists.choice();
+	for (size_t i : { current + 1, current - 1 })
+	{
+		if (i >= Playlists.size())
+			continue;
+		auto key = playlistKey(Playlists[i].value());
+		if (m_content_cache.contains(key))
+			continue;
+		m_prefetch_key = key;
+		m_prefetch = AsyncMpd.fetchSongs(
+			[path = key.first](MPD::Connection &mpd) {
+				return mpd.GetPlaylistContent(path);
+			}, redrawWhenVisible(this));
+		break;
+	}
+}
+
+void PlaylistEditor::clearContent()
+{
+	Content.clear();
+	m_content_key = PlaylistKey();
+	m_content_loaded = false;
+}
+
 void PlaylistEditor::updateTimer()
 {
 	m_timer = Global::Timer;
@@ -476,7 +582,7 @@ void PlaylistEditor::locatePlaylist(const MPD::Playlist &playlist)
 	if (it != last)
 	{
 		Playlists.highlight(it - first);
-		Content.clear();
+		clearContent();
 		Content.clearFilter();
 		switchTo();
 	}
@@ -503,18 +609,22 @@ void PlaylistEditor::locateSong(const MPD::Song &s)
 		}
 		return false;
 	};
-	auto locate_song_in_playlists = [this, &s](auto front, auto back) {
+	// Index of the song in each playlist that contains it.
+	std::map<std::string, size_t> song_indices;
+	auto locate_song_in_playlists = [this, &song_indices](auto front, auto back) {
 		for (auto it = front; it != back; ++it)
 		{
-			if (auto song_index = GetSongIndexInPlaylist(*it, s))
+			auto song_index = song_indices.find(it->path());
+			if (song_index != song_indices.end())
 			{
 				Playlists.highlight(it - Playlists.beginV());
 				Playlists.refresh();
 
+				// Song is highlighted by update once the content is there.
+				m_highlight_key = playlistKey(*it);
+				m_highlight_pos = song_index->second;
 				requestContentUpdate();
 				update();
-				Content.highlight(*song_index);
-				nextColumn();
 
 				return true;
 			}
@@ -522,10 +632,12 @@ void PlaylistEditor::locateSong(const MPD::Song &s)
 		return false;
 	};
 
-
 	if (locate_song_in_current_playlist(Content.currentV() + 1, Content.endV()))
 		return;
 	Statusbar::print("Jumping to song...");
+	StoredPlaylists.update();
+	for (const auto &match : StoredPlaylists.find(s))
+		song_indices.emplace(match.playlist, match.positions.front());
 	if (locate_song_in_playlists(Playlists.currentV() + 1, Playlists.endV()))
 		return;
 	if (locate_song_in_playlists(Playlists.beginV(), Playlists.currentV()))
@@ -566,20 +678,4 @@ bool SongEntryMatcher(const Regex::Regex &rx, const MPD::Song &s)
 	return Regex::search(SongToString(s), rx, Config.ignore_diacritics);
 }
 
-boost::optional<size_t> GetSongIndexInPlaylist(MPD::Playlist playlist, const MPD::Song &song)
-{
-	size_t index = 0;
-	MPD::SongIterator it = Mpd.GetPlaylistContentNoInfo(playlist.path()), end;
-
-	for (;;)
-	{
-		if (it == end)
-			return boost::none;
-		if (*it == song)
-			return index;
-
-		++it, ++index;
-	}
-}
-
 }
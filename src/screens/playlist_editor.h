@@ -22,11 +22,15 @@
 #define NCMPCPP_PLAYLIST_EDITOR_H
 
 #include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/functional/hash.hpp>
 
 #include "interfaces.h"
+#include "mpdpp_async.h"
 #include "regex_filter.h"
 #include "screens/screen.h"
 #include "song_list.h"
+#include "song_store.h"
+#include "utility/lru_cache.h"
 
 struct PlaylistEditor: Screen<NC::Window *>, Filterable, HasColumns, HasSongs, Searchable, Tabbable
 {
@@ -77,6 +81,10 @@ struct PlaylistEditor: Screen<NC::Window *>, Filterable, HasColumns, HasSongs, S
 
 	void requestPlaylistsUpdate() { m_playlists_update_requested = true; }
 	void requestContentUpdate() { m_content_update_requested = true; }
+
+	/// Clear the content so that it's loaded again, e.g. after
+	/// a different playlist was highlighted.
+	void clearContent();
 	
 	void locatePlaylist(const MPD::Playlist &playlist);
 	void locateSong(const MPD::Song &s);
@@ -84,10 +92,43 @@ struct PlaylistEditor: Screen<NC::Window *>, Filterable, HasColumns, HasSongs, S
 	NC::Menu<MPD::Playlist> Playlists;
 	SongMenu Content;
 	
+	/// Statistics of the cache of playlist contents.
+	size_t contentCacheHits() const { return m_content_cache.hits(); }
+	size_t contentCacheMisses() const { return m_content_cache.misses(); }
+	
 private:
+	// Playlists are identified by their paths and modification times.
+	typedef std::pair<std::string, time_t> PlaylistKey;
+
+	static PlaylistKey playlistKey(const MPD::Playlist &playlist) {
+		return PlaylistKey(playlist.path(), playlist.lastModified());
+	}
+
+	void setContent(std::vector<MPD::Song> songs);
+	void prefetchNeighbours();
+
 	bool m_playlists_update_requested;
 	bool m_content_update_requested;
 
+	// Playlist whose content is displayed or about to be.
+	PlaylistKey m_content_key;
+	bool m_content_loaded;
+
+	// Song to highlight when content of a given playlist is loaded.
+	PlaylistKey m_highlight_key;
+	size_t m_highlight_pos;
+
+	// Content is fetched through the additional connection.
+	MPD::SongListFuture m_content_fetch;
+	PlaylistKey m_content_fetch_key;
+
+	// Contents of recently viewed playlists and their neighbours.
+	LruCache<PlaylistKey, std::vector<MPD::Song>, boost::hash<PlaylistKey>> m_content_cache;
+	MPD::SongListFuture m_prefetch;
+	PlaylistKey m_prefetch_key;
+
+	SongStore::ListenerId m_shared_songs;
+
 	boost::posix_time::ptime m_timer;
 
 	const int m_window_timeout;
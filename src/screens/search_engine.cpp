@@ -18,11 +18,14 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
+#include <algorithm>
 #include <array>
-#include <boost/range/detail/any_iterator.hpp>
+#include <atomic>
+#include <boost/thread/thread.hpp>
 #include <iomanip>
 
 #include "curses/menu_impl.h"
+#include "database_cache.h"
 #include "display.h"
 #include "global.h"
 #include "helpers.h"
@@ -34,6 +37,8 @@
 #include "format_impl.h"
 #include "helpers/song_iterator_maker.h"
 #include "utility/comparators.h"
+#include "utility/scoped_value.h"
+#include "utility/shared_resource.h"
 #include "title.h"
 #include "screens/screen_switcher.h"
 
@@ -78,8 +83,151 @@ bool SEItemEntryMatcher(const Regex::Regex &rx,
                         const NC::Menu<SEItem>::Item &item,
                         bool filter);
 
+// Number of songs processed at once by a search worker.
+const size_t SearchChunkSize = 1024;
+
+// Tags corresponding to search constraints other than "Any" (which is matched
+// against all of them). MPD_TAG_NAME stands for the file name.
+const std::array<mpd_tag_type, 10> ConstraintTags = {{
+	MPD_TAG_ARTIST,
+	MPD_TAG_ALBUM_ARTIST,
+	MPD_TAG_TITLE,
+	MPD_TAG_ALBUM,
+	MPD_TAG_NAME,
+	MPD_TAG_COMPOSER,
+	MPD_TAG_PERFORMER,
+	MPD_TAG_GENRE,
+	MPD_TAG_DATE,
+	MPD_TAG_COMMENT
+}};
+
+// Checks whether a song satisfies search constraints. Doesn't modify any
+// state, so it can be used from multiple threads at once.
+class SongMatcher
+{
+	std::vector<std::string> m_constraints;
+	std::vector<Regex::Regex> m_rx;
+	bool m_exact_match;
+	LocaleStringComparison m_cmp;
+
+	bool isActive(size_t i) const
+	{
+		if (m_exact_match)
+			return !m_constraints[i].empty();
+		else
+			return !m_rx[i].empty();
+	}
+
+	bool matches(size_t i, const char *value) const
+	{
+		if (m_exact_match)
+			return m_cmp(value, m_constraints[i].c_str()) == 0;
+		else
+			return Regex::search(value, m_rx[i], Config.ignore_diacritics);
+	}
+
+public:
+	SongMatcher(const std::string *constraints, size_t size, bool exact_match)
+	: m_constraints(constraints, constraints+size), m_rx(size)
+	, m_exact_match(exact_match), m_cmp(std::locale(), Config.ignore_leading_the)
+	{
+		assert(size == ConstraintTags.size()+1);
+		if (!m_exact_match)
+		{
+			for (size_t i = 0; i < size; ++i)
+			{
+				if (!m_constraints[i].empty())
+				{
+					try
+					{
+						m_rx[i] = Regex::make(m_constraints[i], Config.regex_type);
+					}
+					catch (boost::bad_expression &) { }
+				}
+			}
+		}
+	}
+
+	bool operator()(const MPD::Song &s) const
+	{
+		// Tags are accessed without copying them, only the file name needs
+		// to be constructed.
+		std::string name;
+		auto value = [&s, &name](mpd_tag_type tag) {
+			if (tag == MPD_TAG_NAME)
+			{
+				name = s.getName();
+				return name.c_str();
+			}
+			const char *result = s.c_tag(tag);
+			return result != nullptr ? result : "";
+		};
+		if (isActive(0)
+		&&  std::none_of(ConstraintTags.begin(), ConstraintTags.end(),
+		                 [&](mpd_tag_type tag) { return matches(0, value(tag)); }))
+			return false;
+		for (size_t i = 1; i < m_constraints.size(); ++i)
+			if (isActive(i) && !matches(i, value(ConstraintTags[i-1])))
+				return false;
+		return true;
+	}
+};
+
 }
 
+// Search on a local list of songs, split into chunks processed in parallel.
+struct SearchEngine::LocalSearch
+{
+	struct Results
+	{
+		Results(size_t chunks_number)
+		: chunks(chunks_number), done(chunks_number, false), chunks_done(0)
+		{ }
+
+		std::vector<std::vector<MPD::Song>> chunks;
+		std::vector<bool> done;
+		size_t chunks_done;
+	};
+
+	LocalSearch(std::vector<MPD::Song> songs_, SongMatcher matcher_)
+	: songs(std::move(songs_)), matcher(std::move(matcher_))
+	, chunks_number((songs.size() + SearchChunkSize - 1) / SearchChunkSize)
+	, next_chunk(0), stop(false), results(Results(chunks_number)), collected(0)
+	{ }
+
+	// Body of a worker thread.
+	void run()
+	{
+		size_t chunk;
+		while (!stop && (chunk = next_chunk++) < chunks_number)
+		{
+			std::vector<MPD::Song> found;
+			auto first = songs.begin() + chunk*SearchChunkSize;
+			auto last = songs.begin() + std::min(songs.size(), (chunk+1)*SearchChunkSize);
+			for (; first != last && !stop; ++first)
+				if (matcher(*first))
+					found.push_back(*first);
+			if (first != last)
+				break;
+			auto r = results.acquire();
+			r->chunks[chunk] = std::move(found);
+			r->done[chunk] = true;
+			++r->chunks_done;
+		}
+	}
+
+	const std::vector<MPD::Song> songs;
+	const SongMatcher matcher;
+	const size_t chunks_number;
+
+	std::atomic<size_t> next_chunk;
+	std::atomic<bool> stop;
+	Shared<Results> results;
+
+	// Number of chunks already moved to the menu, accessed only by the main thread.
+	size_t collected;
+};
+
 template <>
 struct SongPropertiesExtractor<SEItem>
 {
@@ -174,6 +322,7 @@ size_t SearchEngine::SearchButton = 15;
 
 SearchEngine::SearchEngine()
 : Screen(NC::Menu<SEItem>(0, MainStartY, COLS, MainHeight, "", Config.main_color, NC::Border()))
+, m_editing_constraint(false)
 {
 	setHighlightFixes(w);
 	w.cyclicScrolling(Config.use_cyclic_scrolling);
@@ -182,6 +331,17 @@ SearchEngine::SearchEngine()
 	w.setSelectedPrefix(Config.selected_item_prefix);
 	w.setSelectedSuffix(Config.selected_item_suffix);
 	SearchMode = &SearchModes[Config.search_engine_default_search_mode];
+	m_shared_songs = SharedSongs.addListener([this](const SongStore::SongSet &updated) {
+		ScopedUnfilteredMenu<SEItem> sunfilter(ReapplyFilter::Yes, w);
+		for (auto &item : w)
+		{
+			if (!item.value().isSong())
+				continue;
+			auto it = updated.find(item.value().song());
+			if (it != updated.end())
+				item.value().song() = *it;
+		}
+	});
 }
 
 void SearchEngine::resize()
@@ -216,6 +376,36 @@ std::wstring SearchEngine::title()
 	return L"Search engine";
 }
 
+void SearchEngine::update()
+{
+	std::vector<MPD::Song> songs;
+	if (takeFetchedSongs(m_server_search, songs))
+	{
+		{
+			ScopedUnfilteredMenu<SEItem> sunfilter(ReapplyFilter::Yes, w);
+			for (auto &s : songs)
+				w.addItem(SharedSongs.share(s, m_shared_songs));
+		}
+		finishSearch(false);
+		w.refresh();
+	}
+	if (m_local_search)
+	{
+		// Live search is finished when the constraint is accepted.
+		if (collectLocalSearchResults() && !m_editing_constraint)
+			finishSearch(false);
+		w.refresh();
+	}
+}
+
+int SearchEngine::windowTimeout()
+{
+	if (searching())
+		return 100;
+	else
+		return Screen<WindowType>::windowTimeout();
+}
+
 void SearchEngine::mouseButtonPressed(MEVENT me)
 {
 	if (w.empty() || !w.hasCoords(me.x, me.y) || size_t(me.y) >= w.size())
@@ -315,11 +505,45 @@ void SearchEngine::runAction()
 		Statusbar::ScopedLock slock;
 		std::string constraint = ConstraintsNames[option];
 		Statusbar::put() << NC::Format::Bold << constraint << NC::Format::NoBold << ": ";
-		itsConstraints[option] = Global::wFooter->prompt(itsConstraints[option]);
-		w.current()->value().buffer().clear();
+		if (Config.search_engine_live_search)
+		{
+			std::string previous = itsConstraints[option];
+			try
+			{
+				ScopedValue<bool> editing(m_editing_constraint, true);
+				NC::Window::ScopedPromptHook helper(
+					*Global::wFooter,
+					[this, option](const char *s) {
+						if (itsConstraints[option] != s)
+						{
+							itsConstraints[option] = s;
+							liveSearch();
+						}
+						// Update window timeout as it depends on
+						// whether search is running.
+						Status::trace(true, true);
+						return true;
+					});
+				itsConstraints[option] = Global::wFooter->prompt(itsConstraints[option]);
+			}
+			catch (NC::PromptAborted &)
+			{
+				itsConstraints[option] = previous;
+				liveSearch();
+				if (!searching())
+					finishSearch(false);
+				throw;
+			}
+		}
+		else
+			itsConstraints[option] = Global::wFooter->prompt(itsConstraints[option]);
+		// Items might have been modified by live search, so don't use current().
+		w.at(option).value().buffer().clear();
 		constraint.resize(13, ' ');
-		w.current()->value().buffer() << NC::Format::Bold << constraint << NC::Format::NoBold << ": ";
-		ShowTag(w.current()->value().buffer(), itsConstraints[option]);
+		w.at(option).value().buffer() << NC::Format::Bold << constraint << NC::Format::NoBold << ": ";
+		ShowTag(w.at(option).value().buffer(), itsConstraints[option]);
+		if (Config.search_engine_live_search && !searching())
+			finishSearch(false);
 	}
 	else if (option == ConstraintsNumber+1)
 	{
@@ -334,38 +558,21 @@ void SearchEngine::runAction()
 	}
 	else if (option == SearchButton)
 	{
-		w.clearFilter();
-		Statusbar::print("Searching...");
-		if (w.size() > StaticOptions)
-			Prepare();
-		Search();
-		if (w.rbegin()->value().isSong())
+		if (searching())
 		{
-			if (Config.search_engine_display_mode == DisplayMode::Columns)
-				w.setTitle(Config.titles_visibility ? Display::Columns(w.getWidth()) : "");
-			size_t found = w.size()-SearchEngine::StaticOptions;
-			found += 3; // don't count options inserted below
-			w.insertSeparator(ResetButton+1);
-			w.insertItem(ResetButton+2, SEItem(), NC::List::Properties::Inactive);
-			w.at(ResetButton+2).value().mkBuffer()
-				<< NC::Format::Bold
-				<< Config.color1
-				<< "Search results: "
-				<< NC::FormattedColor::End<>(Config.color1)
-				<< Config.color2
-				<< "Found " << found << (found > 1 ? " songs" : " song")
-				<< NC::FormattedColor::End<>(Config.color2)
-				<< NC::Format::NoBold;
-			w.insertSeparator(ResetButton+3);
-				Statusbar::print("Searching finished");
-			if (Config.block_search_constraints_change)
-				for (size_t i = 0; i < StaticOptions-4; ++i)
-					w.at(i).setInactive(true);
-			w.scroll(NC::Scroll::Down);
-			w.scroll(NC::Scroll::Down);
+			stopSearch();
+			finishSearch(true);
 		}
 		else
-			Statusbar::print("No results found");
+		{
+			w.clearFilter();
+			Statusbar::print("Searching...");
+			if (w.size() > StaticOptions)
+				Prepare();
+			Search();
+			if (!searching())
+				finishSearch(false);
+		}
 	}
 	else if (option == ResetButton)
 	{
@@ -423,6 +630,7 @@ void SearchEngine::Prepare()
 
 void SearchEngine::reset()
 {
+	stopSearch();
 	for (size_t i = 0; i < ConstraintsNumber; ++i)
 		itsConstraints[i].clear();
 	w.clearFilter();
@@ -447,148 +655,190 @@ void SearchEngine::Search()
 	
 	if (Config.search_in_db && (SearchMode == &SearchModes[0] || SearchMode == &SearchModes[2])) // use built-in mpd searching
 	{
-		Mpd.StartSearch(SearchMode == &SearchModes[2]);
-		if (!itsConstraints[0].empty())
-			Mpd.AddSearchAny(itsConstraints[0]);
-		if (!itsConstraints[1].empty())
-			Mpd.AddSearch(MPD_TAG_ARTIST, itsConstraints[1]);
-		if (!itsConstraints[2].empty())
-			Mpd.AddSearch(MPD_TAG_ALBUM_ARTIST, itsConstraints[2]);
-		if (!itsConstraints[3].empty())
-			Mpd.AddSearch(MPD_TAG_TITLE, itsConstraints[3]);
-		if (!itsConstraints[4].empty())
-			Mpd.AddSearch(MPD_TAG_ALBUM, itsConstraints[4]);
-		if (!itsConstraints[5].empty())
-			Mpd.AddSearchURI(itsConstraints[5]);
-		if (!itsConstraints[6].empty())
-			Mpd.AddSearch(MPD_TAG_COMPOSER, itsConstraints[6]);
-		if (!itsConstraints[7].empty())
-			Mpd.AddSearch(MPD_TAG_PERFORMER, itsConstraints[7]);
-		if (!itsConstraints[8].empty())
-			Mpd.AddSearch(MPD_TAG_GENRE, itsConstraints[8]);
-		if (!itsConstraints[9].empty())
-			Mpd.AddSearch(MPD_TAG_DATE, itsConstraints[9]);
-		if (!itsConstraints[10].empty())
-			Mpd.AddSearch(MPD_TAG_COMMENT, itsConstraints[10]);
-		for (MPD::SongIterator s = Mpd.CommitSearchSongs(), end; s != end; ++s)
-			w.addItem(std::move(*s));
+		m_server_search = AsyncMpd.fetchSongs(
+			[constraints = std::vector<std::string>(itsConstraints, itsConstraints+ConstraintsNumber),
+			 exact = SearchMode == &SearchModes[2]](MPD::Connection &mpd) {
+				mpd.StartSearch(exact);
+				if (!constraints[0].empty())
+					mpd.AddSearchAny(constraints[0]);
+				if (!constraints[1].empty())
+					mpd.AddSearch(MPD_TAG_ARTIST, constraints[1]);
+				if (!constraints[2].empty())
+					mpd.AddSearch(MPD_TAG_ALBUM_ARTIST, constraints[2]);
+				if (!constraints[3].empty())
+					mpd.AddSearch(MPD_TAG_TITLE, constraints[3]);
+				if (!constraints[4].empty())
+					mpd.AddSearch(MPD_TAG_ALBUM, constraints[4]);
+				if (!constraints[5].empty())
+					mpd.AddSearchURI(constraints[5]);
+				if (!constraints[6].empty())
+					mpd.AddSearch(MPD_TAG_COMPOSER, constraints[6]);
+				if (!constraints[7].empty())
+					mpd.AddSearch(MPD_TAG_PERFORMER, constraints[7]);
+				if (!constraints[8].empty())
+					mpd.AddSearch(MPD_TAG_GENRE, constraints[8]);
+				if (!constraints[9].empty())
+					mpd.AddSearch(MPD_TAG_DATE, constraints[9]);
+				if (!constraints[10].empty())
+					mpd.AddSearch(MPD_TAG_COMMENT, constraints[10]);
+				return mpd.CommitSearchSongs();
+			}, redrawWhenVisible(this));
+		w.at(SearchButton).value().mkBuffer() << "Stop searching";
 		return;
 	}
 
-	Regex::Regex rx[ConstraintsNumber];
-	if (SearchMode != &SearchModes[2]) // match to pattern
+	std::vector<MPD::Song> songs;
+	if (Config.search_in_db)
+		songs = Database.songs(Mpd);
+	else
+		songs.assign(myPlaylist->main().beginV(), myPlaylist->main().endV());
+	startLocalSearch(std::move(songs));
+}
+
+void SearchEngine::liveSearch()
+{
+	stopSearch();
+	if (w.size() > StaticOptions-3)
+		Prepare();
+	if (std::all_of(itsConstraints, itsConstraints+ConstraintsNumber,
+	                [](const std::string &c) { return c.empty(); }))
+		return;
+
+	std::vector<MPD::Song> songs;
+	if (Config.search_in_db)
 	{
-		for (size_t i = 0; i < ConstraintsNumber; ++i)
+		const auto &all = Database.songs(Mpd);
+		// Narrow down the list of songs with the trigram index if it's already
+		// built. Diacritics stripping and exact matching don't preserve trigrams.
+		boost::optional<std::vector<uint32_t>> candidates;
+		const TrigramIndex *index = Database.index();
+		if (index != nullptr && SearchMode != &SearchModes[2] && !Config.ignore_diacritics)
 		{
-			if (!itsConstraints[i].empty())
+			std::vector<std::string> literals;
+			for (size_t i = 0; i < ConstraintsNumber; ++i)
 			{
-				try
-				{
-					rx[i] = Regex::make(itsConstraints[i], Config.regex_type);
-				}
-				catch (boost::bad_expression &) { }
+				auto required = TrigramIndex::requiredLiterals(itsConstraints[i]);
+				std::move(required.begin(), required.end(), std::back_inserter(literals));
 			}
+			candidates = index->candidates(literals);
 		}
-	}
-
-	typedef boost::range_detail::any_iterator<
-		const MPD::Song,
-		boost::single_pass_traversal_tag,
-		const MPD::Song &,
-		std::ptrdiff_t
-	> input_song_iterator;
-	input_song_iterator s, end;
-	if (Config.search_in_db)
-	{
-		s = input_song_iterator(getDatabaseIterator(Mpd));
-		end = input_song_iterator(MPD::SongIterator());
+		if (candidates)
+		{
+			songs.reserve(candidates->size());
+			for (auto i : *candidates)
+				songs.push_back(all[i]);
+		}
+		else
+			songs = all;
 	}
 	else
+		songs.assign(myPlaylist->main().beginV(), myPlaylist->main().endV());
+	startLocalSearch(std::move(songs));
+}
+
+void SearchEngine::startLocalSearch(std::vector<MPD::Song> songs)
+{
+	m_local_search = std::make_shared<LocalSearch>(
+		std::move(songs),
+		SongMatcher(itsConstraints, ConstraintsNumber, SearchMode == &SearchModes[2]));
+
+	// Don't bother with threads if there is not much to search through.
+	if (m_local_search->chunks_number <= 1)
 	{
-		s = input_song_iterator(myPlaylist->main().beginV());
-		end = input_song_iterator(myPlaylist->main().endV());
+		m_local_search->run();
+		collectLocalSearchResults();
+		m_local_search.reset();
+		return;
 	}
 
-	LocaleStringComparison cmp(std::locale(), Config.ignore_leading_the);
-	for (; s != end; ++s)
-	{
-		bool any_found = true, found = true;
+	size_t workers = std::min<size_t>(
+		std::max(boost::thread::hardware_concurrency(), 1u),
+		m_local_search->chunks_number);
+	for (size_t i = 0; i < workers; ++i)
+		m_search_workers.push_back(boost::async(
+			boost::launch::async,
+			std::bind(&LocalSearch::run, m_local_search)));
 
-		if (SearchMode != &SearchModes[2]) // match to pattern
-		{
-			if (!rx[0].empty())
-				any_found =
-					   Regex::search(s->getArtist(), rx[0], Config.ignore_diacritics)
-					|| Regex::search(s->getAlbumArtist(), rx[0], Config.ignore_diacritics)
-					|| Regex::search(s->getTitle(), rx[0], Config.ignore_diacritics)
-					|| Regex::search(s->getAlbum(), rx[0], Config.ignore_diacritics)
-					|| Regex::search(s->getName(), rx[0], Config.ignore_diacritics)
-					|| Regex::search(s->getComposer(), rx[0], Config.ignore_diacritics)
-					|| Regex::search(s->getPerformer(), rx[0], Config.ignore_diacritics)
-					|| Regex::search(s->getGenre(), rx[0], Config.ignore_diacritics)
-					|| Regex::search(s->getDate(), rx[0], Config.ignore_diacritics)
-					|| Regex::search(s->getComment(), rx[0], Config.ignore_diacritics);
-			if (found && !rx[1].empty())
-				found = Regex::search(s->getArtist(), rx[1], Config.ignore_diacritics);
-			if (found && !rx[2].empty())
-				found = Regex::search(s->getAlbumArtist(), rx[2], Config.ignore_diacritics);
-			if (found && !rx[3].empty())
-				found = Regex::search(s->getTitle(), rx[3], Config.ignore_diacritics);
-			if (found && !rx[4].empty())
-				found = Regex::search(s->getAlbum(), rx[4], Config.ignore_diacritics);
-			if (found && !rx[5].empty())
-				found = Regex::search(s->getName(), rx[5], Config.ignore_diacritics);
-			if (found && !rx[6].empty())
-				found = Regex::search(s->getComposer(), rx[6], Config.ignore_diacritics);
-			if (found && !rx[7].empty())
-				found = Regex::search(s->getPerformer(), rx[7], Config.ignore_diacritics);
-			if (found && !rx[8].empty())
-				found = Regex::search(s->getGenre(), rx[8], Config.ignore_diacritics);
-			if (found && !rx[9].empty())
-				found = Regex::search(s->getDate(), rx[9], Config.ignore_diacritics);
-			if (found && !rx[10].empty())
-				found = Regex::search(s->getComment(), rx[10], Config.ignore_diacritics);
-		}
-		else // match only if values are equal
+	w.at(SearchButton).value().mkBuffer() << "Stop searching";
+}
+
+bool SearchEngine::collectLocalSearchResults()
+{
+	assert(m_local_search);
+	size_t chunks_done;
+	{
+		ScopedUnfilteredMenu<SEItem> sunfilter(ReapplyFilter::Yes, w);
+		auto results = m_local_search->results.acquire();
+		// Add results in the order of the searched list.
+		for (auto &chunk = m_local_search->collected;
+		     chunk < m_local_search->chunks_number && results->done[chunk];
+		     ++chunk)
 		{
-			if (!itsConstraints[0].empty())
-				any_found =
-				   !cmp(s->getArtist(), itsConstraints[0])
-				|| !cmp(s->getAlbumArtist(), itsConstraints[0])
-				|| !cmp(s->getTitle(), itsConstraints[0])
-				|| !cmp(s->getAlbum(), itsConstraints[0])
-				|| !cmp(s->getName(), itsConstraints[0])
-				|| !cmp(s->getComposer(), itsConstraints[0])
-				|| !cmp(s->getPerformer(), itsConstraints[0])
-				|| !cmp(s->getGenre(), itsConstraints[0])
-				|| !cmp(s->getDate(), itsConstraints[0])
-				|| !cmp(s->getComment(), itsConstraints[0]);
-			
-			if (found && !itsConstraints[1].empty())
-				found = !cmp(s->getArtist(), itsConstraints[1]);
-			if (found && !itsConstraints[2].empty())
-				found = !cmp(s->getAlbumArtist(), itsConstraints[2]);
-			if (found && !itsConstraints[3].empty())
-				found = !cmp(s->getTitle(), itsConstraints[3]);
-			if (found && !itsConstraints[4].empty())
-				found = !cmp(s->getAlbum(), itsConstraints[4]);
-			if (found && !itsConstraints[5].empty())
-				found = !cmp(s->getName(), itsConstraints[5]);
-			if (found && !itsConstraints[6].empty())
-				found = !cmp(s->getComposer(), itsConstraints[6]);
-			if (found && !itsConstraints[7].empty())
-				found = !cmp(s->getPerformer(), itsConstraints[7]);
-			if (found && !itsConstraints[8].empty())
-				found = !cmp(s->getGenre(), itsConstraints[8]);
-			if (found && !itsConstraints[9].empty())
-				found = !cmp(s->getDate(), itsConstraints[9]);
-			if (found && !itsConstraints[10].empty())
-				found = !cmp(s->getComment(), itsConstraints[10]);
+			for (auto &s : results->chunks[chunk])
+				w.addItem(std::move(s));
+			results->chunks[chunk].clear();
 		}
-		
-		if (any_found && found)
-			w.addItem(*s);
+		chunks_done = results->chunks_done;
 	}
+	bool finished = chunks_done == m_local_search->chunks_number;
+	if (finished)
+	{
+		for (auto &worker : m_search_workers)
+			worker.wait();
+		m_search_workers.clear();
+		m_local_search.reset();
+	}
+	else
+		Statusbar::printf("Searching... %1%%%",
+		                  chunks_done * 100 / m_local_search->chunks_number);
+	return finished;
+}
+
+void SearchEngine::stopSearch()
+{
+	// Server side search can't be interrupted, just ignore its results.
+	m_server_search = MPD::SongListFuture();
+	if (!m_local_search)
+		return;
+	m_local_search->stop = true;
+	for (auto &worker : m_search_workers)
+		worker.wait();
+	m_search_workers.clear();
+	// Keep the results found so far.
+	collectLocalSearchResults();
+	m_local_search.reset();
+}
+
+void SearchEngine::finishSearch(bool stopped)
+{
+	w.at(SearchButton).value().mkBuffer() << "Search";
+	if (w.rbegin()->value().isSong())
+	{
+		if (Config.search_engine_display_mode == DisplayMode::Columns)
+			w.setTitle(Config.titles_visibility ? Display::Columns(w.getWidth()) : "");
+		size_t found = w.size()-SearchEngine::StaticOptions;
+		found += 3; // don't count options inserted below
+		w.insertSeparator(ResetButton+1);
+		w.insertItem(ResetButton+2, SEItem(), NC::List::Properties::Inactive);
+		w.at(ResetButton+2).value().mkBuffer()
+			<< NC::Format::Bold
+			<< Config.color1
+			<< "Search results: "
+			<< NC::FormattedColor::End<>(Config.color1)
+			<< Config.color2
+			<< "Found " << found << (found > 1 ? " songs" : " song")
+			<< NC::FormattedColor::End<>(Config.color2)
+			<< NC::Format::NoBold;
+		w.insertSeparator(ResetButton+3);
+		Statusbar::print(stopped ? "Searching stopped" : "Searching finished");
+		if (Config.block_search_constraints_change)
+			for (size_t i = 0; i < StaticOptions-4; ++i)
+				w.at(i).setInactive(true);
+		w.scroll(NC::Scroll::Down);
+		w.scroll(NC::Scroll::Down);
+	}
+	else
+		Statusbar::print(stopped ? "Searching stopped" : "No results found");
 }
 
 namespace {
@@ -21,13 +21,18 @@
 #ifndef NCMPCPP_SEARCH_ENGINE_H
 #define NCMPCPP_SEARCH_ENGINE_H
 
+#include <boost/thread/future.hpp>
 #include <cassert>
+#include <memory>
+#include <vector>
 
 #include "interfaces.h"
 #include "mpdpp.h"
+#include "mpdpp_async.h"
 #include "regex_filter.h"
 #include "screens/screen.h"
 #include "song_list.h"
+#include "song_store.h"
 
 struct SEItem
 {
@@ -102,7 +107,9 @@ struct SearchEngine: Screen<SearchEngineWindow>, Filterable, HasActions, HasSong
 	virtual std::wstring title() override;
 	virtual ScreenType type() override { return ScreenType::SearchEngine; }
 	
-	virtual void update() override { }
+	virtual void update() override;
+
+	virtual int windowTimeout() override;
 	
 	virtual void mouseButtonPressed(MEVENT me) override;
 	
@@ -138,8 +145,24 @@ struct SearchEngine: Screen<SearchEngineWindow>, Filterable, HasActions, HasSong
 	static size_t ResetButton;
 	
 private:
+	struct LocalSearch;
+
 	void Prepare();
 	void Search();
+	void liveSearch();
+	void startLocalSearch(std::vector<MPD::Song> songs);
+	bool collectLocalSearchResults();
+	void stopSearch();
+	void finishSearch(bool stopped);
+
+	bool searching() const { return m_local_search || m_server_search.valid(); }
+
+	std::shared_ptr<LocalSearch> m_local_search;
+	MPD::SongListFuture m_server_search;
+	bool m_editing_constraint;
+	std::vector<boost::BOOST_THREAD_FUTURE<void>> m_search_workers;
+
+	SongStore::ListenerId m_shared_songs;
 
 	Regex::ItemFilter<SEItem> m_search_predicate;
 	
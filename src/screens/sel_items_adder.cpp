@@ -22,6 +22,7 @@
 
 #include "curses/menu_impl.h"
 #include "screens/browser.h"
+#include "screens/media_library.h"
 #include "global.h"
 #include "helpers.h"
 #include "mpdpp.h"
@@ -117,8 +118,19 @@ void SelectedItemsAdder::switchTo()
 	if (!hs)
 		return;
 	
-	Statusbar::print(1, "Fetching selected songs...");
-	m_selected_items = hs->getSelectedSongs();
+	// Songs from the media library and MPD browser are added by the server,
+	// so there is no need to fetch them here.
+	m_selected_items.clear();
+	if (myScreen == myLibrary)
+		m_selected_items = myLibrary->getSelectedQueries();
+	else if (myScreen == myBrowser && !myBrowser->isLocal())
+		m_selected_items = myBrowser->getSelectedQueries();
+	else
+	{
+		Statusbar::print(1, "Fetching selected songs...");
+		for (auto &s : hs->getSelectedSongs())
+			m_selected_items.emplace_back(std::move(s));
+	}
 	if (m_selected_items.empty())
 	{
 		Statusbar::print("No selected songs");
@@ -253,8 +265,8 @@ void SelectedItemsAdder::populatePlaylistSelector(BaseScreen *old_screen)
 				std::bind(&Self::addToExistingPlaylist, this, it->path())
 			));
 		};
-		std::sort(m_playlist_selector.beginV()+begin, m_playlist_selector.endV(),
-			LocaleBasedSorting(std::locale(), Config.ignore_leading_the));
+		sortByKey(m_playlist_selector.beginV()+begin, m_playlist_selector.endV(),
+			LocaleBasedSortKeys(std::locale(), Config.ignore_leading_the));
 		if (begin < m_playlist_selector.size())
 			m_playlist_selector.addSeparator();
 	}
@@ -282,23 +294,20 @@ void SelectedItemsAdder::addToNewPlaylist() const
 
 void SelectedItemsAdder::addToExistingPlaylist(const std::string &playlist) const
 {
-	Mpd.StartCommandsList();
-	for (auto s = m_selected_items.begin(); s != m_selected_items.end(); ++s)
-		Mpd.AddToPlaylist(playlist, *s);
-	Mpd.CommitCommandsList();
+	addQueriesToStoredPlaylist(m_selected_items, playlist);
 	Statusbar::printf("Selected item(s) added to playlist \"%1%\"", playlist);
 	switchToPreviousScreen();
 }
 
 void SelectedItemsAdder::addAtTheEndOfPlaylist() const
 {
-	bool success = addSongsToPlaylist(m_selected_items.begin(), m_selected_items.end(), false, -1);
+	bool success = addQueriesToPlaylist(m_selected_items, false, -1);
 	exitSuccessfully(success);
 }
 
 void SelectedItemsAdder::addAtTheBeginningOfPlaylist() const
 {
-	bool success = addSongsToPlaylist(m_selected_items.begin(), m_selected_items.end(), false, 0);
+	bool success = addQueriesToPlaylist(m_selected_items, false, 0);
 	exitSuccessfully(success);
 }
 
@@ -308,7 +317,7 @@ void SelectedItemsAdder::addAfterCurrentSong() const
 		return;
 	size_t pos = Status::State::currentSongPosition();
 	++pos;
-	bool success = addSongsToPlaylist(m_selected_items.begin(), m_selected_items.end(), false, pos);
+	bool success = addQueriesToPlaylist(m_selected_items, false, pos);
 	exitSuccessfully(success);
 }
 
@@ -321,7 +330,7 @@ void SelectedItemsAdder::addAfterCurrentAlbum() const
 	std::string album =  pl[pos].value().getAlbum();
 	while (pos < pl.size() && pl[pos].value().getAlbum() == album)
 		++pos;
-	bool success = addSongsToPlaylist(m_selected_items.begin(), m_selected_items.end(), false, pos);
+	bool success = addQueriesToPlaylist(m_selected_items, false, pos);
 	exitSuccessfully(success);
 }
 
@@ -329,7 +338,7 @@ void SelectedItemsAdder::addAfterHighlightedSong() const
 {
 	size_t pos = myPlaylist->main().current()->value().getPosition();
 	++pos;
-	bool success = addSongsToPlaylist(m_selected_items.begin(), m_selected_items.end(), false, pos);
+	bool success = addQueriesToPlaylist(m_selected_items, false, pos);
 	exitSuccessfully(success);
 }
 
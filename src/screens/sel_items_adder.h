@@ -22,6 +22,7 @@
 #define NCMPCPP_SEL_ITEMS_ADDER_H
 
 #include "runnable_item.h"
+#include "database_query.h"
 #include "interfaces.h"
 #include "regex_filter.h"
 #include "screens/screen.h"
@@ -85,7 +86,7 @@ private:
 	Component m_playlist_selector;
 	Component m_position_selector;
 	
-	std::vector<MPD::Song> m_selected_items;
+	std::vector<DatabaseQuery> m_selected_items;
 
 	Regex::ItemFilter<Entry> m_search_predicate;
 };
@@ -23,6 +23,8 @@
 
 #include "global.h"
 #include "helpers.h"
+#include "screens/playlist.h"
+#include "screens/playlist_editor.h"
 #include "screens/server_info.h"
 #include "statusbar.h"
 #include "screens/screen_switcher.h"
@@ -116,6 +118,13 @@ void ServerInfo::update()
 	w << NC::Format::Bold << "Tag Types:" << NC::Format::NoBold;
 	for (auto it = m_tag_types.begin(); it != m_tag_types.end(); ++it)
 		w << (it != m_tag_types.begin() ? ", " : " ") << *it;
+	w << "\n\n";
+	w << NC::Format::Bold << "Songs found in playlist: " << NC::Format::NoBold
+	  << myPlaylist->songLookupHits() << " of "
+	  << myPlaylist->songLookupHits() + myPlaylist->songLookupMisses() << " lookups\n";
+	w << NC::Format::Bold << "Playlists found in cache: " << NC::Format::NoBold
+	  << myPlaylistEditor->contentCacheHits() << " of "
+	  << myPlaylistEditor->contentCacheHits() + myPlaylistEditor->contentCacheMisses() << " lookups";
 	
 	w.flush();
 	w.refresh();
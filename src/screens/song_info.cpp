@@ -20,6 +20,7 @@
 
 #include "global.h"
 #include "helpers.h"
+#include "playlist_index.h"
 #include "screens/song_info.h"
 #include "screens/tag_editor.h"
 #include "tags.h"
@@ -37,6 +38,16 @@ using Global::MainStartY;
 
 SongInfo *mySongInfo;
 
+namespace {
+
+void storedPlaylistsFetched()
+{
+	if (StoredPlaylists.completeFetch() && isVisible(mySongInfo))
+		mySongInfo->redisplaySong();
+}
+
+}
+
 const SongInfo::Metadata SongInfo::Tags[] =
 {
  { "Title",        &MPD::Song::getTitle,       &MPD::MutableSong::setTitle       },
@@ -82,7 +93,8 @@ void SongInfo::switchTo()
 		SwitchTo::execute(this);
 		w.clear();
 		w.reset();
-		PrepareSong(*s);
+		m_song = *s;
+		PrepareSong(m_song);
 		w.flush();
 		// redraw header after we're done with the file, since reading it from disk
 		// takes a bit of time and having header updated before content of a window
@@ -93,6 +105,14 @@ void SongInfo::switchTo()
 		switchToPreviousScreen();
 }
 
+void SongInfo::redisplaySong()
+{
+	w.clear();
+	PrepareSong(m_song);
+	w.flush();
+	w.refresh();
+}
+
 void SongInfo::PrepareSong(const MPD::Song &s)
 {
 	auto print_key_value = [this](const char *key, const auto &value) {
@@ -152,4 +172,19 @@ void SongInfo::PrepareSong(const MPD::Song &s)
 		w << NC::Format::Bold << "\n" << m->Name << ":" << NC::Format::NoBold << " ";
 		ShowTag(w, s.getTags(m->Get));
 	}
+
+	// Show what is already indexed, the song is displayed again if
+	// stored playlists turn out to be modified.
+	StoredPlaylists.prefetch(storedPlaylistsFetched);
+	std::string playlists;
+	for (const auto &match : StoredPlaylists.find(s))
+	{
+		if (!playlists.empty())
+			playlists += ", ";
+		playlists += match.playlist;
+		if (match.positions.size() > 1)
+			playlists += " (" + std::to_string(match.positions.size()) + " times)";
+	}
+	w << "\n\n";
+	print_key_value("Stored playlists", ShowTag(playlists));
 }
@@ -51,8 +51,13 @@ struct SongInfo: Screen<NC::Scrollpad>, Tabbable
 	// private members
 	static const Metadata Tags[];
 	
+	/// Display the song again, e.g. once stored playlists were indexed.
+	void redisplaySong();
+	
 private:
 	void PrepareSong(const MPD::Song &s);
+	
+	MPD::Song m_song;
 };
 
 extern SongInfo *mySongInfo;
@@ -166,57 +166,51 @@ void SortPlaylistDialog::moveSortOrderHint() const
 
 void SortPlaylistDialog::sort() const
 {
+	// Queue may have changed while the dialog was open.
+	myPlaylist->loadAll();
 	auto &pl = myPlaylist->main();
 	auto begin = pl.begin(), end = pl.end();
 	if (!findSelectedRange(begin, end))
 		return;
 
-	size_t start_pos = begin - pl.begin();
-	std::vector<MPD::Song> playlist;
-	playlist.reserve(end - begin);
+	std::vector<MPD::Song::GetFunction> getters;
+	for (auto it = w.beginV(); it->item().second; ++it)
+		getters.push_back(it->item().second);
+
+	// Songs are represented by sort keys of their tags in the chosen order
+	// followed by their indices in the range, so they are compared without
+	// collating and songs with equal tags keep their order.
+	typedef std::pair<std::vector<SortKey>, size_t> SongKey;
+	SortKeyCache sort_keys(std::locale(), Config.ignore_leading_the);
+	std::vector<SongKey> keys;
+	std::vector<unsigned> positions;
+	keys.reserve(end - begin);
+	positions.reserve(end - begin);
 	for (; begin != end; ++begin)
-		playlist.push_back(begin->value());
-	
-	typedef std::vector<MPD::Song>::iterator Iterator;
-	LocaleStringComparison cmp(std::locale(), Config.ignore_leading_the);
-	std::function<void(Iterator, Iterator)> iter_swap, quick_sort;
-	auto song_cmp = [this, &cmp](const MPD::Song &a, const MPD::Song &b) -> bool {
-		for (auto it = w.beginV();  it->item().second; ++it)
-		{
-			int res = cmp(a.getTags(it->item().second),
-			              b.getTags(it->item().second));
-			if (res != 0)
-				return res < 0;
-		}
-		return a.getPosition() < b.getPosition();
-	};
-	iter_swap = [&playlist, &start_pos](Iterator a, Iterator b) {
-		std::iter_swap(a, b);
-		Mpd.Swap(start_pos+a-playlist.begin(), start_pos+b-playlist.begin());
-	};
-	quick_sort = [this, &song_cmp, &quick_sort, &iter_swap](Iterator first, Iterator last) {
-		if (last-first > 1)
-		{
-			Iterator pivot = first+Global::RNG()%(last-first);
-			iter_swap(pivot, last-1);
-			pivot = last-1;
-			
-			Iterator tmp = first;
-			for (Iterator i = first; i != pivot; ++i)
-				if (song_cmp(*i, *pivot))
-					iter_swap(i, tmp++);
-			iter_swap(tmp, pivot);
-			
-			quick_sort(first, tmp);
-			quick_sort(tmp+1, last);
-		}
-	};
-	
+	{
+		SongKey key;
+		key.first.reserve(getters.size());
+		for (auto get : getters)
+			key.first.push_back(sort_keys(begin->value().getTags(get)));
+		key.second = positions.size();
+		keys.push_back(std::move(key));
+		positions.push_back(begin->value().getPosition());
+	}
+	parallelSort(keys.begin(), keys.end());
+
+	std::vector<size_t> order;
+	order.reserve(keys.size());
+	size_t moved = 0;
+	for (const auto &key : keys)
+	{
+		moved += key.second != order.size();
+		order.push_back(key.second);
+	}
+
 	Statusbar::print("Sorting...");
-	Mpd.StartCommandsList();
-	quick_sort(playlist.begin(), playlist.end());
-	Mpd.CommitCommandsList();
-	Statusbar::print("Range sorted");
+	size_t commands = reorderQueue(positions, order);
+	Statusbar::printf("Range sorted (%1% commands sent, %2% saved)",
+		commands, moved > commands ? moved - commands : 0);
 	switchToPreviousScreen();
 }
 
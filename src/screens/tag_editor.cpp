@@ -42,6 +42,7 @@
 #include "utility/comparators.h"
 #include "title.h"
 #include "tags.h"
+#include "tag_writer.h"
 #include "screens/screen_switcher.h"
 
 using Global::myScreen;
@@ -288,8 +289,8 @@ void TagEditor::update()
 			if (directory->path() == itsHighlightedDir)
 				Dirs->highlight(Dirs->size()-1);
 		};
-		std::sort(Dirs->beginV()+1, Dirs->endV(),
-			LocaleBasedSorting(std::locale(), Config.ignore_leading_the));
+		sortByKey(Dirs->beginV()+1, Dirs->endV(),
+			LocaleBasedSortKeys(std::locale(), Config.ignore_leading_the));
 		Dirs->display();
 	}
 	
@@ -299,8 +300,8 @@ void TagEditor::update()
 		MPD::SongIterator s = Mpd.GetSongs(Dirs->current()->value().second), end;
 		for (; s != end; ++s)
 			Tags->addItem(std::move(*s));
-		std::sort(Tags->beginV(), Tags->endV(),
-			LocaleBasedSorting(std::locale(), Config.ignore_leading_the));
+		sortByKey(Tags->beginV(), Tags->endV(),
+			LocaleBasedSortKeys(std::locale(), Config.ignore_leading_the));
 		Tags->refresh();
 	}
 	
@@ -794,31 +795,26 @@ void TagEditor::runAction()
 		}
 		else if (id == TagTypes->size()-1) // save
 		{
-			bool success = 1;
-			Statusbar::print("Writing changes...");
-			for (auto it = EditedSongs.begin(); it != EditedSongs.end(); ++it)
+			if (TagWriter.busy())
 			{
-				Statusbar::printf("Writing tags in \"%1%\"...", (*it)->getName());
-				if (!Tags::write(**it))
-				{
-					Statusbar::printf("Error while writing tags to \"%1%\": %2%",
-					                  (*it)->getName(), strerror(errno));
-					success = 0;
-					break;
-				}
-			}
-			if (success)
-			{
-				Statusbar::print("Tags updated");
-				setHighlightInactiveColumnFixes(*TagTypes);
-				TagTypes->reset();
-				w->refresh();
-				w = Dirs;
-				setHighlightFixes(*Dirs);
-				Mpd.UpdateDirectory(getSharedDirectory(Tags->beginV(), Tags->endV()));
+				TagWriter.promptCancel();
+				return;
 			}
-			else
-				Tags->clear();
+			std::vector<MPD::MutableSong> songs;
+			songs.reserve(EditedSongs.size());
+			for (auto it = EditedSongs.begin(); it != EditedSongs.end(); ++it)
+				songs.push_back(**it);
+			TagWriter.start(std::move(songs), [this](const TagWritePipeline::Report &report) {
+				// Reload tags so that the ones that weren't written don't
+				// look like they were, unless the user is editing them again.
+				if (report.written < report.total && w == Dirs)
+					Tags->clear();
+			});
+			setHighlightInactiveColumnFixes(*TagTypes);
+			TagTypes->reset();
+			w->refresh();
+			w = Dirs;
+			setHighlightFixes(*Dirs);
 		}
 	}
 }
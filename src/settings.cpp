@@ -274,6 +274,7 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 		});
 	p.add("mpd_music_dir", &mpd_music_dir, "~/music", adjust_directory);
 	p.add("mpd_connection_timeout", &mpd_connection_timeout, "5");
+	p.add("mpd_fast_song_parsing", &mpd_fast_song_parsing, "yes", yes_no);
 	p.add("mpd_crossfade_time", &crossfade_time, "5");
 	p.add("random_exclude_pattern", &random_exclude_pattern, "");
 	p.add("visualizer_fifo_path", &visualizer_fifo_path, "/tmp/mpd.fifo", adjust_path);
@@ -466,6 +467,12 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 	p.add("lyrics_fetchers", &lyrics_fetchers,
 	      "lyricwiki, azlyrics, genius, sing365, lyricsmania, metrolyrics, justsomelyrics, jahlyrics, plyrics, tekstowo, zeneszoveg, internet",
 	      list_of<LyricsFetcher_>);
+	p.add("lyrics_fetchers_concurrency", &lyrics_fetchers_concurrency,
+	      "1", [](std::string v) {
+		      auto n = verbose_lexical_cast<unsigned>(v);
+		      boundsCheck<unsigned>(n, 1, 16);
+		      return n;
+	      });
 	p.add("follow_now_playing_lyrics", &now_playing_lyrics, "no", yes_no);
 	p.add("fetch_lyrics_for_current_song_in_background", &fetch_lyrics_in_background,
 	      "no", yes_no);
@@ -478,6 +485,8 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 	p.add("space_add_mode", &space_add_mode, "add_remove");
 	p.add("show_hidden_files_in_local_browser", &local_browser_show_hidden_files,
 	      "no", yes_no);
+	p.add("watch_directory_in_local_browser", &local_browser_watch_directory,
+	      "yes", yes_no);
 	p.add<void>(
 		"screen_switcher_mode", nullptr, "playlist, browser",
 		[this](std::string v) {
@@ -569,6 +578,7 @@ bool Configuration::read(const std::vector<std::string> &config_paths, bool igno
 		      boundsCheck<unsigned>(mode, 1, 3);
 		      return --mode;
 	      });
+	p.add("search_engine_live_search", &search_engine_live_search, "no", yes_no);
 	p.add("external_editor", &external_editor, "nano", adjust_path);
 	p.add("use_console_editor", &use_console_editor, "yes", yes_no);
 	p.add("colors_enabled", &colors_enabled, "yes", yes_no);
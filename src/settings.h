@@ -150,6 +150,7 @@ struct Configuration
 	bool now_playing_lyrics;
 	bool fetch_lyrics_in_background;
 	bool local_browser_show_hidden_files;
+	bool local_browser_watch_directory;
 	bool search_in_db;
 	bool jump_to_now_playing_song_at_start;
 	bool clock_display_seconds;
@@ -176,6 +177,7 @@ struct Configuration
 	bool allow_for_physical_item_deletion;
 	bool media_library_albums_split_by_date;
 	bool startup_slave_screen_focus;
+	bool mpd_fast_song_parsing;
 
 	unsigned mpd_connection_timeout;
 	unsigned crossfade_time;
@@ -185,6 +187,7 @@ struct Configuration
 	unsigned lyrics_db;
 	unsigned lines_scrolled;
 	unsigned search_engine_default_search_mode;
+	bool search_engine_live_search;
 
 	boost::regex::flag_type regex_type;
 
@@ -210,6 +213,7 @@ struct Configuration
 	SortMode browser_sort_mode;
 
 	LyricsFetchers lyrics_fetchers;
+	unsigned lyrics_fetchers_concurrency;
 };
 
 extern Configuration Config;
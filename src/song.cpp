@@ -18,6 +18,7 @@
  *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
  ***************************************************************************/
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <boost/format.hpp>
@@ -25,9 +26,11 @@
 #include <boost/lexical_cast.hpp>
 #include <iostream>
 #include <memory>
+#include <mutex>
 
 #include "curses/window.h"
 #include "song.h"
+#include "utility/string_pool.h"
 #include "utility/type_conversions.h"
 #include "utility/wide_string.h"
 
@@ -49,6 +52,24 @@ size_t calc_hash(const char *s, size_t seed = 0)
 	return seed;
 }
 
+// Limits of the size of blocks allocated by Song::Builder.
+const size_t max_block_songs = 512;
+const size_t block_tags_per_song = 16;
+
+// Songs are interned by background fetches too. The pool is never
+// destroyed as songs held by other globals release their strings on exit.
+struct LockedStringPool
+{
+	StringPool pool;
+	std::mutex mutex;
+};
+
+LockedStringPool &TagPool()
+{
+	static auto pool = new LockedStringPool;
+	return *pool;
+}
+
 }
 
 namespace MPD {
@@ -60,12 +81,26 @@ bool Song::ShowDuplicateTags = true;
 std::string Song::get(mpd_tag_type type, unsigned idx) const
 {
 	std::string result;
-	const char *tag = mpd_song_get_tag(m_song.get(), type, idx);
+	const char *tag = c_tag(type, idx);
 	if (tag)
 		result = tag;
 	return result;
 }
 
+const char *Song::c_tag(mpd_tag_type type, unsigned idx) const
+{
+	if (m_song)
+		return mpd_song_get_tag(m_song.get(), type, idx);
+	else if (m_interned)
+	{
+		const Tag *end = m_interned->tags + m_interned->tags_count;
+		for (const Tag *tag = m_interned->tags; tag != end; ++tag)
+			if (tag->first == type && idx-- == 0)
+				return tag->second;
+	}
+	return nullptr;
+}
+
 Song::Song(mpd_song *s)
 {
 	assert(s);
@@ -73,25 +108,167 @@ Song::Song(mpd_song *s)
 	m_hash = calc_hash(mpd_song_get_uri(s));
 }
 
+struct Song::Block
+{
+	Block(size_t songs_size_, size_t tags_size_)
+	: songs(new InternedData[songs_size_]), tags(new Tag[tags_size_])
+	, songs_size(songs_size_), songs_used(0)
+	, tags_size(tags_size_), tags_used(0)
+	, refs(1)
+	{ }
+
+	std::unique_ptr<InternedData[]> songs;
+	std::unique_ptr<Tag[]> tags;
+	size_t songs_size;
+	size_t songs_used;
+	size_t tags_size;
+	size_t tags_used;
+
+	// Number of songs in use plus one for the builder filling the block.
+	std::atomic<long> refs;
+};
+
+void intrusive_ptr_add_ref(Song::InternedData *data)
+{
+	++data->refs;
+}
+
+void intrusive_ptr_release(Song::InternedData *data)
+{
+	if (--data->refs == 0)
+	{
+		{
+			auto &tag_pool = TagPool();
+			std::lock_guard<std::mutex> lock(tag_pool.mutex);
+			tag_pool.pool.release(data->uri);
+			const Song::Tag *end = data->tags + data->tags_count;
+			for (const Song::Tag *tag = data->tags; tag != end; ++tag)
+				tag_pool.pool.release(tag->second);
+		}
+		if (--data->block->refs == 0)
+			delete data->block;
+	}
+}
+
+Song::Builder::Builder()
+: m_block_songs(1)
+, m_block(nullptr)
+{
+	start("");
+}
+
+Song::Builder::~Builder()
+{
+	if (m_block != nullptr && --m_block->refs == 0)
+		delete m_block;
+}
+
+void Song::Builder::start(const char *uri)
+{
+	m_uri = uri;
+	m_values.clear();
+	m_tags.clear();
+	m_duration = 0;
+	m_mtime = 0;
+	m_position = 0;
+	m_id = 0;
+	m_prio = 0;
+}
+
+void Song::Builder::addTag(mpd_tag_type type, const char *value)
+{
+	// Values are copied as the caller's buffer usually doesn't outlive
+	// the call, they're interned all at once in finish.
+	m_tags.emplace_back(type, m_values.size());
+	m_values += value;
+	m_values += '\0';
+}
+
+Song Song::Builder::finish()
+{
+	if (m_block == nullptr
+	||  m_block->songs_used == m_block->songs_size
+	||  m_block->tags_size - m_block->tags_used < m_tags.size())
+	{
+		// The first block fits the song exactly.
+		size_t tags_size = m_block == nullptr
+			? m_tags.size()
+			: std::max(m_block_songs * block_tags_per_song, m_tags.size());
+		if (m_block != nullptr && --m_block->refs == 0)
+			delete m_block;
+		m_block = new Block(m_block_songs, tags_size);
+		m_block_songs = std::min(2 * m_block_songs, max_block_songs);
+	}
+
+	InternedData &data = m_block->songs[m_block->songs_used++];
+	Tag *tags = m_block->tags.get() + m_block->tags_used;
+	m_block->tags_used += m_tags.size();
+	{
+		auto &tag_pool = TagPool();
+		std::lock_guard<std::mutex> lock(tag_pool.mutex);
+		data.uri = tag_pool.pool.intern(m_uri);
+		for (size_t i = 0; i < m_tags.size(); ++i)
+		{
+			tags[i].first = m_tags[i].first;
+			tags[i].second = tag_pool.pool.intern(m_values.c_str() + m_tags[i].second);
+		}
+	}
+	data.tags = tags;
+	data.tags_count = m_tags.size();
+	data.duration = m_duration;
+	data.mtime = m_mtime;
+	data.position = m_position;
+	data.id = m_id;
+	data.prio = m_prio;
+	data.refs = 0;
+	data.block = m_block;
+	++m_block->refs;
+
+	Song result;
+	result.m_interned = &data;
+	result.m_hash = calc_hash(data.uri);
+	return result;
+}
+
+Song Song::intern() const
+{
+	assert(!empty());
+	if (m_interned)
+		return *this;
+	// The only song of a builder gets a block of its exact size.
+	Builder builder;
+	builder.start(c_uri());
+	for (int type = 0; type < MPD_TAG_COUNT; ++type)
+	{
+		const char *value;
+		for (unsigned idx = 0;
+		     (value = mpd_song_get_tag(m_song.get(), mpd_tag_type(type), idx)) != nullptr;
+		     ++idx)
+			builder.addTag(mpd_tag_type(type), value);
+	}
+	builder.setDuration(mpd_song_get_duration(m_song.get()));
+	builder.setMTime(mpd_song_get_last_modified(m_song.get()));
+	return builder.finish();
+}
+
 std::string Song::getURI(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	if (idx > 0)
 		return "";
 	else
-		return mpd_song_get_uri(m_song.get());
+		return c_uri();
 }
 
 std::string Song::getName(unsigned idx) const
 {
-	assert(m_song);
-	mpd_song *s = m_song.get();
-	const char *res = mpd_song_get_tag(s, MPD_TAG_NAME, idx);
+	assert(!empty());
+	const char *res = c_tag(MPD_TAG_NAME, idx);
 	if (res)
 		return res;
 	else if (idx > 0)
 		return "";
-	const char *uri = mpd_song_get_uri(s);
+	const char *uri = c_uri();
 	const char *name = strrchr(uri, '/');
 	if (name)
 		return name+1;
@@ -101,10 +278,10 @@ std::string Song::getName(unsigned idx) const
 
 std::string Song::getDirectory(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	if (idx > 0 || isStream())
 		return "";
-	const char *uri = mpd_song_get_uri(m_song.get());
+	const char *uri = c_uri();
 	const char *name = strrchr(uri, '/');
 	if (name)
 		return std::string(uri, name-uri);
@@ -114,31 +291,31 @@ std::string Song::getDirectory(unsigned idx) const
 
 std::string Song::getArtist(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	return get(MPD_TAG_ARTIST, idx);
 }
 
 std::string Song::getTitle(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	return get(MPD_TAG_TITLE, idx);
 }
 
 std::string Song::getAlbum(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	return get(MPD_TAG_ALBUM, idx);
 }
 
 std::string Song::getAlbumArtist(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	return get(MPD_TAG_ALBUM_ARTIST, idx);
 }
 
 std::string Song::getTrack(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	std::string track = get(MPD_TAG_TRACK, idx);
 	format_numeric_tag(track);
 	return track;
@@ -146,7 +323,7 @@ std::string Song::getTrack(unsigned idx) const
 
 std::string Song::getTrackNumber(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	std::string track = getTrack(idx);
 	size_t slash = track.find('/');
 	if (slash != std::string::npos)
@@ -156,31 +333,31 @@ std::string Song::getTrackNumber(unsigned idx) const
 
 std::string Song::getDate(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	return get(MPD_TAG_DATE, idx);
 }
 
 std::string Song::getGenre(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	return get(MPD_TAG_GENRE, idx);
 }
 
 std::string Song::getComposer(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	return get(MPD_TAG_COMPOSER, idx);
 }
 
 std::string Song::getPerformer(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	return get(MPD_TAG_PERFORMER, idx);
 }
 
 std::string Song::getDisc(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	std::string disc = get(MPD_TAG_DISC, idx);
 	format_numeric_tag(disc);
 	return disc;
@@ -188,13 +365,13 @@ std::string Song::getDisc(unsigned idx) const
 
 std::string Song::getComment(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	return get(MPD_TAG_COMMENT, idx);
 }
 
 std::string Song::getLength(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	if (idx > 0)
 		return "";
 	unsigned len = getDuration();
@@ -206,7 +383,7 @@ std::string Song::getLength(unsigned idx) const
 
 std::string Song::getPriority(unsigned idx) const
 {
-	assert(m_song);
+	assert(!empty());
 	if (idx > 0)
 		return "";
 	return boost::lexical_cast<std::string>(getPrio());
@@ -214,7 +391,7 @@ std::string Song::getPriority(unsigned idx) const
 
 std::string MPD::Song::getTags(GetFunction f) const
 {
-	assert(m_song);
+	assert(!empty());
 	unsigned idx = 0;
 	std::string result;
 	if (ShowDuplicateTags)
@@ -255,50 +432,86 @@ std::string MPD::Song::getTags(GetFunction f) const
 
 unsigned Song::getDuration() const
 {
-	assert(m_song);
+	assert(!empty());
+	if (m_interned)
+		return m_interned->duration;
 	return mpd_song_get_duration(m_song.get());
 }
 
 unsigned Song::getPosition() const
 {
-	assert(m_song);
+	assert(!empty());
+	if (m_interned)
+		return m_interned->position;
 	return mpd_song_get_pos(m_song.get());
 }
 
+void Song::setPosition(unsigned pos)
+{
+	assert(!empty());
+	if (m_interned)
+	{
+		if (m_interned->refs > 1)
+		{
+			Builder builder;
+			builder.start(m_interned->uri);
+			const Tag *end = m_interned->tags + m_interned->tags_count;
+			for (const Tag *tag = m_interned->tags; tag != end; ++tag)
+				builder.addTag(tag->first, tag->second);
+			builder.setDuration(m_interned->duration);
+			builder.setMTime(m_interned->mtime);
+			builder.setID(m_interned->id);
+			builder.setPrio(m_interned->prio);
+			*this = builder.finish();
+		}
+		m_interned->position = pos;
+		return;
+	}
+	if (m_song.use_count() > 1)
+		m_song = std::shared_ptr<mpd_song>(mpd_song_dup(m_song.get()), mpd_song_free);
+	mpd_song_set_pos(m_song.get(), pos);
+}
+
 unsigned Song::getID() const
 {
-	assert(m_song);
+	assert(!empty());
+	if (m_interned)
+		return m_interned->id;
 	return mpd_song_get_id(m_song.get());
 }
 
 unsigned Song::getPrio() const
 {
-	assert(m_song);
+	assert(!empty());
+	if (m_interned)
+		return m_interned->prio;
 	return mpd_song_get_prio(m_song.get());
 }
 
 time_t Song::getMTime() const
 {
-	assert(m_song);
+	assert(!empty());
+	if (m_interned)
+		return m_interned->mtime;
 	return mpd_song_get_last_modified(m_song.get());
 }
 
 bool Song::isFromDatabase() const
 {
-	assert(m_song);
-	const char *uri = mpd_song_get_uri(m_song.get());
+	assert(!empty());
+	const char *uri = c_uri();
 	return uri[0] != '/' || !strrchr(uri, '/');
 }
 
 bool Song::isStream() const
 {
-	assert(m_song);
-	return !strncmp(mpd_song_get_uri(m_song.get()), "http://", 7);
+	assert(!empty());
+	return !strncmp(c_uri(), "http://", 7);
 }
 
 bool Song::empty() const
 {
-	return m_song.get() == 0;
+	return m_song.get() == 0 && m_interned.get() == 0;
 }
 
 std::string Song::ShowTime(unsigned length)
@@ -21,11 +21,14 @@
 #ifndef NCMPCPP_SONG_H
 #define NCMPCPP_SONG_H
 
+#include <atomic>
 #include <cstring>
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
+#include <boost/intrusive_ptr.hpp>
 
 #include <mpd/client.h>
 
@@ -38,22 +41,38 @@ struct Song
 	};
 
 	typedef std::string (Song::*GetFunction)(unsigned) const;
+	typedef std::pair<mpd_tag_type, const char *> Tag;
+
+	struct Builder;
 	
 	Song() : m_hash(0) { }
 	virtual ~Song() { }
 	
 	Song(mpd_song *s);
 
-	Song(const Song &rhs) : m_song(rhs.m_song), m_hash(rhs.m_hash) { }
-	Song(Song &&rhs) : m_song(std::move(rhs.m_song)), m_hash(rhs.m_hash) { }
+	Song(const Song &rhs)
+	: m_song(rhs.m_song), m_interned(rhs.m_interned), m_hash(rhs.m_hash) { }
+	Song(Song &&rhs)
+	: m_song(std::move(rhs.m_song)), m_interned(std::move(rhs.m_interned))
+	, m_hash(rhs.m_hash) { }
 	Song &operator=(Song rhs)
 	{
 		m_song = std::move(rhs.m_song);
+		m_interned = std::move(rhs.m_interned);
 		m_hash = rhs.m_hash;
 		return *this;
 	}
+
+	/// @return copy of the song backed by the string pool. Position, id and
+	/// priority of songs not already interned are not preserved, so it's
+	/// suitable only for database songs.
+	Song intern() const;
 	
 	std::string get(mpd_tag_type type, unsigned idx = 0) const;
+
+	/// @return tag as stored (modifications of MutableSong are not taken
+	/// into account) without copying or nullptr if it's not there.
+	const char *c_tag(mpd_tag_type type, unsigned idx = 0) const;
 	
 	virtual std::string getURI(unsigned idx = 0) const;
 	virtual std::string getName(unsigned idx = 0) const;
@@ -80,11 +99,26 @@ struct Song
 	virtual unsigned getID() const;
 	virtual unsigned getPrio() const;
 	virtual time_t getMTime() const;
+
+	/// Update position of a queue song after it was moved. Copies
+	/// of the song are not affected.
+	void setPosition(unsigned pos);
 	
 	virtual bool isFromDatabase() const;
 	virtual bool isStream() const;
 	
 	virtual bool empty() const;
+
+	/// @return number of songs sharing data with this one.
+	long useCount() const
+	{
+		if (m_song)
+			return m_song.use_count();
+		else if (m_interned)
+			return m_interned->refs;
+		else
+			return 0;
+	}
 	
 	bool operator==(const Song &rhs) const
 	{
@@ -97,7 +131,15 @@ struct Song
 		return !(operator==(rhs));
 	}
 
-	const char *c_uri() const { return m_song ? mpd_song_get_uri(m_song.get()) : ""; }
+	const char *c_uri() const
+	{
+		if (m_song)
+			return mpd_song_get_uri(m_song.get());
+		else if (m_interned)
+			return m_interned->uri;
+		else
+			return "";
+	}
 
 	static std::string ShowTime(unsigned length);
 
@@ -106,10 +148,71 @@ struct Song
 	static bool ShowDuplicateTags;
 
 private:
+	struct Block;
+
+	struct InternedData
+	{
+		const char *uri;
+		const Tag *tags;
+		size_t tags_count;
+		unsigned duration;
+		time_t mtime;
+		unsigned position;
+		unsigned id;
+		unsigned prio;
+
+		// Songs are counted separately, block is freed with the last one.
+		std::atomic<long> refs;
+		Block *block;
+	};
+
+	friend void intrusive_ptr_add_ref(InternedData *data);
+	friend void intrusive_ptr_release(InternedData *data);
+
 	std::shared_ptr<mpd_song> m_song;
+	boost::intrusive_ptr<InternedData> m_interned;
 	size_t m_hash;
 };
 
+/// Creates songs that keep their tags in the global string pool instead
+/// of mpd_song, so that each distinct value is stored only once. Song
+/// data is placed in blocks shared by consecutive songs, hence apart
+/// from new distinct strings nothing is allocated per song. The first
+/// block holds a single song and each next one is twice as big (up to
+/// a limit), so that songs of short responses don't pin large blocks.
+struct Song::Builder
+{
+	Builder();
+	~Builder();
+
+	Builder(const Builder &) = delete;
+	Builder &operator=(const Builder &) = delete;
+
+	void start(const char *uri);
+	void addTag(mpd_tag_type type, const char *value);
+	void setDuration(unsigned duration) { m_duration = duration; }
+	void setMTime(time_t mtime) { m_mtime = mtime; }
+	void setPosition(unsigned pos) { m_position = pos; }
+	void setID(unsigned id) { m_id = id; }
+	void setPrio(unsigned prio) { m_prio = prio; }
+
+	/// @return song with the data given since the last call to start.
+	Song finish();
+
+private:
+	size_t m_block_songs;
+	Block *m_block;
+
+	std::string m_uri;
+	std::string m_values;
+	std::vector<std::pair<mpd_tag_type, size_t>> m_tags;
+	unsigned m_duration;
+	time_t m_mtime;
+	unsigned m_position;
+	unsigned m_id;
+	unsigned m_prio;
+};
+
 }
 
 #endif // NCMPCPP_SONG_H
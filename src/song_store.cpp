@@ -0,0 +1,113 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+
+#include "song_store.h"
+
+SongStore SharedSongs;
+
+namespace {
+
+// Don't prune the store until it has at least that many songs.
+const size_t min_prune_threshold = 1024;
+
+bool sameVersion(const MPD::Song &a, const MPD::Song &b)
+{
+	return a.getMTime() == b.getMTime() && a.getDuration() == b.getDuration();
+}
+
+}
+
+SongStore::SongStore()
+: m_prune_threshold(min_prune_threshold)
+{ }
+
+SongStore::ListenerId SongStore::addListener(Listener listener)
+{
+	assert(m_listeners.size() < sizeof(unsigned long long)*8);
+	m_listeners.push_back(std::move(listener));
+	return m_listeners.size() - 1;
+}
+
+MPD::Song SongStore::share(const MPD::Song &s, ListenerId holder)
+{
+	if (s.empty() || !s.isFromDatabase() || s.isStream())
+		return s;
+	const unsigned long long holder_bit = 1ull << holder;
+	auto it = m_songs.find(s);
+	if (it != m_songs.end())
+	{
+		if (sameVersion(it->first, s))
+		{
+			it->second |= holder_bit;
+			return it->first;
+		}
+		// Keep holders of the outdated version, they need to be
+		// notified if it changes again.
+		auto holders = it->second;
+		m_songs.erase(it);
+		return m_songs.emplace(s.intern(), holders | holder_bit).first->first;
+	}
+	if (m_songs.size() >= m_prune_threshold)
+		prune();
+	return m_songs.emplace(s.intern(), holder_bit).first->first;
+}
+
+void SongStore::update(const std::vector<MPD::Song> &removed,
+                       const std::vector<MPD::Song> &added)
+{
+	std::vector<SongSet> updated(m_listeners.size());
+	SongSet modified(added.begin(), added.end());
+	for (const auto &s : removed)
+		if (modified.count(s) == 0)
+			m_songs.erase(s);
+	for (const auto &s : added)
+	{
+		// Songs that nobody holds can be skipped, they'll be stored when
+		// a screen fetches them.
+		auto it = m_songs.find(s);
+		if (it == m_songs.end())
+			continue;
+		auto holders = it->second;
+		m_songs.erase(it);
+		auto shared = m_songs.emplace(s.intern(), holders).first->first;
+		for (size_t i = 0; i < m_listeners.size(); ++i)
+			if (holders & (1ull << i))
+				updated[i].insert(shared);
+	}
+	for (size_t i = 0; i < m_listeners.size(); ++i)
+		if (!updated[i].empty())
+			m_listeners[i](updated[i]);
+}
+
+void SongStore::prune()
+{
+	for (auto it = m_songs.begin(); it != m_songs.end();)
+	{
+		// Song is not referenced outside of the store.
+		if (it->first.useCount() == 1)
+			it = m_songs.erase(it);
+		else
+			++it;
+	}
+	m_prune_threshold = std::max(min_prune_threshold, 2*m_songs.size());
+}
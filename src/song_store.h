@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_SONG_STORE_H
+#define NCMPCPP_SONG_STORE_H
+
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "song.h"
+
+/// Database songs held by screens, stored once per URI. Songs that different
+/// screens fetch from the server are replaced with handles to the same
+/// stored copy. When the database changes, new versions of modified songs
+/// are pushed to the screens that hold them. Not thread safe.
+struct SongStore
+{
+	typedef std::unordered_set<MPD::Song, MPD::Song::Hash> SongSet;
+	typedef std::function<void(const SongSet &)> Listener;
+	typedef size_t ListenerId;
+
+	SongStore();
+
+	/// Register a screen to be notified about new versions of songs it got
+	/// from the store. At most 64 listeners are supported.
+	ListenerId addListener(Listener listener);
+
+	/// @return handle to the stored version of a song. If there is no stored
+	/// song with the same URI or it's outdated, the song is stored in its
+	/// place. Songs from outside of the database are returned as they are.
+	MPD::Song share(const MPD::Song &s, ListenerId holder);
+
+	template <typename Iterator>
+	void shareAll(Iterator first, Iterator last, ListenerId holder)
+	{
+		for (; first != last; ++first)
+			*first = share(*first, holder);
+	}
+
+	/// Store new versions of modified songs, forget removed ones and notify
+	/// listeners holding them. Modified songs are both in removed (old
+	/// version) and added (new version).
+	void update(const std::vector<MPD::Song> &removed,
+	            const std::vector<MPD::Song> &added);
+
+	size_t size() const { return m_songs.size(); }
+
+private:
+	void prune();
+
+	std::vector<Listener> m_listeners;
+	// Stored songs along with bit masks of listeners that hold them.
+	std::unordered_map<MPD::Song, unsigned long long, MPD::Song::Hash> m_songs;
+	size_t m_prune_threshold;
+};
+
+extern SongStore SharedSongs;
+
+#endif // NCMPCPP_SONG_STORE_H
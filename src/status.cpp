@@ -25,9 +25,12 @@
 #include "curses/menu_impl.h"
 #include "screens/browser.h"
 #include "charset.h"
+#include "database_cache.h"
+#include "playlist_index.h"
 #include "format_impl.h"
 #include "global.h"
 #include "helpers.h"
+#include "mpdpp_async.h"
 #include "screens/lyrics.h"
 #include "screens/media_library.h"
 #include "screens/outputs.h"
@@ -39,6 +42,7 @@
 #include "status.h"
 #include "statusbar.h"
 #include "screens/tag_editor.h"
+#include "tag_writer.h"
 #include "screens/visualizer.h"
 #include "title.h"
 #include "utility/string.h"
@@ -135,6 +139,55 @@ std::string playerStateToString(MPD::PlayerState ps)
 	return result;
 }
 
+// Queues growing by more songs than that are loaded in pages.
+const size_t queue_page_threshold = 5000;
+
+bool pagedQueueLoading()
+{
+#	if LIBMPDCLIENT_CHECK_VERSION(2, 12, 0)
+	return Mpd.Version() >= 20;
+#	else
+	return false;
+#	endif // LIBMPDCLIENT_CHECK_VERSION
+}
+
+void applyPlaylistChanges(MPD::SongIterator s)
+{
+	for (MPD::SongIterator end; s != end; ++s)
+		myPlaylist->setSong(std::move(*s));
+}
+
+void databaseFetched()
+{
+	if (Database.completeFetch() && isVisible(myLibrary))
+	{
+		myLibrary->update();
+		myLibrary->refresh();
+	}
+}
+
+void refetchDatabase()
+{
+	Database.prefetch(Mpd, databaseFetched);
+	myLibrary->requestTagsUpdate();
+	myLibrary->requestAlbumsUpdate();
+	myLibrary->requestSongsUpdate();
+}
+
+void databaseSynchronized()
+{
+	DatabaseCache::Diff diff;
+	if (Database.completeSynchronize(diff))
+	{
+		SharedSongs.update(diff.removed, diff.added);
+		myLibrary->applyDatabaseDiff(diff);
+		if (isVisible(myLibrary))
+			myLibrary->refresh();
+	}
+	else if (Database.invalidated())
+		refetchDatabase();
+}
+
 void initialize_status()
 {
 	// get full info about new connection
@@ -145,6 +198,7 @@ void initialize_status()
 		int curr_pos = Status::State::currentSongPosition();
 		if  (curr_pos >= 0)
 		{
+			myPlaylist->loadUpTo(curr_pos);
 			myPlaylist->main().highlight(curr_pos);
 			if (isVisible(myPlaylist))
 				myPlaylist->refresh();
@@ -167,8 +221,20 @@ void initialize_status()
 	myVisualizer->FindOutputID();
 #	endif // ENABLE_VISUALIZER
 
+	// Heavy queries go through the additional connection.
+	AsyncMpd.configure(Mpd);
+	Database.prefetch(Mpd, databaseFetched);
+
 	m_status_initialized = true;
 	wFooter->addFDCallback(Mpd.GetFD(), Statusbar::Helpers::mpd);
+	wFooter->addFDCallback(AsyncMpd.GetNotificationFD(), Statusbar::Helpers::asyncMpd);
+#	ifdef HAVE_TAGLIB_H
+	wFooter->addFDCallback(TagWriter.GetNotificationFD(), Statusbar::Helpers::tagWriter);
+#	endif // HAVE_TAGLIB_H
+#	ifdef HAVE_SYS_INOTIFY_H
+	if (myBrowser->watcherFD() >= 0)
+		wFooter->addFDCallback(myBrowser->watcherFD(), Statusbar::Helpers::directoryWatcher);
+#	endif // HAVE_SYS_INOTIFY_H
 	if (Config.connected_message_on_startup)
 	{
 		Statusbar::printf("Connected to %1%", Mpd.GetHostname());
@@ -196,6 +262,7 @@ void Status::handleServerError(MPD::ServerError &e)
 		Mpd.SetPassword(wFooter->prompt("", -1, true));
 		try {
 			Mpd.SendPassword();
+			AsyncMpd.configure(Mpd);
 			Statusbar::print("Password accepted");
 		} catch (MPD::ServerError &e_prim) {
 			handleServerError(e_prim);
@@ -256,7 +323,7 @@ void Status::update(int event)
 		Changes::storedPlaylists();
 	if (event & MPD_IDLE_PLAYLIST)
 	{
-		Changes::playlist(m_playlist_version);
+		Changes::playlist(m_playlist_version, st.playlistVersion());
 		m_playlist_version = st.playlistVersion();
 	}
 	if (event & MPD_IDLE_PLAYER)
@@ -343,6 +410,12 @@ void Status::clear()
 	m_playlist_version = 0;
 	m_total_time = 0;
 	m_volume = -1;
+
+	// we might reconnect to a different server or the database
+	// could've been updated in the meantime, so recheck the cache
+	Database.invalidate();
+	StoredPlaylists.invalidate();
+	myPlaylist->stopLoading();
 }
 
 /*************************************************************************/
@@ -409,35 +482,53 @@ int Status::State::volume()
 
 /*************************************************************************/
 
-void Status::Changes::playlist(unsigned previous_version)
+void Status::Changes::playlist(unsigned previous_version, unsigned version)
 {
 	{
 		ScopedUnfilteredMenu<MPD::Song> sunfilter(ReapplyFilter::Yes, myPlaylist->main());
 
-		if (m_playlist_length < myPlaylist->main().size())
+		// If the whole queue is about to be replaced, it's faster to index
+		// its songs once at the end than to track them one by one.
+		if (previous_version == 0)
+			myPlaylist->startBulkUpdate();
+
+		// Big queues are loaded in pages. Only songs that are already in the
+		// list are updated here, the rest is fetched in the background.
+		size_t loaded = std::min(myPlaylist->main().size(), size_t(m_playlist_length));
+		bool paged = pagedQueueLoading()
+			&& (myPlaylist->isLoading() || m_playlist_length > loaded + queue_page_threshold);
+
+		// Songs usually only change their positions (e.g. in consume mode
+		// or after a move), so there is no need to fetch them again unless
+		// the whole queue is new.
+		bool updated = false;
+		if (previous_version != 0 && !myPlaylist->main().empty())
 		{
-			auto it = myPlaylist->main().begin()+m_playlist_length;
-			auto end = myPlaylist->main().end();
-			for (; it != end; ++it)
-				myPlaylist->unregisterSong(it->value());
-			myPlaylist->main().resizeList(m_playlist_length);
+			std::vector<std::pair<unsigned, unsigned>> changes;
+			if (!paged)
+				std::copy(Mpd.GetPlaylistChangesPosId(previous_version),
+				          MPD::PositionIdIterator(), std::back_inserter(changes));
+			else if (loaded > 0)
+				std::copy(Mpd.GetPlaylistChangesPosId(previous_version, 0, loaded),
+				          MPD::PositionIdIterator(), std::back_inserter(changes));
+			// MPD bumps the version once per queue modification, which either
+			// moves songs around or modifies them in place, never both. With
+			// more modifications in between, moved songs need to be fetched.
+			bool only_moved = version == previous_version + 1;
+			updated = myPlaylist->applyPositionChanges(changes, m_playlist_length, only_moved);
 		}
-
-		MPD::SongIterator s = Mpd.GetPlaylistChanges(previous_version), end;
-		for (; s != end; ++s)
+		if (!updated)
 		{
-			size_t pos = s->getPosition();
-			myPlaylist->registerSong(*s);
-			if (pos < myPlaylist->main().size())
-			{
-				// if song's already in playlist, replace it with a new one
-				MPD::Song &old_s = myPlaylist->main()[pos].value();
-				myPlaylist->unregisterSong(old_s);
-				old_s = std::move(*s);
-			}
-			else // otherwise just add it to playlist
-				myPlaylist->main().addItem(std::move(*s));
+			myPlaylist->truncate(m_playlist_length);
+			if (!paged)
+				applyPlaylistChanges(Mpd.GetPlaylistChanges(previous_version));
+			else if (loaded > 0)
+				applyPlaylistChanges(Mpd.GetPlaylistChanges(previous_version, 0, loaded));
 		}
+		if (paged)
+			myPlaylist->loadRemaining(m_playlist_length);
+
+		myPlaylist->finishBulkUpdate();
 	}
 
 	myPlaylist->reloadTotalLength();
@@ -457,6 +548,7 @@ void Status::Changes::playlist(unsigned previous_version)
 
 void Status::Changes::storedPlaylists()
 {
+	StoredPlaylists.invalidate();
 	myPlaylistEditor->requestPlaylistsUpdate();
 	myPlaylistEditor->requestContentUpdate();
 	if (!myBrowser->isLocal() && myBrowser->inRootDirectory())
@@ -469,9 +561,8 @@ void Status::Changes::database()
 #	ifdef HAVE_TAGLIB_H
 	myTagEditor->Dirs->clear();
 #	endif // HAVE_TAGLIB_H
-	myLibrary->requestTagsUpdate();
-	myLibrary->requestAlbumsUpdate();
-	myLibrary->requestSongsUpdate();
+	if (!Database.synchronize(Mpd, databaseSynchronized))
+		refetchDatabase();
 }
 
 void Status::Changes::playerState()
@@ -56,7 +56,7 @@ int volume();
 
 namespace Changes {
 
-void playlist(unsigned previous_version);
+void playlist(unsigned previous_version, unsigned version);
 void storedPlaylists();
 void database();
 void playerState();
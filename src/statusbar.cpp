@@ -19,11 +19,14 @@
  ***************************************************************************/
 
 #include "global.h"
+#include "mpdpp_async.h"
 #include "settings.h"
 #include "status.h"
 #include "statusbar.h"
 #include "bindings.h"
+#include "screens/browser.h"
 #include "screens/playlist.h"
+#include "tag_writer.h"
 #include "utility/wide_string.h"
 
 using Global::wFooter;
@@ -192,6 +195,25 @@ void Statusbar::Helpers::mpd()
 	Status::update(Mpd.noidle());
 }
 
+void Statusbar::Helpers::asyncMpd()
+{
+	AsyncMpd.processCompletions();
+}
+
+#ifdef HAVE_TAGLIB_H
+void Statusbar::Helpers::tagWriter()
+{
+	TagWriter.processNotifications();
+}
+#endif // HAVE_TAGLIB_H
+
+#ifdef HAVE_SYS_INOTIFY_H
+void Statusbar::Helpers::directoryWatcher()
+{
+	myBrowser->applyFilesystemChanges();
+}
+#endif // HAVE_SYS_INOTIFY_H
+
 bool Statusbar::Helpers::mainHook(const char *)
 {
 	Status::trace();
@@ -66,6 +66,19 @@ namespace Helpers {
 /// called when statusbar window detects incoming idle notification
 void mpd();
 
+/// called when a request sent through the additional connection is done
+void asyncMpd();
+
+#ifdef HAVE_TAGLIB_H
+/// called when tags of another file were written in the background
+void tagWriter();
+#endif // HAVE_TAGLIB_H
+
+#ifdef HAVE_SYS_INOTIFY_H
+/// called when the directory browsed in the local browser changes
+void directoryWatcher();
+#endif // HAVE_SYS_INOTIFY_H
+
 /// called each time user types another character while inside Window::getString
 bool mainHook(const char *);
 
@@ -0,0 +1,176 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include "tag_cache.h"
+
+#ifdef HAVE_TAGLIB_H
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "utility/binary_io.h"
+
+TagReadCache TagCache;
+
+namespace {
+
+const char cache_magic[] = "ncmpcpp-tags";
+const uint32_t cache_version = 1;
+
+// Above that, entries of files that weren't seen in the current session
+// (most likely deleted or moved) are dropped when the cache is saved.
+const size_t max_unused_entries = 100000;
+
+}
+
+TagReadCache::TagReadCache()
+: m_modified(false)
+{ }
+
+void TagReadCache::load(std::string path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_path = std::move(path);
+	m_modified = false;
+	if (!read())
+		m_entries.clear();
+}
+
+void TagReadCache::save()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_modified)
+		return;
+	if (m_entries.size() > max_unused_entries)
+	{
+		for (auto it = m_entries.begin(); it != m_entries.end();)
+		{
+			if (it->second.used)
+				++it;
+			else
+				it = m_entries.erase(it);
+		}
+	}
+	write();
+	m_modified = false;
+}
+
+bool TagReadCache::get(const std::string &path, uint64_t size, time_t mtime, Tags::Attributes &tags)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(path);
+	if (it == m_entries.end()
+	||  it->second.size != size
+	||  it->second.mtime != mtime)
+		return false;
+	it->second.used = true;
+	tags = it->second.tags;
+	return true;
+}
+
+void TagReadCache::put(const std::string &path, uint64_t size, time_t mtime, Tags::Attributes tags)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries[path] = Entry{size, mtime, std::move(tags), true};
+	m_modified = true;
+}
+
+/**********************************************************************/
+
+bool TagReadCache::read()
+{
+	std::ifstream f(m_path, std::ios::binary);
+	if (!f.is_open())
+		return false;
+
+	std::string magic;
+	uint32_t version;
+	if (!readString(f, magic) || magic != cache_magic
+	||  !readInt(f, version) || version != cache_version)
+		return false;
+
+	uint64_t entry_count;
+	if (!readInt(f, entry_count))
+		return false;
+	m_entries.clear();
+	// Path length, size, mtime and tag count.
+	const uint64_t min_entry_size = 4 + 8 + 8 + 4;
+	m_entries.reserve(std::min(entry_count, remainingSize(f) / min_entry_size));
+	std::string path, name, value;
+	for (uint64_t i = 0; i < entry_count; ++i)
+	{
+		Entry entry;
+		uint32_t tag_count;
+		if (!readString(f, path)
+		||  !readInt(f, entry.size)
+		||  !readInt(f, entry.mtime)
+		||  !readInt(f, tag_count))
+			return false;
+		for (uint32_t j = 0; j < tag_count; ++j)
+		{
+			if (!readString(f, name) || !readString(f, value))
+				return false;
+			entry.tags.emplace_back(name, value);
+		}
+		entry.used = false;
+		m_entries.emplace(path, std::move(entry));
+	}
+	return true;
+}
+
+void TagReadCache::write()
+{
+	if (m_path.empty())
+		return;
+
+	std::string tmp_path = m_path + ".tmp";
+	std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+	if (!f.is_open())
+	{
+		std::cerr << "Couldn't open " << tmp_path << " for writing\n";
+		return;
+	}
+
+	writeString(f, cache_magic);
+	writeInt(f, cache_version);
+	writeInt(f, uint64_t(m_entries.size()));
+	for (const auto &entry : m_entries)
+	{
+		writeString(f, entry.first.c_str());
+		writeInt(f, entry.second.size);
+		writeInt(f, entry.second.mtime);
+		writeInt(f, uint32_t(entry.second.tags.size()));
+		for (const auto &tag : entry.second.tags)
+		{
+			writeString(f, tag.first.c_str());
+			writeString(f, tag.second.c_str());
+		}
+	}
+
+	f.close();
+	if (!f || std::rename(tmp_path.c_str(), m_path.c_str()) != 0)
+	{
+		std::cerr << "Couldn't write tag cache to " << m_path << "\n";
+		std::remove(tmp_path.c_str());
+	}
+}
+
+#endif // HAVE_TAGLIB_H
@@ -0,0 +1,79 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_TAG_CACHE_H
+#define NCMPCPP_TAG_CACHE_H
+
+#include "config.h"
+
+#ifdef HAVE_TAGLIB_H
+
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "tags.h"
+
+/// Tags read from local files, kept on disk between sessions. An entry is
+/// valid as long as size and modification time of its file don't change,
+/// so that browsing the local filesystem opens only files that are new or
+/// were modified. Safe to use from multiple threads.
+struct TagReadCache
+{
+	TagReadCache();
+
+	/// Read the cache from a given file.
+	void load(std::string path);
+
+	/// Write the cache back if it was modified.
+	void save();
+
+	/// Get tags of a file if they're cached for its current size and
+	/// modification time.
+	bool get(const std::string &path, uint64_t size, time_t mtime, Tags::Attributes &tags);
+
+	void put(const std::string &path, uint64_t size, time_t mtime, Tags::Attributes tags);
+
+private:
+	struct Entry
+	{
+		uint64_t size;
+		int64_t mtime;
+		Tags::Attributes tags;
+		bool used;
+	};
+
+	bool read();
+	void write();
+
+	std::string m_path;
+	bool m_modified;
+
+	std::mutex m_mutex;
+	std::unordered_map<std::string, Entry> m_entries;
+};
+
+extern TagReadCache TagCache;
+
+#endif // HAVE_TAGLIB_H
+
+#endif // NCMPCPP_TAG_CACHE_H
@@ -0,0 +1,254 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include "tag_writer.h"
+
+#ifdef HAVE_TAGLIB_H
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "gcc.h"
+#include "global.h"
+#include "helpers.h"
+#include "settings.h"
+#include "statusbar.h"
+#include "tags.h"
+
+TagWritePipeline TagWriter;
+
+namespace {
+
+// More threads per filesystem don't make writes faster, they just make the
+// disk seek back and forth (or flood the file server with requests).
+const size_t writers_per_filesystem = 4;
+
+std::string songDirectory(const MPD::MutableSong &s)
+{
+	std::string result;
+	if (s.isFromDatabase())
+		result += Config.mpd_music_dir;
+	result += s.getDirectory();
+	return result;
+}
+
+}
+
+TagWritePipeline::TagWritePipeline()
+: m_done(0), m_cancelled(false), m_finished(false)
+{
+	if (pipe(m_notification_pipe) != 0)
+		throw std::runtime_error("couldn't create notification pipe");
+	for (int fd : m_notification_pipe)
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+TagWritePipeline::~TagWritePipeline()
+{
+	cancel();
+	wait();
+	close(m_notification_pipe[0]);
+	close(m_notification_pipe[1]);
+}
+
+void TagWritePipeline::start(std::vector<MPD::MutableSong> songs, Completion completion)
+{
+	assert(!busy());
+	m_songs = std::move(songs);
+	m_completion = std::move(completion);
+	m_done = 0;
+	m_cancelled = false;
+	m_finished = false;
+	m_written.clear();
+	m_failures.clear();
+	m_thread = std::thread(&TagWritePipeline::run, this);
+	Statusbar::printf("Writing tags of %1% files...", m_songs.size());
+}
+
+void TagWritePipeline::promptCancel()
+{
+	if (!busy())
+		return;
+	char answer;
+	{
+		Statusbar::ScopedLock slock;
+		Statusbar::put() << "Tags are being written (" << m_done.load() << "/" << m_songs.size() << "), cancel? "
+		                 << "[" << NC::Format::Bold << 'y' << NC::Format::NoBold << '/'
+		                 << NC::Format::Bold << 'n' << NC::Format::NoBold << "]";
+		answer = Statusbar::Helpers::promptReturnOneOf({'y', 'n'});
+	}
+	if (answer == 'y')
+	{
+		cancel();
+		Statusbar::print("Cancelling...");
+	}
+}
+
+void TagWritePipeline::wait()
+{
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void TagWritePipeline::processNotifications()
+{
+	char buf[64];
+	while (read(m_notification_pipe[0], buf, sizeof(buf)) > 0)
+		;
+	if (!busy())
+		return;
+	if (!m_finished)
+	{
+		if (!m_cancelled)
+			Statusbar::printf("Writing tags: %1%/%2%...", m_done.load(), m_songs.size());
+		return;
+	}
+	m_thread.join();
+
+	Report report;
+	report.total = m_songs.size();
+	report.written = m_written.size();
+	report.cancelled = m_done < report.total;
+	report.failures = std::move(m_failures);
+	for (const auto &failure : report.failures)
+		std::cerr << "Error while writing tags to \"" << failure.uri << "\": "
+		          << failure.error << "\n";
+
+	// Rescan the directory containing all written files once instead of
+	// sending an update request for each of them.
+	std::string dir_to_update;
+	for (size_t i : m_written)
+	{
+		if (dir_to_update.empty())
+			dir_to_update = m_songs[i].getURI();
+		else
+			dir_to_update = getSharedDirectory(dir_to_update, m_songs[i].getURI());
+	}
+	m_written.clear();
+	m_songs.clear();
+	auto completion = std::move(m_completion);
+	m_completion = nullptr;
+
+	if (report.written > 0)
+		Mpd.UpdateDirectory(dir_to_update);
+
+	if (!report.failures.empty())
+		Statusbar::printf("Couldn't write tags to %1% of %2% files (\"%3%\": %4%), see error.log",
+			report.failures.size(), report.total,
+			report.failures.front().uri, report.failures.front().error);
+	else if (report.cancelled)
+		Statusbar::printf("Writing tags cancelled, %1% of %2% files updated",
+			report.written, report.total);
+	else
+		Statusbar::print("Tags updated successfully");
+
+	if (completion)
+		completion(report);
+}
+
+/**********************************************************************/
+
+void TagWritePipeline::run()
+{
+	// Group songs by the filesystem they reside on. Directories are checked
+	// instead of files as there are much fewer of them.
+	std::map<dev_t, std::deque<size_t>> queues;
+	std::unordered_map<std::string, dev_t> devices;
+	for (size_t i = 0; i < m_songs.size(); ++i)
+	{
+		auto dir = songDirectory(m_songs[i]);
+		auto it = devices.find(dir);
+		if (it == devices.end())
+		{
+			struct stat st;
+			dev_t device = stat(dir.c_str(), &st) == 0 ? st.st_dev : 0;
+			it = devices.emplace(std::move(dir), device).first;
+		}
+		queues[it->second].push_back(i);
+	}
+
+	std::vector<std::thread> writers;
+	for (auto &queue : queues)
+	{
+		size_t threads = std::min(queue.second.size(), writers_per_filesystem);
+		for (size_t i = 0; i < threads; ++i)
+			writers.emplace_back(&TagWritePipeline::writeFrom, this, std::ref(queue.second));
+	}
+	for (auto &writer : writers)
+		writer.join();
+
+	m_finished = true;
+	notify();
+}
+
+void TagWritePipeline::writeFrom(std::deque<size_t> &queue)
+{
+	while (!m_cancelled)
+	{
+		size_t i;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (queue.empty())
+				break;
+			i = queue.front();
+			queue.pop_front();
+		}
+		std::string error;
+		try
+		{
+			errno = 0;
+			if (!Tags::write(m_songs[i]))
+				error = errno != 0
+				      ? std::generic_category().message(errno)
+				      : "couldn't open file";
+		}
+		catch (std::exception &e)
+		{
+			error = e.what();
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (error.empty())
+				m_written.push_back(i);
+			else
+				m_failures.push_back(Failure{m_songs[i].getURI(), std::move(error)});
+		}
+		++m_done;
+		notify();
+	}
+}
+
+void TagWritePipeline::notify()
+{
+	char c = 0;
+	// If the pipe is full, the main thread is already notified.
+	GNUC_UNUSED ssize_t res = write(m_notification_pipe[1], &c, 1);
+}
+
+#endif // HAVE_TAGLIB_H
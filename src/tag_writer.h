@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_TAG_WRITER_H
+#define NCMPCPP_TAG_WRITER_H
+
+#include "config.h"
+
+#ifdef HAVE_TAGLIB_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mutable_song.h"
+
+/// Writes tags of songs in the background so that the user interface stays
+/// responsive while large batches of files are retagged. Files are grouped by
+/// the filesystem they reside on and each filesystem is written to by a
+/// limited number of threads, so that slow (e.g. network) storage isn't
+/// overwhelmed. Errors don't stop the batch, they're collected and reported
+/// once it's done, at which point MPD is asked to rescan the directory
+/// containing all written files.
+struct TagWritePipeline
+{
+	struct Failure
+	{
+		std::string uri;
+		std::string error;
+	};
+
+	struct Report
+	{
+		size_t written;
+		size_t total;
+		bool cancelled;
+		std::vector<Failure> failures;
+	};
+
+	typedef std::function<void(const Report &)> Completion;
+
+	TagWritePipeline();
+	~TagWritePipeline();
+
+	/// @return descriptor that becomes readable when progress was made.
+	int GetNotificationFD() const { return m_notification_pipe[0]; }
+
+	/// @return true if a batch is being written.
+	bool busy() const { return m_thread.joinable(); }
+
+	/// Start writing tags of given songs. The completion handler is run on
+	/// the main thread once the batch is done. Must not be called when busy.
+	void start(std::vector<MPD::MutableSong> songs, Completion completion = nullptr);
+
+	/// Stop the batch once files that are being written are done.
+	void cancel() { m_cancelled = true; }
+
+	/// Ask the user whether the current batch should be cancelled.
+	void promptCancel();
+
+	/// Wait until all threads are done. Completion handler is not run.
+	void wait();
+
+	/// Show progress and finish the batch if it's done.
+	void processNotifications();
+
+private:
+	void run();
+	void writeFrom(std::deque<size_t> &queue);
+	void notify();
+
+	std::vector<MPD::MutableSong> m_songs;
+	Completion m_completion;
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::atomic<size_t> m_done;
+	std::atomic<bool> m_cancelled;
+	std::atomic<bool> m_finished;
+	std::vector<size_t> m_written;
+	std::vector<Failure> m_failures;
+
+	int m_notification_pipe[2];
+};
+
+extern TagWritePipeline TagWriter;
+
+#endif // HAVE_TAGLIB_H
+
+#endif // NCMPCPP_TAG_WRITER_H
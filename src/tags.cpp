@@ -51,35 +51,35 @@ TagLib::StringList tagList(const MPD::MutableSong &s, MPD::Song::GetFunction f)
 	return result;
 }
 
-void readCommonTags(mpd_song *s, TagLib::Tag *tag)
+void readCommonTags(Tags::Attributes &attrs, TagLib::Tag *tag)
 {
-	Tags::setAttribute(s, "Title", tag->title().to8Bit(true));
-	Tags::setAttribute(s, "Artist", tag->artist().to8Bit(true));
-	Tags::setAttribute(s, "Album", tag->album().to8Bit(true));
-	Tags::setAttribute(s, "Date", boost::lexical_cast<std::string>(tag->year()));
-	Tags::setAttribute(s, "Track", boost::lexical_cast<std::string>(tag->track()));
-	Tags::setAttribute(s, "Genre", tag->genre().to8Bit(true));
-	Tags::setAttribute(s, "Comment", tag->comment().to8Bit(true));
+	attrs.emplace_back("Title", tag->title().to8Bit(true));
+	attrs.emplace_back("Artist", tag->artist().to8Bit(true));
+	attrs.emplace_back("Album", tag->album().to8Bit(true));
+	attrs.emplace_back("Date", boost::lexical_cast<std::string>(tag->year()));
+	attrs.emplace_back("Track", boost::lexical_cast<std::string>(tag->track()));
+	attrs.emplace_back("Genre", tag->genre().to8Bit(true));
+	attrs.emplace_back("Comment", tag->comment().to8Bit(true));
 }
 
-void readID3v1Tags(mpd_song *s, TagLib::ID3v1::Tag *tag)
+void readID3v1Tags(Tags::Attributes &attrs, TagLib::ID3v1::Tag *tag)
 {
-	readCommonTags(s, tag);
+	readCommonTags(attrs, tag);
 }
 
-void readID3v2Tags(mpd_song *s, TagLib::ID3v2::Tag *tag)
+void readID3v2Tags(Tags::Attributes &attrs, TagLib::ID3v2::Tag *tag)
 {
-	auto readFrame = [s](const TagLib::ID3v2::FrameList &fields, const char *name) {
+	auto readFrame = [&attrs](const TagLib::ID3v2::FrameList &fields, const char *name) {
 		for (const auto &field : fields)
 		{
 			if (auto textFrame = dynamic_cast<TagLib::ID3v2::TextIdentificationFrame *>(field))
 			{
 				auto values = textFrame->fieldList();
 				for (const auto &value : values)
-					Tags::setAttribute(s, name, value.to8Bit(true));
+					attrs.emplace_back(name, value.to8Bit(true));
 			}
 			else
-				Tags::setAttribute(s, name, field->toString().to8Bit(true));
+				attrs.emplace_back(name, field->toString().to8Bit(true));
 		}
 	};
 	auto &frames = tag->frameListMap();
@@ -96,11 +96,11 @@ void readID3v2Tags(mpd_song *s, TagLib::ID3v2::Tag *tag)
 	readFrame(frames["COMM"], "Comment");
 }
 
-void readXiphComments(mpd_song *s, TagLib::Ogg::XiphComment *tag)
+void readXiphComments(Tags::Attributes &attrs, TagLib::Ogg::XiphComment *tag)
 {
-	auto readField = [s](const TagLib::StringList &fields, const char *name) {
+	auto readField = [&attrs](const TagLib::StringList &fields, const char *name) {
 		for (const auto &field : fields)
-			Tags::setAttribute(s, name, field.to8Bit(true));
+			attrs.emplace_back(name, field.to8Bit(true));
 	};
 	auto &fields = tag->fieldListMap();
 	readField(fields["TITLE"], "Title");
@@ -248,34 +248,36 @@ ReplayGainInfo readReplayGain(TagLib::File *f)
 	return result;
 }
 
-void read(mpd_song *s)
+Attributes read(const std::string &path)
 {
-	TagLib::FileRef f(mpd_song_get_uri(s));
+	Attributes result;
+	TagLib::FileRef f(path.c_str());
 	if (f.isNull())
-		return;
+		return result;
 	
-	setAttribute(s, "Time", boost::lexical_cast<std::string>(f.audioProperties()->length()));
+	result.emplace_back("Time", boost::lexical_cast<std::string>(f.audioProperties()->length()));
 	
 	if (auto mpeg_file = dynamic_cast<TagLib::MPEG::File *>(f.file()))
 	{
 		// prefer id3v2 only if available
 		if (auto id3v2 = mpeg_file->ID3v2Tag())
-			readID3v2Tags(s, id3v2);
+			readID3v2Tags(result, id3v2);
 		else if (auto id3v1 = mpeg_file->ID3v1Tag())
-			readID3v1Tags(s, id3v1);
+			readID3v1Tags(result, id3v1);
 	}
 	else if (auto ogg_file = dynamic_cast<TagLib::Ogg::Vorbis::File *>(f.file()))
 	{
 		if (auto xiph = ogg_file->tag())
-			readXiphComments(s, xiph);
+			readXiphComments(result, xiph);
 	}
 	else if (auto flac_file = dynamic_cast<TagLib::FLAC::File *>(f.file()))
 	{
 		if (auto xiph = flac_file->xiphComment())
-			readXiphComments(s, xiph);
+			readXiphComments(result, xiph);
 	}
 	else
-		readCommonTags(s, f.tag());
+		readCommonTags(result, f.tag());
+	return result;
 }
 
 bool write(MPD::MutableSong &s)
@@ -25,7 +25,10 @@
 
 #ifdef HAVE_TAGLIB_H
 
+#include <string>
 #include <tfile.h>
+#include <utility>
+#include <vector>
 #include "mutable_song.h"
 
 namespace Tags {
@@ -68,7 +71,11 @@ ReplayGainInfo readReplayGain(TagLib::File *f);
 
 bool extendedSetSupported(const TagLib::File *f);
 
-void read(mpd_song *s);
+/// Tags of a file as attribute name and value pairs that can be fed to
+/// mpd_song. Empty if the file couldn't be read.
+typedef std::vector<std::pair<std::string, std::string>> Attributes;
+
+Attributes read(const std::string &path);
 bool write(MPD::MutableSong &);
 
 }
@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "trigram_index.h"
+
+namespace {
+
+// Tags searched by the search engine, file name is handled separately.
+const std::array<mpd_tag_type, 9> IndexedTags = {{
+	MPD_TAG_ARTIST,
+	MPD_TAG_ALBUM_ARTIST,
+	MPD_TAG_TITLE,
+	MPD_TAG_ALBUM,
+	MPD_TAG_COMPOSER,
+	MPD_TAG_PERFORMER,
+	MPD_TAG_GENRE,
+	MPD_TAG_DATE,
+	MPD_TAG_COMMENT
+}};
+
+char foldCase(char c)
+{
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+// Call f with each trigram of s. Trigrams containing non-ASCII characters are
+// skipped as case insensitive matching and stripping of diacritics may make
+// them match different byte sequences.
+template <typename F>
+void forEachTrigram(const char *s, F f)
+{
+	uint32_t trigram = 0;
+	size_t length = 0;
+	for (; *s != '\0'; ++s)
+	{
+		unsigned char c = *s;
+		if (c >= 0x80)
+		{
+			length = 0;
+			continue;
+		}
+		trigram = ((trigram << 8) | uint8_t(foldCase(c))) & 0xffffff;
+		if (++length >= 3)
+			f(trigram);
+	}
+}
+
+}
+
+TrigramIndex::TrigramIndex(const std::vector<MPD::Song> &songs)
+{
+	for (uint32_t i = 0; i < songs.size(); ++i)
+	{
+		auto add = [this, i](uint32_t trigram) {
+			auto &list = m_songs[trigram];
+			if (list.empty() || list.back() != i)
+				list.push_back(i);
+		};
+		const auto &s = songs[i];
+		for (auto tag : IndexedTags)
+		{
+			const char *value;
+			for (unsigned idx = 0; (value = s.c_tag(tag, idx)) != nullptr; ++idx)
+				forEachTrigram(value, add);
+		}
+		forEachTrigram(s.getName().c_str(), add);
+	}
+	for (auto &list : m_songs)
+		list.second.shrink_to_fit();
+}
+
+boost::optional<std::vector<uint32_t>> TrigramIndex::candidates(
+	const std::vector<std::string> &literals) const
+{
+	static const std::vector<uint32_t> empty;
+
+	std::vector<const std::vector<uint32_t> *> lists;
+	for (const auto &literal : literals)
+	{
+		forEachTrigram(literal.c_str(), [this, &lists](uint32_t trigram) {
+			auto it = m_songs.find(trigram);
+			lists.push_back(it != m_songs.end() ? &it->second : &empty);
+		});
+	}
+	if (lists.empty())
+		return boost::none;
+
+	// Start with the shortest list so that intersections stay small.
+	std::sort(lists.begin(), lists.end(),
+	          [](const std::vector<uint32_t> *a, const std::vector<uint32_t> *b) {
+		          return a->size() < b->size();
+	          });
+	std::vector<uint32_t> result = *lists[0], next;
+	for (size_t i = 1; i < lists.size() && !result.empty(); ++i)
+	{
+		next.clear();
+		std::set_intersection(result.begin(), result.end(),
+		                      lists[i]->begin(), lists[i]->end(),
+		                      std::back_inserter(next));
+		result.swap(next);
+	}
+	return result;
+}
+
+std::vector<std::string> TrigramIndex::requiredLiterals(const std::string &rx)
+{
+	std::vector<std::string> result;
+	// Alternatives, groups, bracket expressions and escape sequences
+	// are not worth the trouble.
+	if (rx.find_first_of("|()[]\\") != std::string::npos)
+		return result;
+	std::string literal;
+	auto flush = [&result, &literal] {
+		if (!literal.empty())
+		{
+			result.push_back(std::move(literal));
+			literal.clear();
+		}
+	};
+	for (size_t i = 0; i < rx.size(); ++i)
+	{
+		char c = rx[i];
+		if (strchr("*?{", c) != nullptr)
+		{
+			// Preceding character is optional.
+			if (!literal.empty())
+				literal.pop_back();
+			flush();
+			if (c == '{')
+				i = std::min(rx.find('}', i), rx.size());
+		}
+		else if (strchr(".^$+}", c) != nullptr)
+			flush();
+		else
+			literal += c;
+	}
+	flush();
+	return result;
+}
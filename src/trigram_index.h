@@ -0,0 +1,56 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_TRIGRAM_INDEX_H
+#define NCMPCPP_TRIGRAM_INDEX_H
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "song.h"
+
+/// Maps trigrams (three consecutive ASCII characters, letters folded to lower
+/// case) found in searchable tags of a list of songs to songs containing them,
+/// so that songs which can't match a pattern can be skipped without looking
+/// at their tags.
+struct TrigramIndex
+{
+	TrigramIndex() { }
+	explicit TrigramIndex(const std::vector<MPD::Song> &songs);
+
+	/// @return indices (in ascending order) of songs containing all given
+	/// strings in some of their tags or none if the strings are too short
+	/// to narrow the search.
+	boost::optional<std::vector<uint32_t>> candidates(
+		const std::vector<std::string> &literals) const;
+
+	/// @return strings that have to be present in any string matching
+	/// a regular expression. Patterns that are not understood are treated
+	/// as if they didn't require anything.
+	static std::vector<std::string> requiredLiterals(const std::string &rx);
+
+private:
+	std::unordered_map<uint32_t, std::vector<uint32_t>> m_songs;
+};
+
+#endif // NCMPCPP_TRIGRAM_INDEX_H
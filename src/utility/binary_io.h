@@ -0,0 +1,83 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_BINARY_IO_H
+#define NCMPCPP_UTILITY_BINARY_IO_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+
+// Helpers for reading and writing cache files. Integers are stored in the
+// native byte order as the files are not meant to be shared between hosts.
+// Lengths and counts read from a file can't be trusted, so memory is
+// allocated only for data that is actually there.
+
+template <typename IntT>
+void writeInt(std::ostream &f, IntT value)
+{
+	f.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+inline void writeString(std::ostream &f, const char *s)
+{
+	uint32_t length = strlen(s);
+	writeInt(f, length);
+	f.write(s, length);
+}
+
+template <typename IntT>
+bool readInt(std::istream &f, IntT &value)
+{
+	return bool(f.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+inline bool readString(std::istream &f, std::string &s)
+{
+	const uint32_t chunk_size = 65536;
+	uint32_t length;
+	if (!readInt(f, length))
+		return false;
+	s.clear();
+	while (length > 0)
+	{
+		size_t offset = s.size(), n = std::min(length, chunk_size);
+		s.resize(offset + n);
+		if (!f.read(&s[offset], n))
+			return false;
+		length -= n;
+	}
+	return true;
+}
+
+/// @return number of bytes left in the file.
+inline uint64_t remainingSize(std::istream &f)
+{
+	auto pos = f.tellg();
+	f.seekg(0, std::ios::end);
+	auto end = f.tellg();
+	f.seekg(pos);
+	return pos != -1 && end != -1 ? uint64_t(end - pos) : 0;
+}
+
+#endif // NCMPCPP_UTILITY_BINARY_IO_H
@@ -25,9 +25,9 @@
 
 namespace {
 
-bool hasTheWord(const std::string &s)
+bool hasTheWord(const char *s, size_t length)
 {
-	return s.length() >= 4
+	return length >= 4
 	&&     (s[0] == 't' || s[0] == 'T')
 	&&     (s[1] == 'h' || s[1] == 'H')
 	&&     (s[2] == 'e' || s[2] == 'E')
@@ -41,9 +41,9 @@ int LocaleStringComparison::compare(const char *a, size_t a_len, const char *b,
 	size_t ac_off = 0, bc_off = 0;
 	if (m_ignore_the)
 	{
-		if (hasTheWord(a))
+		if (hasTheWord(a, a_len))
 			ac_off += 4;
-		if (hasTheWord(b))
+		if (hasTheWord(b, b_len))
 			bc_off += 4;
 	}
 	return std::use_facet<std::collate<char>>(m_locale).compare(
@@ -51,6 +51,24 @@ int LocaleStringComparison::compare(const char *a, size_t a_len, const char *b,
 	);
 }
 
+std::string LocaleStringComparison::sortKey(const char *s, size_t len) const
+{
+	if (m_ignore_the && hasTheWord(s, len))
+	{
+		s += 4;
+		len -= 4;
+	}
+	return std::use_facet<std::collate<char>>(m_locale).transform(s, s+len);
+}
+
+SortKey SortKeyCache::operator()(const std::string &s)
+{
+	auto it = m_keys.find(s);
+	if (it == m_keys.end())
+		it = m_keys.emplace(s, m_cmp.sortKey(s)).first;
+	return SortKey(it->second);
+}
+
 bool LocaleBasedItemSorting::operator()(const MPD::Item &a, const MPD::Item &b) const
 {
 	bool result = false;
@@ -21,7 +21,13 @@
 #ifndef NCMPCPP_UTILITY_COMPARATORS_H
 #define NCMPCPP_UTILITY_COMPARATORS_H
 
+#include <algorithm>
+#include <iterator>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 #include "runnable_item.h"
 #include "mpdpp.h"
 #include "settings.h"
@@ -44,6 +50,45 @@ public:
 	}
 
 	int compare(const char *a, size_t a_len, const char *b, size_t b_len) const;
+
+	/// @return key such that comparing keys of two strings bytewise gives
+	/// the same result as comparing the strings themselves.
+	std::string sortKey(const char *s, size_t len) const;
+	std::string sortKey(const std::string &s) const {
+		return sortKey(s.c_str(), s.length());
+	}
+};
+
+/// Reference to a sort key obtained from SortKeyCache.
+class SortKey
+{
+	const std::string *m_key;
+
+public:
+	explicit SortKey(const std::string &key) : m_key(&key) { }
+
+	bool operator<(const SortKey &rhs) const {
+		return m_key != rhs.m_key && *m_key < *rhs.m_key;
+	}
+	bool operator==(const SortKey &rhs) const {
+		return m_key == rhs.m_key || *m_key == *rhs.m_key;
+	}
+	bool operator!=(const SortKey &rhs) const {
+		return !(*this == rhs);
+	}
+};
+
+/// Computes sort keys of strings, each distinct one only once.
+/// Keys are valid as long as the cache is.
+class SortKeyCache
+{
+	LocaleStringComparison m_cmp;
+	std::unordered_map<std::string, std::string> m_keys;
+
+public:
+	SortKeyCache(const std::locale &loc, bool ignore_the) : m_cmp(loc, ignore_the) { }
+
+	SortKey operator()(const std::string &s);
 };
 
 class LocaleBasedSorting
@@ -76,6 +121,37 @@ public:
 	}
 };
 
+/// Keys giving the same order as LocaleBasedSorting, to be used with sortByKey.
+class LocaleBasedSortKeys
+{
+	SortKeyCache m_keys;
+
+public:
+	LocaleBasedSortKeys(const std::locale &loc, bool ignore_the) : m_keys(loc, ignore_the) { }
+
+	SortKey operator()(const std::string &s) {
+		return m_keys(s);
+	}
+
+	SortKey operator()(const MPD::Playlist &p) {
+		return m_keys(p.path());
+	}
+
+	SortKey operator()(const MPD::Song &s) {
+		return m_keys(s.getName());
+	}
+
+	template <typename A, typename B>
+	SortKey operator()(const std::pair<A, B> &p) {
+		return (*this)(p.first);
+	}
+
+	template <typename ItemT, typename FunT>
+	SortKey operator()(const RunnableItem<ItemT, FunT> &item) {
+		return (*this)(item.item());
+	}
+};
+
 class LocaleBasedItemSorting
 {
 	LocaleBasedSorting m_cmp;
@@ -94,4 +170,56 @@ public:
 	}
 };
 
+/// Sort a range using std::sort, splitting it between multiple threads if
+/// it's big enough. Elements are compared with operator<.
+template <typename IteratorT>
+void parallelSort(IteratorT first, IteratorT last)
+{
+	const size_t min_chunk_size = 50000;
+	size_t size = std::distance(first, last);
+	size_t chunks = std::min<size_t>(std::thread::hardware_concurrency(),
+	                                 size / min_chunk_size);
+	if (chunks < 2)
+	{
+		std::sort(first, last);
+		return;
+	}
+	std::vector<IteratorT> bounds;
+	for (size_t i = 0; i <= chunks; ++i)
+		bounds.push_back(first + size*i/chunks);
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < chunks; ++i)
+		workers.emplace_back([&bounds, i] { std::sort(bounds[i], bounds[i+1]); });
+	std::sort(bounds[0], bounds[1]);
+	for (auto &worker : workers)
+		worker.join();
+	for (size_t step = 1; step < chunks; step *= 2)
+		for (size_t i = 0; i + step < chunks; i += 2*step)
+			std::inplace_merge(bounds[i], bounds[i+step],
+			                   bounds[std::min(i+2*step, chunks)]);
+}
+
+/// Sort a range by keys computed once per element instead of comparing
+/// the elements themselves. Elements with equal keys keep their order.
+template <typename IteratorT, typename KeyFunction>
+void sortByKey(IteratorT first, IteratorT last, KeyFunction key)
+{
+	typedef typename std::iterator_traits<IteratorT>::value_type ValueT;
+	typedef typename std::decay<decltype(key(*first))>::type KeyT;
+
+	size_t size = std::distance(first, last);
+	std::vector<std::pair<KeyT, size_t>> keys;
+	keys.reserve(size);
+	size_t idx = 0;
+	for (auto it = first; it != last; ++it, ++idx)
+		keys.emplace_back(key(*it), idx);
+	parallelSort(keys.begin(), keys.end());
+
+	std::vector<ValueT> values;
+	values.reserve(size);
+	for (const auto &k : keys)
+		values.push_back(std::move(*(first + k.second)));
+	std::move(values.begin(), values.end(), first);
+}
+
 #endif // NCMPCPP_UTILITY_COMPARATORS_H
@@ -0,0 +1,95 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_FENWICK_TREE_H
+#define NCMPCPP_UTILITY_FENWICK_TREE_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+/// Sequence of numbers that supports changing an element and computing
+/// sum of its prefix in O(log n) (also known as binary indexed tree).
+template <typename ValueT>
+struct FenwickTree
+{
+	size_t size() const { return m_values.size(); }
+	ValueT operator[](size_t i) const { return m_values[i]; }
+
+	void clear()
+	{
+		m_values.clear();
+		m_tree.clear();
+	}
+
+	/// Append a value in O(log n).
+	void push_back(ValueT value)
+	{
+		// Node i (counting from 1) holds the sum of (i - lowbit(i), i].
+		size_t i = m_values.size() + 1;
+		ValueT sum = value;
+		for (size_t j = i - 1, low = i - lowbit(i); j > low; j -= lowbit(j))
+			sum += m_tree[j-1];
+		m_values.push_back(value);
+		m_tree.push_back(sum);
+	}
+
+	/// Remove values past a given size. Nodes of the remaining
+	/// values don't depend on them, so this is O(1).
+	void truncate(size_t size)
+	{
+		if (size < m_values.size())
+		{
+			m_values.resize(size);
+			m_tree.resize(size);
+		}
+	}
+
+	/// Change value at a given position in O(log n).
+	void set(size_t i, ValueT value)
+	{
+		assert(i < m_values.size());
+		// Works for unsigned types too as the arithmetic wraps around.
+		ValueT delta = value - m_values[i];
+		m_values[i] = value;
+		for (size_t j = i + 1; j <= m_tree.size(); j += lowbit(j))
+			m_tree[j-1] += delta;
+	}
+
+	/// @return sum of the first n values.
+	ValueT prefix(size_t n) const
+	{
+		assert(n <= m_values.size());
+		ValueT result = 0;
+		for (size_t j = n; j > 0; j -= lowbit(j))
+			result += m_tree[j-1];
+		return result;
+	}
+
+	ValueT total() const { return prefix(m_values.size()); }
+
+private:
+	static size_t lowbit(size_t i) { return i & (~i + 1); }
+
+	std::vector<ValueT> m_values;
+	std::vector<ValueT> m_tree;
+};
+
+#endif // NCMPCPP_UTILITY_FENWICK_TREE_H
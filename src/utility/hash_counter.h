@@ -0,0 +1,173 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_HASH_COUNTER_H
+#define NCMPCPP_UTILITY_HASH_COUNTER_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+/// Counts occurrences of keys in an open addressing hash table with linear
+/// probing. Hashes and counts are kept apart from the keys, so that probing
+/// touches only a compact array and compares keys only on hash match.
+template <typename KeyT, typename HashT>
+struct HashCounter
+{
+	HashCounter() : m_size(0), m_hits(0), m_misses(0) { }
+
+	size_t size() const { return m_size; }
+
+	/// Statistics of lookups made with contains.
+	size_t hits() const { return m_hits; }
+	size_t misses() const { return m_misses; }
+
+	void clear()
+	{
+		m_slots.clear();
+		m_keys.clear();
+		m_size = 0;
+	}
+
+	void insert(const KeyT &key)
+	{
+		if (2*(m_size+1) > m_slots.size())
+			rehash(std::max(size_t(16), 2*m_slots.size()));
+		size_t hash = HashT()(key);
+		size_t i = find(key, hash);
+		if (m_slots[i].count == 0)
+		{
+			m_slots[i].hash = hash;
+			m_keys[i] = key;
+			++m_size;
+		}
+		++m_slots[i].count;
+	}
+
+	void erase(const KeyT &key)
+	{
+		if (m_slots.empty())
+			return;
+		size_t i = find(key, HashT()(key));
+		assert(m_slots[i].count > 0);
+		if (m_slots[i].count == 0 || --m_slots[i].count > 0)
+			return;
+		removeAt(i);
+		--m_size;
+		if (m_slots.size() > 16 && 8*m_size < m_slots.size())
+			rehash(m_slots.size() / 2);
+	}
+
+	bool contains(const KeyT &key) const
+	{
+		bool found = !m_slots.empty() && m_slots[find(key, HashT()(key))].count > 0;
+		++(found ? m_hits : m_misses);
+		return found;
+	}
+
+	/// Replace contents with keys from a given range. Faster than inserting
+	/// them one by one as the table is sized upfront.
+	template <typename IteratorT>
+	void assign(IteratorT first, IteratorT last)
+	{
+		clear();
+		size_t capacity = 16;
+		while (capacity < 2*size_t(std::distance(first, last)))
+			capacity *= 2;
+		rehash(capacity);
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+private:
+	struct Slot
+	{
+		Slot() : hash(0), count(0) { }
+
+		size_t hash;
+		uint32_t count;
+	};
+
+	size_t mask() const { return m_slots.size() - 1; }
+
+	// Returns slot with the key or the empty one where it belongs.
+	size_t find(const KeyT &key, size_t hash) const
+	{
+		size_t i = hash & mask();
+		while (m_slots[i].count > 0
+		       && (m_slots[i].hash != hash || !(m_keys[i] == key)))
+			i = (i + 1) & mask();
+		return i;
+	}
+
+	// Backward shift deletion, moves back entries that would become
+	// unreachable otherwise, so that no tombstones are needed.
+	void removeAt(size_t i)
+	{
+		size_t j = i;
+		while (true)
+		{
+			j = (j + 1) & mask();
+			if (m_slots[j].count == 0)
+				break;
+			size_t home = m_slots[j].hash & mask();
+			// Move the entry if its home slot is not in (i, j].
+			bool in_range = i <= j
+				? (i < home && home <= j)
+				: (i < home || home <= j);
+			if (!in_range)
+			{
+				m_slots[i] = m_slots[j];
+				m_keys[i] = std::move(m_keys[j]);
+				i = j;
+			}
+		}
+		m_slots[i] = Slot();
+		m_keys[i] = KeyT();
+	}
+
+	void rehash(size_t capacity)
+	{
+		std::vector<Slot> slots(capacity);
+		std::vector<KeyT> keys(capacity);
+		m_slots.swap(slots);
+		m_keys.swap(keys);
+		for (size_t i = 0; i < slots.size(); ++i)
+		{
+			if (slots[i].count == 0)
+				continue;
+			size_t j = find(keys[i], slots[i].hash);
+			m_slots[j] = slots[i];
+			m_keys[j] = std::move(keys[i]);
+		}
+	}
+
+	std::vector<Slot> m_slots;
+	std::vector<KeyT> m_keys;
+	size_t m_size;
+
+	mutable size_t m_hits;
+	mutable size_t m_misses;
+};
+
+#endif // NCMPCPP_UTILITY_HASH_COUNTER_H
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_LRU_CACHE_H
+#define NCMPCPP_UTILITY_LRU_CACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+/// Cache that keeps total cost of its values within a given capacity by
+/// evicting the least recently used ones.
+template <typename KeyT, typename ValueT, typename HashT = std::hash<KeyT>>
+struct LruCache
+{
+	explicit LruCache(size_t capacity)
+	: m_capacity(capacity), m_cost(0), m_hits(0), m_misses(0) { }
+
+	/// Statistics of lookups made with get.
+	size_t hits() const { return m_hits; }
+	size_t misses() const { return m_misses; }
+
+	bool contains(const KeyT &key) const
+	{
+		return m_index.find(key) != m_index.end();
+	}
+
+	/// @return value for a given key (and mark it as the most recently
+	/// used one) or nullptr if it's not there.
+	const ValueT *get(const KeyT &key)
+	{
+		auto it = m_index.find(key);
+		if (it == m_index.end())
+		{
+			++m_misses;
+			return nullptr;
+		}
+		++m_hits;
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		return &it->second->value;
+	}
+
+	/// Insert a value, replacing the one with the same key. Values that
+	/// cost more than the capacity are not stored.
+	void put(const KeyT &key, ValueT value, size_t cost)
+	{
+		erase(key);
+		if (cost > m_capacity)
+			return;
+		while (m_cost + cost > m_capacity)
+			erase(m_entries.back().key);
+		m_entries.push_front(Entry{key, std::move(value), cost});
+		m_index.emplace(key, m_entries.begin());
+		m_cost += cost;
+	}
+
+	void erase(const KeyT &key)
+	{
+		auto it = m_index.find(key);
+		if (it == m_index.end())
+			return;
+		m_cost -= it->second->cost;
+		m_entries.erase(it->second);
+		m_index.erase(it);
+	}
+
+	void clear()
+	{
+		m_entries.clear();
+		m_index.clear();
+		m_cost = 0;
+	}
+
+private:
+	struct Entry
+	{
+		KeyT key;
+		ValueT value;
+		size_t cost;
+	};
+
+	// Most recently used entries go first.
+	std::list<Entry> m_entries;
+	std::unordered_map<KeyT, typename std::list<Entry>::iterator, HashT> m_index;
+
+	size_t m_capacity;
+	size_t m_cost;
+
+	size_t m_hits;
+	size_t m_misses;
+};
+
+#endif // NCMPCPP_UTILITY_LRU_CACHE_H
@@ -0,0 +1,173 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include "utility/fenwick_tree.h"
+#include "utility/reorder_plan.h"
+
+namespace {
+
+const size_t none = -1;
+
+// Marks elements forming the longest increasing subsequence of a sequence.
+std::vector<bool> longestIncreasingSubsequence(const std::vector<size_t> &seq)
+{
+	// tails[k] is the index of the smallest element ending an increasing
+	// subsequence of length k+1.
+	std::vector<size_t> tails, prev(seq.size(), none);
+	for (size_t i = 0; i < seq.size(); ++i)
+	{
+		auto it = std::lower_bound(tails.begin(), tails.end(), seq[i],
+			[&seq](size_t idx, size_t value) { return seq[idx] < value; });
+		if (it != tails.begin())
+			prev[i] = *(it-1);
+		if (it == tails.end())
+			tails.push_back(i);
+		else
+			*it = i;
+	}
+	std::vector<bool> result(seq.size(), false);
+	for (size_t i = tails.empty() ? none : tails.back(); i != none; i = prev[i])
+		result[i] = true;
+	return result;
+}
+
+// Moves every element that is not a part of the longest increasing
+// subsequence of target positions right after its predecessor in the
+// target order. The sequence is modeled as a list of slots: each element
+// has its original slot and, if it's moved, the one after its predecessor.
+// Occupied slots are tracked in a Fenwick tree to get current positions.
+std::vector<ReorderStep> planMoves(const std::vector<size_t> &order,
+                                   const std::vector<size_t> &target)
+{
+	size_t n = order.size();
+	auto stays = longestIncreasingSubsequence(target);
+
+	// Elements moved after each staying one (or to the beginning).
+	std::vector<std::vector<size_t>> chains(n+1);
+	size_t anchor = n;
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (stays[order[i]])
+			anchor = order[i];
+		else
+			chains[anchor].push_back(order[i]);
+	}
+
+	std::vector<size_t> orig_slot(n), moved_slot(n, none);
+	FenwickTree<size_t> slots;
+	auto add_chain = [&](size_t anchor) {
+		for (size_t e : chains[anchor])
+		{
+			moved_slot[e] = slots.size();
+			slots.push_back(0);
+		}
+	};
+	add_chain(n);
+	for (size_t e = 0; e < n; ++e)
+	{
+		orig_slot[e] = slots.size();
+		slots.push_back(1);
+		if (stays[e])
+			add_chain(e);
+	}
+
+	std::vector<ReorderStep> result;
+	for (size_t i = 0; i < n;)
+	{
+		size_t first = order[i];
+		if (stays[first])
+		{
+			++i;
+			continue;
+		}
+		// Elements adjacent in both orders are moved as one range.
+		size_t count = 1;
+		while (i+count < n
+		       && order[i+count] == first+count
+		       && !stays[order[i+count]])
+			++count;
+		size_t from = slots.prefix(orig_slot[first]);
+		for (size_t e = first; e < first+count; ++e)
+		{
+			slots.set(orig_slot[e], 0);
+			slots.set(moved_slot[e], 1);
+		}
+		result.push_back({false, from, from+count, slots.prefix(moved_slot[first])});
+		i += count;
+	}
+	return result;
+}
+
+// Puts each element in place by a swap, which takes one command less than
+// the length of each cycle of the permutation.
+std::vector<ReorderStep> planSwaps(const std::vector<size_t> &order)
+{
+	size_t n = order.size();
+	// Current contents of positions and positions of elements.
+	std::vector<size_t> at(n), pos(n);
+	for (size_t i = 0; i < n; ++i)
+		at[i] = pos[i] = i;
+	std::vector<ReorderStep> result;
+	for (size_t i = 0; i < n; ++i)
+	{
+		size_t j = pos[order[i]];
+		if (i == j)
+			continue;
+		result.push_back({true, i, i+1, j});
+		std::swap(at[i], at[j]);
+		pos[at[i]] = i;
+		pos[at[j]] = j;
+	}
+	return result;
+}
+
+size_t countCycles(const std::vector<size_t> &order)
+{
+	std::vector<bool> visited(order.size(), false);
+	size_t result = 0;
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		if (visited[i])
+			continue;
+		++result;
+		for (size_t j = i; !visited[j]; j = order[j])
+			visited[j] = true;
+	}
+	return result;
+}
+
+}
+
+std::vector<ReorderStep> planReorder(const std::vector<size_t> &order)
+{
+	std::vector<size_t> target(order.size());
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		assert(order[i] < order.size());
+		target[order[i]] = i;
+	}
+	auto moves = planMoves(order, target);
+	if (moves.size() <= order.size() - countCycles(order))
+		return moves;
+	else
+		return planSwaps(order);
+}
@@ -0,0 +1,44 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_REORDER_PLAN_H
+#define NCMPCPP_UTILITY_REORDER_PLAN_H
+
+#include <cstddef>
+#include <vector>
+
+/// Single command of a reorder plan. Either swaps elements at positions
+/// start and to or moves elements [start, end) so that the first of them
+/// ends up at position to (as MPD's swap and move commands do).
+struct ReorderStep
+{
+	bool swap;
+	size_t start;
+	size_t end;
+	size_t to;
+};
+
+/// Plan commands rearranging a sequence so that the element at position
+/// order[i] ends up at position i. Elements that are already in the right
+/// order relative to each other are not touched and adjacent ones are moved
+/// together. If it takes fewer commands, the plan swaps elements instead.
+std::vector<ReorderStep> planReorder(const std::vector<size_t> &order);
+
+#endif // NCMPCPP_UTILITY_REORDER_PLAN_H
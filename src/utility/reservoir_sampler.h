@@ -0,0 +1,68 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_RESERVOIR_SAMPLER_H
+#define NCMPCPP_UTILITY_RESERVOIR_SAMPLER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+/// Picks a uniformly random sample of a given size from a sequence of
+/// unknown length while keeping only the sample in memory (algorithm R).
+template <typename ValueT>
+struct ReservoirSampler
+{
+	explicit ReservoirSampler(size_t size)
+	: m_size(size), m_seen(0) { }
+
+	/// @return number of elements offered so far.
+	size_t seen() const { return m_seen; }
+
+	template <typename RNG>
+	void add(ValueT value, RNG &rng)
+	{
+		if (m_sample.size() < m_size)
+			m_sample.push_back(std::move(value));
+		else
+		{
+			size_t i = std::uniform_int_distribution<size_t>(0, m_seen)(rng);
+			if (i < m_size)
+				m_sample[i] = std::move(value);
+		}
+		++m_seen;
+	}
+
+	/// @return the sample in random order.
+	template <typename RNG>
+	std::vector<ValueT> take(RNG &rng)
+	{
+		std::shuffle(m_sample.begin(), m_sample.end(), rng);
+		return std::move(m_sample);
+	}
+
+private:
+	size_t m_size;
+	size_t m_seen;
+	std::vector<ValueT> m_sample;
+};
+
+#endif // NCMPCPP_UTILITY_RESERVOIR_SAMPLER_H
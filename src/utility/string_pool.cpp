@@ -0,0 +1,101 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <boost/functional/hash.hpp>
+#include <cassert>
+
+#include "utility/string_pool.h"
+
+namespace {
+
+// Strings are allocated from chunks of this size to avoid
+// per string allocation overhead.
+const size_t chunk_size = 64 * 1024;
+
+}
+
+StringPool::StringPool()
+: m_chunk(m_chunks.end()), m_chunk_pos(nullptr), m_chunk_left(0)
+{ }
+
+const char *StringPool::intern(const char *s)
+{
+	auto it = m_strings.find(s);
+	if (it == m_strings.end())
+	{
+		Entry entry;
+		entry.refs = 0;
+		const char *stored = store(s, strlen(s), entry.chunk);
+		++entry.chunk->strings;
+		it = m_strings.emplace(stored, entry).first;
+	}
+	++it->second.refs;
+	return it->first;
+}
+
+void StringPool::release(const char *s)
+{
+	auto it = m_strings.find(s);
+	assert(it != m_strings.end() && it->first == s);
+	if (--it->second.refs > 0)
+		return;
+	auto chunk = it->second.chunk;
+	m_strings.erase(it);
+	// Space of released strings is not reused, the current chunk is
+	// freed only when it's replaced.
+	if (--chunk->strings == 0 && chunk != m_chunk)
+		m_chunks.erase(chunk);
+}
+
+/**********************************************************************/
+
+size_t StringPool::Hash::operator()(const char *s) const
+{
+	return boost::hash_range(s, s + strlen(s));
+}
+
+const char *StringPool::store(const char *s, size_t length, ChunkIterator &chunk)
+{
+	size_t size = length + 1;
+	char *result;
+	if (size > chunk_size / 4)
+	{
+		// Don't waste space of the current chunk on long strings.
+		chunk = m_chunks.insert(m_chunks.end(), Chunk{std::unique_ptr<char[]>(new char[size]), 0});
+		result = chunk->data.get();
+	}
+	else
+	{
+		if (size > m_chunk_left)
+		{
+			if (m_chunk != m_chunks.end() && m_chunk->strings == 0)
+				m_chunks.erase(m_chunk);
+			m_chunk = m_chunks.insert(m_chunks.end(), Chunk{std::unique_ptr<char[]>(new char[chunk_size]), 0});
+			m_chunk_pos = m_chunk->data.get();
+			m_chunk_left = chunk_size;
+		}
+		chunk = m_chunk;
+		result = m_chunk_pos;
+		m_chunk_pos += size;
+		m_chunk_left -= size;
+	}
+	memcpy(result, s, size);
+	return result;
+}
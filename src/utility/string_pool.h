@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_STRING_POOL_H
+#define NCMPCPP_UTILITY_STRING_POOL_H
+
+#include <cstring>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/// Stores each distinct string only once. Returned pointers stay valid until
+/// the string is released as many times as it was interned, so they can be
+/// compared for equality directly. Not thread safe.
+struct StringPool
+{
+	StringPool();
+
+	/// Intern a string or increase reference count of an interned one.
+	const char *intern(const char *s);
+	const char *intern(const std::string &s) { return intern(s.c_str()); }
+
+	/// Decrease reference count of an interned string. Memory of a string
+	/// that is no longer referenced is reclaimed with the last string of
+	/// the chunk it was stored in.
+	void release(const char *s);
+
+	size_t size() const { return m_strings.size(); }
+
+	/// @return number of chunks strings are stored in.
+	size_t chunks() const { return m_chunks.size(); }
+
+private:
+	struct Hash
+	{
+		size_t operator()(const char *s) const;
+	};
+	struct Equal
+	{
+		bool operator()(const char *a, const char *b) const {
+			return strcmp(a, b) == 0;
+		}
+	};
+
+	struct Chunk
+	{
+		std::unique_ptr<char[]> data;
+		// Number of strings in the chunk that are still referenced.
+		size_t strings;
+	};
+	typedef std::list<Chunk>::iterator ChunkIterator;
+
+	struct Entry
+	{
+		size_t refs;
+		ChunkIterator chunk;
+	};
+
+	const char *store(const char *s, size_t length, ChunkIterator &chunk);
+
+	std::unordered_map<const char *, Entry, Hash, Equal> m_strings;
+	std::list<Chunk> m_chunks;
+	// Chunk that short strings are currently stored in.
+	ChunkIterator m_chunk;
+	char *m_chunk_pos;
+	size_t m_chunk_left;
+};
+
+#endif // NCMPCPP_UTILITY_STRING_POOL_H
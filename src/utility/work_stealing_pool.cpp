@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <cassert>
+#include <thread>
+
+#include "utility/work_stealing_pool.h"
+
+namespace {
+
+// Pool and queue of the thread that is running a task.
+thread_local const WorkStealingPool *current_pool = nullptr;
+thread_local size_t current_queue;
+
+}
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+: m_next_queue(0), m_pending(0), m_queued(0)
+{
+	assert(threads > 0);
+	for (size_t i = 0; i < threads; ++i)
+		m_queues.emplace_back(new Queue);
+}
+
+void WorkStealingPool::push(Task task)
+{
+	assert(task);
+	size_t index;
+	if (current_pool == this)
+		index = current_queue;
+	else
+		index = m_next_queue++ % m_queues.size();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		{
+			std::lock_guard<std::mutex> queue_lock(m_queues[index]->mutex);
+			m_queues[index]->tasks.push_back(std::move(task));
+		}
+		++m_pending;
+		++m_queued;
+	}
+	m_cv.notify_one();
+}
+
+void WorkStealingPool::run()
+{
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < m_queues.size(); ++i)
+		threads.emplace_back(&WorkStealingPool::work, this, i);
+	work(0);
+	for (auto &thread : threads)
+		thread.join();
+
+	if (m_error)
+	{
+		auto error = m_error;
+		m_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+/**********************************************************************/
+
+void WorkStealingPool::work(size_t index)
+{
+	current_pool = this;
+	current_queue = index;
+	Task task;
+	while (true)
+	{
+		if (pop(index, task))
+		{
+			bool failed;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				failed = m_error != nullptr;
+			}
+			if (!failed)
+			{
+				try
+				{
+					task();
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (!m_error)
+						m_error = std::current_exception();
+				}
+			}
+			task = nullptr;
+			finish();
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this] { return m_queued > 0 || m_pending == 0; });
+			if (m_pending == 0)
+				break;
+		}
+	}
+	current_pool = nullptr;
+}
+
+bool WorkStealingPool::pop(size_t index, Task &task)
+{
+	// Own queue first, then the others, starting from the next one so
+	// that victims of stealing are spread out.
+	for (size_t i = 0; i < m_queues.size(); ++i)
+	{
+		auto &queue = *m_queues[(index + i) % m_queues.size()];
+		std::lock_guard<std::mutex> queue_lock(queue.mutex);
+		if (queue.tasks.empty())
+			continue;
+		if (i == 0)
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		break;
+	}
+	if (!task)
+		return false;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	--m_queued;
+	return true;
+}
+
+void WorkStealingPool::finish()
+{
+	bool done;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		done = --m_pending == 0;
+	}
+	if (done)
+		m_cv.notify_all();
+}
@@ -0,0 +1,73 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_UTILITY_WORK_STEALING_POOL_H
+#define NCMPCPP_UTILITY_WORK_STEALING_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Runs tasks on a fixed number of threads. Each thread has its own queue.
+/// Tasks pushed by a running task go to the queue of the thread running it,
+/// which takes the most recently pushed one first, while threads that run
+/// out of work steal the oldest tasks from queues of the others.
+struct WorkStealingPool
+{
+	typedef std::function<void()> Task;
+
+	explicit WorkStealingPool(size_t threads);
+
+	/// Queue a task. Can be called from within running tasks.
+	void push(Task task);
+
+	/// Run queued tasks and the ones they push until there are none left.
+	/// If a task throws, remaining tasks are discarded and the exception is
+	/// rethrown once all threads are done.
+	void run();
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void work(size_t index);
+	bool pop(size_t index, Task &task);
+	void finish();
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	size_t m_next_queue;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	// Tasks that are queued or running.
+	size_t m_pending;
+	// Tasks that are queued.
+	size_t m_queued;
+	std::exception_ptr m_error;
+};
+
+#endif // NCMPCPP_UTILITY_WORK_STEALING_POOL_H
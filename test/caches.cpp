@@ -0,0 +1,161 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "database_format.h"
+#include "playlist_index_format.h"
+#include "tag_cache.h"
+#include "test.h"
+#include "utility/binary_io.h"
+
+using MPD::Song;
+
+namespace {
+
+void testDatabaseFormat()
+{
+	std::vector<Song> songs;
+	Song::Builder builder;
+	builder.start("dir/1.flac");
+	builder.setDuration(100);
+	builder.setMTime(-5);
+	builder.addTag(MPD_TAG_ARTIST, "first");
+	builder.addTag(MPD_TAG_ARTIST, "second");
+	builder.addTag(MPD_TAG_TITLE, "");
+	songs.push_back(builder.finish());
+	builder.start("2.mp3");
+	songs.push_back(builder.finish());
+
+	std::stringstream f;
+	DatabaseFormat::write(f, "localhost:6600", 1234, songs);
+	std::string data = f.str();
+
+	std::string server;
+	unsigned long db_update_time;
+	std::vector<Song> read_songs;
+	CHECK(DatabaseFormat::read(f, server, db_update_time, read_songs));
+	CHECK(server == "localhost:6600");
+	CHECK(db_update_time == 1234);
+	CHECK(read_songs.size() == 2);
+	if (read_songs.size() == 2)
+	{
+		const auto &s = read_songs[0];
+		CHECK(s.getURI() == "dir/1.flac");
+		CHECK(s.getDuration() == 100);
+		CHECK(s.getMTime() == -5);
+		CHECK(s.getArtist(0) == "first" && s.getArtist(1) == "second");
+		CHECK(s.c_tag(MPD_TAG_ARTIST, 2) == nullptr);
+		CHECK(s.c_tag(MPD_TAG_TITLE) != nullptr && s.getTitle().empty());
+		CHECK(read_songs[1].getURI() == "2.mp3");
+		CHECK(read_songs[1].c_tag(MPD_TAG_ARTIST) == nullptr);
+	}
+
+	// Truncated data is rejected no matter where it ends.
+	for (size_t size = 0; size < data.size(); ++size)
+	{
+		std::stringstream truncated(data.substr(0, size));
+		CHECK(!DatabaseFormat::read(truncated, server, db_update_time, read_songs));
+	}
+
+	// So is data with a different magic or version.
+	std::string corrupt = data;
+	corrupt[4] = 'X';
+	std::stringstream bad_magic(corrupt);
+	CHECK(!DatabaseFormat::read(bad_magic, server, db_update_time, read_songs));
+
+	// Song count way beyond what the data holds.
+	std::stringstream huge_count;
+	writeString(huge_count, "ncmpcpp-database");
+	writeInt(huge_count, uint32_t(1));
+	writeString(huge_count, "");
+	writeInt(huge_count, uint64_t(0));
+	writeInt(huge_count, uint8_t(0));
+	writeInt(huge_count, uint32_t(0xffffffff));
+	CHECK(!DatabaseFormat::read(huge_count, server, db_update_time, read_songs));
+}
+
+void testPlaylistIndexFormat()
+{
+	PlaylistIndexFormat::PlaylistMap playlists;
+	playlists["empty"].last_modified = 1;
+	auto &p = playlists["songs"];
+	p.last_modified = 2;
+	p.uris = { "a", "b", "a" };
+
+	std::stringstream f;
+	PlaylistIndexFormat::write(f, "localhost:6600", playlists);
+	std::string data = f.str();
+
+	std::string server;
+	PlaylistIndexFormat::PlaylistMap read_playlists;
+	CHECK(PlaylistIndexFormat::read(f, server, read_playlists));
+	CHECK(server == "localhost:6600");
+	CHECK(read_playlists.size() == 2);
+	CHECK(read_playlists["empty"].last_modified == 1 && read_playlists["empty"].uris.empty());
+	CHECK(read_playlists["songs"].last_modified == 2 && read_playlists["songs"].uris == p.uris);
+
+	for (size_t size = 0; size < data.size(); ++size)
+	{
+		std::stringstream truncated(data.substr(0, size));
+		CHECK(!PlaylistIndexFormat::read(truncated, server, read_playlists));
+	}
+}
+
+#ifdef HAVE_TAGLIB_H
+void testTagReadCache()
+{
+	const char path[] = "tag_cache.test";
+	Tags::Attributes tags = { { "ARTIST", "first" }, { "ARTIST", "second" } };
+	{
+		TagReadCache cache;
+		cache.load(path);
+		cache.put("dir/1.flac", 1000, 5, tags);
+		cache.put("dir/2.flac", 2000, 6, {});
+		cache.save();
+	}
+	TagReadCache cache;
+	cache.load(path);
+	Tags::Attributes read_tags;
+	CHECK(cache.get("dir/1.flac", 1000, 5, read_tags) && read_tags == tags);
+	CHECK(cache.get("dir/2.flac", 2000, 6, read_tags) && read_tags.empty());
+	// Entries are valid only for the same size and modification time.
+	CHECK(!cache.get("dir/1.flac", 1001, 5, read_tags));
+	CHECK(!cache.get("dir/1.flac", 1000, 7, read_tags));
+	CHECK(!cache.get("dir/3.flac", 1000, 5, read_tags));
+	std::remove(path);
+}
+#endif // HAVE_TAGLIB_H
+
+}
+
+int main()
+{
+	testDatabaseFormat();
+	testPlaylistIndexFormat();
+#	ifdef HAVE_TAGLIB_H
+	testTagReadCache();
+#	endif // HAVE_TAGLIB_H
+	return Test::result();
+}
@@ -0,0 +1,220 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "database_diff.h"
+#include "library_index.h"
+#include "song.h"
+#include "test.h"
+
+using MPD::Song;
+
+namespace {
+
+Song makeSong(const char *uri, const char *artist, const char *album,
+              const char *date, time_t mtime)
+{
+	Song::Builder builder;
+	builder.start(uri);
+	builder.setMTime(mtime);
+	if (artist != nullptr)
+		builder.addTag(MPD_TAG_ARTIST, artist);
+	builder.addTag(MPD_TAG_ALBUM, album);
+	builder.addTag(MPD_TAG_DATE, date);
+	return builder.finish();
+}
+
+Song makeSong(const char *uri)
+{
+	Song::Builder builder;
+	builder.start(uri);
+	return builder.finish();
+}
+
+std::vector<std::string> uris(const std::vector<Song> &songs)
+{
+	std::vector<std::string> result;
+	for (const auto &s : songs)
+		result.push_back(s.getURI());
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+void testSongBuilder()
+{
+	Song::Builder builder;
+	builder.start("dir/file.flac");
+	builder.addTag(MPD_TAG_ARTIST, "first");
+	builder.addTag(MPD_TAG_TITLE, "title");
+	builder.addTag(MPD_TAG_ARTIST, "second");
+	builder.setDuration(215);
+	builder.setMTime(1000);
+	Song s = builder.finish();
+	CHECK(s.getURI() == "dir/file.flac");
+	CHECK(s.getDirectory() == "dir");
+	CHECK(s.getName() == "file.flac");
+	CHECK(s.getArtist(0) == "first" && s.getArtist(1) == "second");
+	CHECK(s.c_tag(MPD_TAG_ARTIST, 2) == nullptr);
+	CHECK(s.getTitle() == "title");
+	CHECK(s.c_tag(MPD_TAG_ALBUM) == nullptr);
+	CHECK(s.getDuration() == 215);
+	CHECK(s.getMTime() == 1000);
+	CHECK(s.isFromDatabase());
+
+	// Values are interned, so songs with the same tags share them.
+	Song t = makeSong("other", "first", "album", "2000", 0);
+	CHECK(s.c_tag(MPD_TAG_ARTIST) == t.c_tag(MPD_TAG_ARTIST));
+	CHECK(s != t);
+	CHECK(s == makeSong("dir/file.flac"));
+	CHECK(s.intern() == s);
+
+	// Songs outlive the builder and blocks of songs built before them.
+	std::vector<Song> songs;
+	{
+		Song::Builder b;
+		for (int i = 0; i < 2000; ++i)
+		{
+			b.start(std::to_string(i).c_str());
+			for (int j = 0; j < i % 40; ++j)
+				b.addTag(MPD_TAG_GENRE, std::to_string(j).c_str());
+			songs.push_back(b.finish());
+		}
+	}
+	songs.erase(songs.begin(), songs.begin() + 1000);
+	for (int i = 1000; i < 2000; ++i)
+	{
+		const auto &song = songs[i - 1000];
+		CHECK(song.getURI() == std::to_string(i));
+		CHECK(song.c_tag(MPD_TAG_GENRE, i % 40) == nullptr);
+		if (i % 40 > 0)
+			CHECK(song.getGenre(i % 40 - 1) == std::to_string(i % 40 - 1));
+	}
+}
+
+void testLibraryIndex()
+{
+	std::vector<Song> songs = {
+		makeSong("1", "A", "X", "2000", 5),
+		makeSong("2", "A", "X", "2000", 7),
+		makeSong("3", "A", "Y", "2001", 3),
+		makeSong("4", "B", "Z", "1999", 1),
+		makeSong("5", nullptr, "Q", "", 9),
+	};
+
+	LibraryIndex index;
+	index.build(songs, MPD_TAG_ARTIST, true);
+	CHECK(!index.empty());
+	CHECK(index.primaryTag() == MPD_TAG_ARTIST);
+	CHECK(index.tags().size() == 2);
+	auto a = index.tag("A");
+	CHECK(a != nullptr && a->mtime == 7 && a->song_count == 3 && a->albums.size() == 2);
+	auto x = index.album("A", { "X", "2000" });
+	CHECK(x != nullptr && x->mtime == 7 && uris(x->songs) == std::vector<std::string>({ "1", "2" }));
+	CHECK(index.album("A", { "X", "2001" }) == nullptr);
+	CHECK(uris(index.songs("B")) == std::vector<std::string>({ "4" }));
+	CHECK(index.songs("C").empty());
+	// Albums regardless of the primary tag include songs without it.
+	CHECK(index.albums().size() == 4);
+	CHECK(index.album("Q") != nullptr && index.album("Q")->mtime == 9);
+
+	// Song 2 is moved to a different album and song 4 is removed.
+	index.update({ songs[1], songs[3] }, { makeSong("2", "A", "W", "2000", 11) });
+	a = index.tag("A");
+	CHECK(a != nullptr && a->mtime == 11 && a->song_count == 3 && a->albums.size() == 3);
+	x = index.album("A", { "X", "2000" });
+	CHECK(x != nullptr && x->mtime == 5 && uris(x->songs) == std::vector<std::string>({ "1" }));
+	CHECK(index.tag("B") == nullptr);
+	CHECK(index.album("Z") == nullptr);
+	CHECK(index.album("W") != nullptr);
+
+	// Removing a song that is not there changes nothing.
+	index.update({ makeSong("6", "A", "X", "2000", 0) }, {});
+	CHECK(index.tag("A")->song_count == 3);
+
+	LibraryIndex by_album;
+	by_album.build(songs, MPD_TAG_ARTIST, false);
+	CHECK(by_album.album("A", { "X", "" }) != nullptr);
+	CHECK(by_album.album("A", { "X", "2000" }) == nullptr);
+}
+
+void testDatabaseMerge()
+{
+	std::vector<Song> songs = {
+		makeSong("a/1", "A", "X", "2000", 1),
+		makeSong("a/2", "A", "X", "2000", 1),
+		makeSong("b/3", "B", "Y", "2000", 1),
+	};
+	auto old_songs = songs;
+
+	// a/2 was removed, b/3 moved to c/3, a/1 retagged and b/4 added.
+	std::vector<Song> listed = { makeSong("a/1"), makeSong("c/3"), makeSong("b/4") };
+	std::vector<Song> modified = {
+		makeSong("a/1", "A", "X2", "2000", 5),
+		makeSong("b/4", "B", "Y", "2000", 5),
+		// Modified songs that are not listed are ignored.
+		makeSong("d/5", "D", "Z", "2000", 5),
+	};
+	CHECK(movedSongDirectories(songs, listed, modified) == std::set<std::string>({ "c" }));
+
+	DatabaseDiff diff;
+	DatabaseMerge merge(songs, diff);
+	for (const auto &s : listed)
+		merge.addListed(s);
+	for (const auto &s : modified)
+		merge.addModified(s);
+	merge.addFromDirectory(makeSong("c/3", "B", "Y", "2000", 1));
+	merge.addFromDirectory(makeSong("c/other", "B", "Y", "2000", 1));
+	merge.finish();
+
+	CHECK(uris(songs) == std::vector<std::string>({ "a/1", "b/4", "c/3" }));
+	CHECK(uris(diff.added) == std::vector<std::string>({ "a/1", "b/4", "c/3" }));
+	CHECK(uris(diff.removed) == std::vector<std::string>({ "a/1", "a/2", "b/3" }));
+	auto retagged = std::find(songs.begin(), songs.end(), makeSong("a/1"));
+	CHECK(retagged != songs.end() && retagged->getAlbum() == "X2");
+	auto removed = std::find(diff.removed.begin(), diff.removed.end(), makeSong("a/1"));
+	CHECK(removed != diff.removed.end() && removed->getAlbum() == "X");
+
+	// Nothing changed.
+	songs = old_songs;
+	listed.clear();
+	for (const auto &s : old_songs)
+		listed.push_back(makeSong(s.c_uri()));
+	CHECK(movedSongDirectories(songs, listed, {}).empty());
+	DatabaseDiff empty_diff;
+	DatabaseMerge unchanged(songs, empty_diff);
+	for (const auto &s : listed)
+		unchanged.addListed(s);
+	unchanged.finish();
+	CHECK(empty_diff.empty());
+	CHECK(uris(songs) == uris(old_songs));
+}
+
+}
+
+int main()
+{
+	testSongBuilder();
+	testLibraryIndex();
+	testDatabaseMerge();
+	return Test::result();
+}
@@ -0,0 +1,57 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#ifndef NCMPCPP_TEST_TEST_H
+#define NCMPCPP_TEST_TEST_H
+
+#include <iostream>
+
+// Minimal helpers for unit tests. Failed checks are reported and make
+// the test program exit with non-zero status once all tests were run.
+
+namespace Test {
+
+inline int &failures()
+{
+	static int count = 0;
+	return count;
+}
+
+inline void check(bool ok, const char *expr, const char *file, int line)
+{
+	if (!ok)
+	{
+		std::cerr << file << ":" << line << ": check failed: " << expr << "\n";
+		++failures();
+	}
+}
+
+inline int result()
+{
+	if (failures() > 0)
+		std::cerr << failures() << " check(s) failed\n";
+	return failures() > 0 ? 1 : 0;
+}
+
+}
+
+#define CHECK(expr) Test::check(bool(expr), #expr, __FILE__, __LINE__)
+
+#endif // NCMPCPP_TEST_TEST_H
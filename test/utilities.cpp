@@ -0,0 +1,222 @@
+/***************************************************************************
+ *   Copyright (C) 2008-2017 by Andrzej Rybczak                            *
+ *   electricityispower@gmail.com                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.              *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "utility/binary_io.h"
+#include "utility/hash_counter.h"
+#include "utility/lru_cache.h"
+#include "utility/reorder_plan.h"
+#include "utility/string_pool.h"
+
+namespace {
+
+void testStringPool()
+{
+	StringPool pool;
+	const char *a = pool.intern("artist");
+	const char *b = pool.intern(std::string("artist"));
+	CHECK(a == b);
+	CHECK(std::string(a) == "artist");
+	CHECK(pool.intern("album") != a);
+	CHECK(pool.intern("") != nullptr);
+	CHECK(pool.size() == 3);
+
+	// Strings longer than a chunk and many small ones spanning chunks.
+	std::string long_string(100000, 'x');
+	const char *l = pool.intern(long_string);
+	CHECK(l == pool.intern(long_string));
+	std::vector<const char *> interned;
+	for (int i = 0; i < 30000; ++i)
+		interned.push_back(pool.intern(std::to_string(i)));
+	for (int i = 0; i < 30000; ++i)
+		CHECK(interned[i] == pool.intern(std::to_string(i)));
+	CHECK(std::string(l) == long_string);
+	CHECK(std::string(a) == "artist");
+
+	// Strings are kept until they're released as many times as they were
+	// interned and chunks are freed with the last of their strings.
+	size_t size = pool.size();
+	pool.release(a);
+	CHECK(pool.size() == size);
+	pool.release(b);
+	CHECK(pool.size() == size - 1);
+	pool.release(l);
+	pool.release(l);
+	CHECK(pool.size() == size - 2);
+	for (int i = 0; i < 30000; ++i)
+	{
+		pool.release(interned[i]);
+		pool.release(interned[i]);
+	}
+	CHECK(pool.size() == size - 30002);
+	// The first one still holds "album" and "", the last one is in use.
+	CHECK(pool.chunks() == 2);
+	CHECK(std::string(pool.intern("artist")) == "artist");
+}
+
+void testHashCounter()
+{
+	HashCounter<std::string, std::hash<std::string>> counter;
+	CHECK(!counter.contains("a"));
+	counter.insert("a");
+	counter.insert("a");
+	counter.insert("b");
+	CHECK(counter.size() == 2);
+	CHECK(counter.contains("a") && counter.contains("b"));
+	counter.erase("a");
+	CHECK(counter.contains("a"));
+	counter.erase("a");
+	CHECK(!counter.contains("a"));
+	CHECK(counter.size() == 1);
+	CHECK(counter.hits() == 3 && counter.misses() == 2);
+
+	// Growing and shrinking keeps the remaining keys.
+	for (int i = 0; i < 1000; ++i)
+		counter.insert(std::to_string(i));
+	for (int i = 0; i < 990; ++i)
+		counter.erase(std::to_string(i));
+	for (int i = 990; i < 1000; ++i)
+		CHECK(counter.contains(std::to_string(i)));
+	CHECK(counter.contains("b"));
+	CHECK(counter.size() == 11);
+
+	std::vector<std::string> keys = { "x", "y", "x" };
+	counter.assign(keys.begin(), keys.end());
+	CHECK(counter.size() == 2);
+	CHECK(!counter.contains("b"));
+	counter.erase("x");
+	CHECK(counter.contains("x"));
+}
+
+void testLruCache()
+{
+	LruCache<int, std::string> cache(10);
+	cache.put(1, "one", 4);
+	cache.put(2, "two", 4);
+	CHECK(cache.get(1) != nullptr && *cache.get(1) == "one");
+	// 2 is the least recently used one now.
+	cache.put(3, "three", 4);
+	CHECK(cache.contains(1) && !cache.contains(2) && cache.contains(3));
+	// Values costing more than the capacity are not stored.
+	cache.put(4, "four", 11);
+	CHECK(!cache.contains(4));
+	CHECK(cache.contains(1) && cache.contains(3));
+	// Replacing a value updates its cost.
+	cache.put(1, "uno", 6);
+	CHECK(*cache.get(1) == "uno" && cache.contains(3));
+	cache.put(5, "five", 1);
+	CHECK(!cache.contains(3));
+	CHECK(cache.get(2) == nullptr);
+	CHECK(cache.hits() == 3 && cache.misses() == 1);
+	cache.clear();
+	CHECK(!cache.contains(1));
+}
+
+// Apply the plan the way MPD does and check that it gives the expected order.
+void checkReorder(const std::vector<size_t> &order)
+{
+	std::vector<size_t> v(order.size());
+	std::iota(v.begin(), v.end(), 0);
+	for (const auto &step : planReorder(order))
+	{
+		if (step.swap)
+			std::swap(v[step.start], v[step.to]);
+		else
+		{
+			std::vector<size_t> range(v.begin() + step.start, v.begin() + step.end);
+			v.erase(v.begin() + step.start, v.begin() + step.end);
+			v.insert(v.begin() + step.to, range.begin(), range.end());
+		}
+	}
+	CHECK(v == order);
+}
+
+void testReorderPlan()
+{
+	CHECK(planReorder({}).empty());
+	CHECK(planReorder({ 0, 1, 2, 3 }).empty());
+	checkReorder({ 1, 0 });
+	checkReorder({ 3, 2, 1, 0 });
+	checkReorder({ 2, 3, 0, 1 });
+	checkReorder({ 0, 2, 3, 1, 4 });
+	// A block of adjacent elements is moved with a single command.
+	auto plan = planReorder({ 3, 4, 5, 0, 1, 2 });
+	CHECK(plan.size() == 1);
+	checkReorder({ 3, 4, 5, 0, 1, 2 });
+
+	std::mt19937 rng(42);
+	for (size_t size : { 5, 50, 500 })
+	{
+		std::vector<size_t> order(size);
+		std::iota(order.begin(), order.end(), 0);
+		for (int i = 0; i < 20; ++i)
+		{
+			std::shuffle(order.begin(), order.end(), rng);
+			checkReorder(order);
+		}
+	}
+}
+
+void testBinaryIo()
+{
+	std::stringstream f;
+	writeInt(f, uint32_t(42));
+	writeInt(f, int64_t(-1));
+	writeString(f, "");
+	writeString(f, "value");
+	std::string long_string(200000, 'x');
+	writeString(f, long_string.c_str());
+
+	uint32_t u;
+	int64_t i;
+	std::string s;
+	CHECK(readInt(f, u) && u == 42);
+	CHECK(readInt(f, i) && i == -1);
+	CHECK(readString(f, s) && s.empty());
+	CHECK(readString(f, s) && s == "value");
+	CHECK(remainingSize(f) == 4 + long_string.size());
+	CHECK(readString(f, s) && s == long_string);
+	CHECK(!readInt(f, u));
+
+	// Lengths beyond the end of the data don't allocate them upfront.
+	std::stringstream truncated;
+	writeInt(truncated, uint32_t(0xffffffff));
+	truncated << "abc";
+	CHECK(!readString(truncated, s));
+}
+
+}
+
+int main()
+{
+	testStringPool();
+	testHashCounter();
+	testLruCache();
+	testReorderPlan();
+	testBinaryIo();
+	return Test::result();
+}